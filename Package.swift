@@ -9,7 +9,8 @@ let package = Package(
         // Products define the executables and libraries a package produces, making them visible to other packages.
         .library(name: "Kiwi", targets: ["Kiwi"]),
         .library(name: "KiwiCXX", targets: ["KiwiCXX"]),
-        .library(name: "KiwiObjC", targets: ["KiwiObjC"])
+        .library(name: "KiwiObjC", targets: ["KiwiObjC"]),
+        .executable(name: "KiwiBench", targets: ["KiwiBench"])
     ],
     dependencies: [
         .package(url: "https://github.com/jarrodnorwell/XBRZ", branch: "main")
@@ -18,12 +19,13 @@ let package = Package(
         // Targets are the basic building blocks of a package, defining a module or a test suite.
         // Targets can depend on other targets in this package and products from dependencies.d
         .target(name: "Kiwi", dependencies: ["KiwiObjC"]),
-        .target(name: "KiwiCXX", dependencies: ["XBRZ"], sources: ["", "bus", "cartridge", "controller", "cpu", "mappers", "ppu"], publicHeadersPath: "include", swiftSettings: [
+        .target(name: "KiwiCXX", dependencies: ["XBRZ"], sources: ["", "apu", "bus", "cartridge", "controller", "cpu", "farm", "library", "lockstep", "mappers", "movie", "netplay", "pacing", "ppu", "rewind", "state"], publicHeadersPath: "include", swiftSettings: [
             .interoperabilityMode(.Cxx)
         ]),
         .target(name: "KiwiObjC", dependencies: ["KiwiCXX"], publicHeadersPath: "include", swiftSettings: [
             .interoperabilityMode(.Cxx)
-        ])
+        ]),
+        .executableTarget(name: "KiwiBench", dependencies: ["KiwiCXX"])
     ],
     cLanguageStandard: .c2x,
     cxxLanguageStandard: .cxx2b
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/// The 6502 opcodes the stress ROMs are written with
+enum Opcode : std::uint8_t {
+    ADC_ZP = 0x65,
+    ADC_ABSX = 0x7d,
+    AND_IMM = 0x29,
+    ASL_A = 0x0a,
+    BIT_ABS = 0x2c,
+    BNE = 0xd0,
+    BPL = 0x10,
+    CLC = 0x18,
+    CLD = 0xd8,
+    CLI = 0x58,
+    CPX_IMM = 0xe0,
+    CPY_IMM = 0xc0,
+    DEX = 0xca,
+    DEY = 0x88,
+    EOR_IMM = 0x49,
+    EOR_ZP = 0x45,
+    INC_ZP = 0xe6,
+    INC_ABSX = 0xfe,
+    INX = 0xe8,
+    INY = 0xc8,
+    JMP_ABS = 0x4c,
+    JSR = 0x20,
+    LDA_IMM = 0xa9,
+    LDA_ABS = 0xad,
+    LDA_ABSX = 0xbd,
+    LDX_IMM = 0xa2,
+    LDY_IMM = 0xa0,
+    LSR_A = 0x4a,
+    ORA_IMM = 0x09,
+    PHA = 0x48,
+    PLA = 0x68,
+    ROL_ZP = 0x26,
+    RTI = 0x40,
+    RTS = 0x60,
+    SBC_IMM = 0xe9,
+    SEC = 0x38,
+    SEI = 0x78,
+    STA_ZP = 0x85,
+    STA_ABS = 0x8d,
+    STA_ABSX = 0x9d,
+    STX_ABS = 0x8e,
+    STY_ABS = 0x8c,
+    TAX = 0xaa,
+    TAY = 0xa8,
+    TXA = 0x8a,
+    TXS = 0x9a,
+    TYA = 0x98,
+};
+
+/// A 6502 assembler for the last 8KB of the CPU address space, $E000-$FFFF,
+/// where the stress ROMs keep their code, tables and vectors.
+///
+/// Branches only go back to labels already assembled, which is all the
+/// loops of the stress ROMs need.
+class Assembler {
+
+private:
+    /// the assembled bytes of $E000-$FFFF
+    std::vector<std::uint8_t> image;
+    /// the address the next byte is assembled at
+    std::uint16_t address;
+
+public:
+    /// The first address of the assembled window
+    static constexpr std::uint16_t ORIGIN = 0xe000;
+
+    /// Initialize a new assembler at the start of the window, filled with
+    /// $FF like an erased ROM.
+    Assembler() : image(0x2000, 0xff), address(ORIGIN) { };
+
+    /// Return the address the next byte is assembled at, to use as a label.
+    inline std::uint16_t here() const { return address; };
+
+    /// Move to an address in the window.
+    inline void org(std::uint16_t address) { this->address = address; };
+
+    /// Assemble a byte.
+    inline void byte(std::uint8_t value) { image[address++ - ORIGIN] = value; };
+
+    /// Assemble a little endian word.
+    inline void word(std::uint16_t value) { byte(value & 0xff); byte(value >> 8); };
+
+    /// Assemble an instruction without an operand.
+    inline void op(Opcode opcode) { byte(opcode); };
+
+    /// Assemble an instruction with an immediate or zero page operand.
+    inline void op(Opcode opcode, std::uint8_t operand) { byte(opcode); byte(operand); };
+
+    /// Assemble an instruction with an absolute operand.
+    inline void op16(Opcode opcode, std::uint16_t operand) { byte(opcode); word(operand); };
+
+    /// Assemble a branch back to a label.
+    inline void branch(Opcode opcode, std::uint16_t label) {
+        byte(opcode);
+        byte(static_cast<std::uint8_t>(label - (address + 1)));
+    };
+
+    /// Assemble the NMI, reset and IRQ vectors at $FFFA.
+    inline void vectors(std::uint16_t nmi, std::uint16_t reset, std::uint16_t irq) {
+        org(0xfffa);
+        word(nmi);
+        word(reset);
+        word(irq);
+    };
+
+    /// Return the assembled bytes of $E000-$FFFF.
+    inline const std::vector<std::uint8_t>& get_image() const { return image; };
+
+};
@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "apu/apu.hpp"
+#include "benchmark.hpp"
+#include "bus/bus.hpp"
+#include "cartridge/cartridge.hpp"
+#include "cpu/cpu.hpp"
+#include "emulator.hpp"
+#include "lockstep/lockstep.hpp"
+#include "mappers/mapper.hpp"
+#include "ppu/ppu.hpp"
+#include "ppu/ppu_bus.hpp"
+
+/// The number of PPU cycles in a frame
+static constexpr int PPU_CYCLES_PER_FRAME = 341 * 262;
+/// The number of reads timed through the mapper
+static constexpr int MAPPER_READS = 1 << 22;
+/// The number of frames the scaler is timed on
+static constexpr int SCALES = 30;
+
+/// a sink for values read only to be timed, so the reads aren't optimized out
+static volatile std::uint32_t sink;
+
+/// Return the nanoseconds a function takes to run.
+template <typename Function>
+static double time_ns(Function function) {
+    auto start = std::chrono::steady_clock::now();
+    function();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/// Time the whole emulator running headless and the scaler after it.
+///
+/// @return the nanoseconds per frame, with the nanoseconds per scale in scale
+///
+static double time_emulator(const std::string& rom, int frames, double& scale) {
+    Emulator emulator(rom);
+    emulator.reset();
+    emulator.set_headless(true);
+    // press a fixed pattern of buttons so games get past their title screens
+    double elapsed = time_ns([&] {
+        for (int frame = 0; frame < frames; frame++) {
+            emulator.get_controller(0)[0] = frame * 7;
+            emulator.step();
+        }
+    });
+    // render a frame to scale
+    emulator.set_headless(false);
+    emulator.step();
+    scale = time_ns([&] {
+        for (int i = 0; i < SCALES; i++)
+            sink = emulator.get_screen_buffer()[i];
+    }) / SCALES;
+    return elapsed / frames;
+}
+
+/// Time the CPU running alone with the PPU status faked.
+///
+/// @return the nanoseconds per instruction
+///
+static double time_cpu(Cartridge& cartridge, int frames) {
+    MainBus bus;
+    CPU cpu;
+    auto mapper = Mapper::create(cartridge, [] { }, [&] { cpu.interrupt(bus, CPU::IRQ_INTERRUPT); });
+    bus.set_mapper(mapper.get());
+    // flip the vertical blank flag on each read so wait loops on it end
+    std::uint8_t status = 0;
+    bus.set_read_callback(PPUSTATUS, [&] { return status ^= 0x80; });
+    cpu.reset(bus);
+    std::uint64_t instructions = cpu.get_instructions();
+    double elapsed = time_ns([&] {
+        for (int frame = 0; frame < frames; frame++) {
+            for (int cycle = 0; cycle < Emulator::CYCLES_PER_FRAME; cycle++)
+                cpu.cycle(bus);
+            // games waiting on the NMI handler to set a flag need the NMI
+            cpu.interrupt(bus, CPU::NMI_INTERRUPT);
+        }
+    });
+    return elapsed / std::max<std::uint64_t>(1, cpu.get_instructions() - instructions);
+}
+
+/// A write to an APU register
+struct APUWrite {
+    /// the CPU cycle of the write, counted from power on
+    int cycle;
+    /// the address of the register
+    std::uint16_t address;
+    /// the value written
+    std::uint8_t value;
+};
+
+/// Time the APU alone synthesizing the sound of the ROM.
+///
+/// The ROM first runs on the CPU and the APU with the PPU status faked while
+/// its writes to the APU are recorded, then the writes are replayed on time
+/// into a new APU with synthesis on, the samples taken every frame.
+///
+/// @return the nanoseconds per frame
+///
+static double time_apu(Cartridge& cartridge, int frames) {
+    MainBus bus;
+    CPU cpu;
+    APU apu;
+    auto mapper = Mapper::create(cartridge, [] { }, [&] { cpu.interrupt(bus, CPU::IRQ_INTERRUPT); });
+    bus.set_mapper(mapper.get());
+    std::uint8_t status = 0;
+    bus.set_read_callback(PPUSTATUS, [&] { return status ^= 0x80; });
+    std::vector<APUWrite> writes;
+    int cycle = 0;
+    auto record = [&](std::uint16_t address, std::uint8_t value) {
+        writes.push_back({ cycle, address, value });
+        apu.write(address, value);
+    };
+    for (int reg = SQ1_VOL; reg <= DMC_LEN; reg++)
+        bus.set_write_callback(static_cast<IORegisters>(reg), [&, reg](std::uint8_t value) { record(reg, value); });
+    bus.set_write_callback(SND_CHN, [&](std::uint8_t value) { record(SND_CHN, value); });
+    bus.set_write_callback(JOY2, [&](std::uint8_t value) { record(JOY2, value); });
+    bus.set_read_callback(SND_CHN, [&] { return apu.get_status(); });
+    cpu.reset(bus);
+    for (int frame = 0; frame < frames; frame++) {
+        for (int end = cycle + Emulator::CYCLES_PER_FRAME; cycle < end; cycle++) {
+            cpu.cycle(bus);
+            apu.cycle(bus);
+            if (apu.is_interrupting() && !cpu.is_interrupt_masked())
+                cpu.interrupt(bus, CPU::IRQ_INTERRUPT);
+        }
+        cpu.interrupt(bus, CPU::NMI_INTERRUPT);
+        apu.end_frame();
+    }
+
+    APU synthesizer;
+    synthesizer.set_output_suppressed(false);
+    AudioRing& ring = synthesizer.get_ring();
+    std::vector<std::int16_t> samples(ring.capacity());
+    std::size_t next = 0;
+    return time_ns([&] {
+        for (int frame = 0, replayed = 0; frame < frames; frame++) {
+            for (int end = replayed + Emulator::CYCLES_PER_FRAME; replayed < end; replayed++) {
+                for (; next < writes.size() && writes[next].cycle == replayed; next++)
+                    synthesizer.write(writes[next].address, writes[next].value);
+                synthesizer.cycle(bus);
+            }
+            synthesizer.end_frame();
+            // take the samples as the host's audio thread would
+            ring.pop(samples.data(), samples.size());
+        }
+    }) / frames;
+}
+
+/// Fill the PPU with a busy scene drawn from the ROM's tiles.
+static void draw_scene(PPU& ppu, PictureBus& picture_bus) {
+    // name tables and attributes, then palettes
+    ppu.set_data_address(0x20);
+    ppu.set_data_address(0x00);
+    for (int i = 0; i < 0x1000; i++)
+        ppu.set_data(picture_bus, i * 7);
+    ppu.set_data_address(0x3f);
+    ppu.set_data_address(0x00);
+    for (int i = 0; i < 0x20; i++)
+        ppu.set_data(picture_bus, i * 3);
+    // 8 rows of 8 sprites, the most a line shows
+    ppu.set_OAM_address(0);
+    for (int sprite = 0; sprite < 64; sprite++) {
+        ppu.set_OAM_data((sprite / 8) * 28);
+        ppu.set_OAM_data(sprite);
+        ppu.set_OAM_data(sprite & 0x3);
+        ppu.set_OAM_data((sprite % 8) * 30);
+    }
+    // 8x16 sprites, background from $1000, then show everything
+    ppu.control(0x30);
+    ppu.set_scroll(0);
+    ppu.set_scroll(0);
+    ppu.set_mask(0x1e);
+}
+
+/// Time the PPU rendering alone.
+///
+/// @return the nanoseconds per scanline
+///
+static double time_ppu(Cartridge& cartridge, int frames) {
+    PictureBus picture_bus;
+    PPU ppu;
+    auto mapper = Mapper::create(cartridge, [&] { picture_bus.update_mirroring(); }, [] { });
+    picture_bus.set_mapper(mapper.get());
+    ppu.set_interrupt_callback([] { });
+    ppu.reset();
+    draw_scene(ppu, picture_bus);
+    double elapsed = time_ns([&] {
+        for (int cycle = 0; cycle < frames * PPU_CYCLES_PER_FRAME; cycle++)
+            ppu.cycle(picture_bus);
+    });
+    return elapsed / (frames * 262.0);
+}
+
+/// Time reads through the mapper from both buses.
+///
+/// @return the nanoseconds per CPU read, with the nanoseconds per PPU read in
+///         chr_read
+///
+static double time_mapper(Cartridge& cartridge, double& chr_read) {
+    MainBus bus;
+    PictureBus picture_bus;
+    auto mapper = Mapper::create(cartridge, [&] { picture_bus.update_mirroring(); }, [] { });
+    bus.set_mapper(mapper.get());
+    picture_bus.set_mapper(mapper.get());
+    std::uint32_t sum = 0;
+    // step by an odd stride so reads hop between pages
+    double prg_read = time_ns([&] {
+        for (int i = 0; i < MAPPER_READS; i++)
+            sum += bus.read(0x8000 | ((i * 0x101) & 0x7fff));
+    }) / MAPPER_READS;
+    chr_read = time_ns([&] {
+        for (int i = 0; i < MAPPER_READS; i++)
+            sum += picture_bus.read((i * 0x101) & 0x1fff);
+    }) / MAPPER_READS;
+    sink = sum;
+    return prg_read;
+}
+
+/// Time lanes of a ROM running headless in a lockstep engine, then as many
+/// emulators stepped in turn, both with the same input.
+///
+/// @return the frames per second of every lane together in lockstep, with
+///         those of the emulators in turn in scalar
+///
+static double time_lockstep(const std::string& rom, int frames, int lanes, double& scalar) {
+    std::vector<std::unique_ptr<Emulator>> emulators;
+    for (int i = 0; i < 2 * lanes; i++) {
+        emulators.push_back(std::make_unique<Emulator>(rom));
+        emulators.back()->reset();
+        emulators.back()->set_headless(true);
+    }
+    std::vector<Emulator*> engine_lanes;
+    for (int lane = 0; lane < lanes; lane++)
+        engine_lanes.push_back(emulators[lane].get());
+    LockstepEngine engine(engine_lanes);
+    double elapsed = time_ns([&] {
+        for (int frame = 0; frame < frames; frame++) {
+            for (int lane = 0; lane < lanes; lane++)
+                emulators[lane]->get_controller(0)[0] = frame * 7;
+            engine.step();
+        }
+    });
+    double scalar_elapsed = time_ns([&] {
+        for (int frame = 0; frame < frames; frame++) {
+            for (int lane = lanes; lane < 2 * lanes; lane++) {
+                emulators[lane]->get_controller(0)[0] = frame * 7;
+                emulators[lane]->step();
+            }
+        }
+    });
+    scalar = 1e9 * lanes * frames / scalar_elapsed;
+    return 1e9 * lanes * frames / elapsed;
+}
+
+bool run_benchmark(const std::string& rom, int frames, int repeats, int lanes, BenchmarkResult& result, std::string& error) {
+    Cartridge cartridge;
+    RomError load_error = cartridge.loadFromFile(rom);
+    if (load_error != ROM_OK) {
+        error = describe_rom_error(load_error);
+        return false;
+    }
+    if (!Mapper::isSupported(cartridge.getMapper())) {
+        error = "unsupported mapper " + std::to_string(cartridge.getMapper());
+        return false;
+    }
+    constexpr double NONE = std::numeric_limits<double>::infinity();
+    double frame = NONE, instruction = NONE, scanline = NONE, apu_frame = NONE, prg_read = NONE, chr_read = NONE, scale = NONE;
+    double lockstep = 0, scalar = 0;
+    // the best run is the one least disturbed by the rest of the system
+    for (int run = 0; run < repeats; run++) {
+        double run_scale, run_chr_read;
+        frame = std::min(frame, time_emulator(rom, frames, run_scale));
+        scale = std::min(scale, run_scale);
+        instruction = std::min(instruction, time_cpu(cartridge, frames));
+        scanline = std::min(scanline, time_ppu(cartridge, frames));
+        apu_frame = std::min(apu_frame, time_apu(cartridge, frames));
+        prg_read = std::min(prg_read, time_mapper(cartridge, run_chr_read));
+        chr_read = std::min(chr_read, run_chr_read);
+        if (lanes > 0) {
+            double run_scalar;
+            lockstep = std::max(lockstep, time_lockstep(rom, frames, lanes, run_scalar));
+            scalar = std::max(scalar, run_scalar);
+        }
+    }
+    result.rom = rom;
+    result.frames_per_second = 1e9 / frame;
+    result.ns_per_instruction = instruction;
+    result.ns_per_scanline = scanline;
+    result.ns_per_apu_frame = apu_frame;
+    result.ns_per_prg_read = prg_read;
+    result.ns_per_chr_read = chr_read;
+    result.ns_per_scale = scale;
+    result.lockstep_lane_frames_per_second = lockstep;
+    result.scalar_lane_frames_per_second = scalar;
+    return true;
+}
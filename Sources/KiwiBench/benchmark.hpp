@@ -0,0 +1,75 @@
+#pragma once
+
+#include <string>
+
+/// The timings of a ROM, each the best of the repeated runs.
+struct BenchmarkResult {
+    /// the path to the ROM
+    std::string rom;
+    /// the frames per second of the whole emulator running headless
+    double frames_per_second;
+    /// the nanoseconds per instruction of the CPU alone
+    double ns_per_instruction;
+    /// the nanoseconds per scanline of the PPU alone, rendering
+    double ns_per_scanline;
+    /// the nanoseconds per frame of the APU alone, synthesizing
+    double ns_per_apu_frame;
+    /// the nanoseconds per CPU read of $8000-$FFFF through the mapper
+    double ns_per_prg_read;
+    /// the nanoseconds per PPU read of $0000-$1FFF through the mapper
+    double ns_per_chr_read;
+    /// the nanoseconds per xBRZ scale of a frame
+    double ns_per_scale;
+    /// the frames per second of every lane together in a lockstep engine,
+    /// 0 unless lanes were asked for
+    double lockstep_lane_frames_per_second;
+    /// the frames per second of as many emulators stepped in turn, 0 unless
+    /// lanes were asked for
+    double scalar_lane_frames_per_second;
+};
+
+/// A metric of a benchmark result.
+struct BenchmarkMetric {
+    /// the name of the metric in reports
+    const char* name;
+    /// the member of the result holding the metric
+    double BenchmarkResult::* value;
+    /// whether larger values are faster
+    bool is_higher_better;
+};
+
+/// The metrics of a result, in report order
+constexpr BenchmarkMetric BENCHMARK_METRICS[] = {
+    { "frames_per_second", &BenchmarkResult::frames_per_second, true },
+    { "ns_per_instruction", &BenchmarkResult::ns_per_instruction, false },
+    { "ns_per_scanline", &BenchmarkResult::ns_per_scanline, false },
+    { "ns_per_apu_frame", &BenchmarkResult::ns_per_apu_frame, false },
+    { "ns_per_prg_read", &BenchmarkResult::ns_per_prg_read, false },
+    { "ns_per_chr_read", &BenchmarkResult::ns_per_chr_read, false },
+    { "ns_per_scale", &BenchmarkResult::ns_per_scale, false },
+    { "lockstep_lane_frames_per_second", &BenchmarkResult::lockstep_lane_frames_per_second, true },
+    { "scalar_lane_frames_per_second", &BenchmarkResult::scalar_lane_frames_per_second, true },
+};
+
+/// Benchmark a ROM.
+///
+/// The emulator runs headless from power on for the given frames. The CPU,
+/// the PPU and the APU then each run the same number of frames alone, so
+/// their cost isn't hidden in the cost of the whole machine: the CPU with the
+/// PPU status faked and an NMI every frame, the PPU rendering a busy scene
+/// drawn from the ROM's tiles with 8 sprites on a line, and the APU
+/// synthesizing the sound the ROM played, which headless runs skip.
+///
+/// With lanes, that many emulators of the ROM also run headless in a
+/// LockstepEngine and then stepped in turn, to weigh the engine against the
+/// plain loop it replaces.
+///
+/// @param rom the path to the ROM to run
+/// @param frames the number of frames to run each part for
+/// @param repeats the number of runs to take the best timing of
+/// @param lanes the number of lanes to time in lockstep, 0 to skip them
+/// @param result the timings of the ROM, if it was benchmarked
+/// @param error the reason the ROM couldn't be run, if it couldn't
+/// @return true if the ROM was benchmarked
+///
+bool run_benchmark(const std::string& rom, int frames, int repeats, int lanes, BenchmarkResult& result, std::string& error);
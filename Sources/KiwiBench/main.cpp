@@ -0,0 +1,116 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+#include "lockstep/lockstep.hpp"
+#include "report.hpp"
+#include "stress_roms.hpp"
+
+/// Print the usage of the benchmark.
+static void print_usage(const char* program) {
+    std::cerr << "usage: " << program << " [options] rom.nes...\n"
+        "\n"
+        "Run each ROM headless and report the speed of the emulator as JSON.\n"
+        "\n"
+        "  --frames N       the frames to run each ROM for (default 600)\n"
+        "  --repeat N       the runs to take the best timing of (default 3)\n"
+        "  --json FILE      write the report to FILE instead of stdout\n"
+        "  --baseline FILE  compare against a report, failing on regressions\n"
+        "  --tolerance PCT  the percent a metric may slow down by (default 5)\n"
+        "  --generate DIR   write the stress ROMs into DIR and run them too\n"
+        "  --lockstep N     also time N lanes in lockstep against N emulators\n"
+        "\n"
+        "The stress ROMs:\n";
+    for (const StressRom& rom : get_stress_roms())
+        std::cerr << "  " << std::left << std::setw(20) << rom.name << rom.description << '\n';
+}
+
+int main(int argc, char** argv) {
+    int frames = 600;
+    int repeats = 3;
+    int lanes = 0;
+    double tolerance = 5;
+    std::string json_path;
+    std::string baseline_path;
+    std::string generate_path;
+    std::vector<std::string> roms;
+    for (int i = 1; i < argc; i++) {
+        const char* option = argv[i];
+        bool has_value = i + 1 < argc;
+        if (std::strcmp(option, "--frames") == 0 && has_value)
+            frames = std::atoi(argv[++i]);
+        else if (std::strcmp(option, "--repeat") == 0 && has_value)
+            repeats = std::atoi(argv[++i]);
+        else if (std::strcmp(option, "--json") == 0 && has_value)
+            json_path = argv[++i];
+        else if (std::strcmp(option, "--baseline") == 0 && has_value)
+            baseline_path = argv[++i];
+        else if (std::strcmp(option, "--tolerance") == 0 && has_value)
+            tolerance = std::atof(argv[++i]);
+        else if (std::strcmp(option, "--generate") == 0 && has_value)
+            generate_path = argv[++i];
+        else if (std::strcmp(option, "--lockstep") == 0 && has_value)
+            lanes = std::atoi(argv[++i]);
+        else if (option[0] == '-') {
+            print_usage(argv[0]);
+            return 2;
+        }
+        else
+            roms.push_back(option);
+    }
+    if (!generate_path.empty()) {
+        std::string error;
+        if (!write_stress_roms(generate_path, roms, error)) {
+            std::cerr << error << '\n';
+            return 2;
+        }
+    }
+    if (roms.empty() || frames <= 0 || repeats <= 0 || tolerance < 0 || lanes < 0 || lanes > LockstepEngine::MAX_LANES) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    // read the baseline first so a bad path fails before the long run
+    std::vector<BenchmarkResult> baseline;
+    if (!baseline_path.empty()) {
+        std::ifstream file(baseline_path);
+        if (!file || !read_report(file, baseline)) {
+            std::cerr << baseline_path << ": not a benchmark report\n";
+            return 2;
+        }
+    }
+
+    std::vector<BenchmarkResult> results;
+    bool is_failed = false;
+    for (const std::string& rom : roms) {
+        BenchmarkResult result;
+        std::string error;
+        if (run_benchmark(rom, frames, repeats, lanes, result, error))
+            results.push_back(result);
+        else {
+            std::cerr << rom << ": " << error << '\n';
+            is_failed = true;
+        }
+    }
+
+    if (json_path.empty())
+        write_report(std::cout, frames, results);
+    else {
+        std::ofstream file(json_path);
+        write_report(file, frames, results);
+        if (!file) {
+            std::cerr << json_path << ": couldn't write the report\n";
+            return 2;
+        }
+    }
+
+    // the comparison goes to stderr to keep stdout a valid report
+    if (!baseline_path.empty() && compare_results(std::cerr, results, baseline, tolerance / 100) > 0)
+        return 1;
+    return is_failed ? 2 : 0;
+}
@@ -0,0 +1,234 @@
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iterator>
+#include <utility>
+
+#include "report.hpp"
+
+/// Write a string as a JSON string literal.
+static void write_string(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char character : value) {
+        if (character == '"' || character == '\\')
+            out << '\\' << character;
+        else if (static_cast<unsigned char>(character) < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned char>(character));
+            out << escape;
+        }
+        else
+            out << character;
+    }
+    out << '"';
+}
+
+void write_report(std::ostream& out, int frames, const std::vector<BenchmarkResult>& results) {
+    out << "{\n  \"frames\": " << frames << ",\n  \"results\": [";
+    for (std::size_t i = 0; i < results.size(); i++) {
+        out << (i ? ",\n" : "\n") << "    {\n      \"rom\": ";
+        write_string(out, results[i].rom);
+        for (const BenchmarkMetric& metric : BENCHMARK_METRICS)
+            out << ",\n      \"" << metric.name << "\": " << results[i].*metric.value;
+        out << "\n    }";
+    }
+    out << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+/// A reader of the subset of JSON the reports are written in.
+class ReportReader {
+
+private:
+    /// the text of the report
+    std::string text;
+    /// the position of the next character to read
+    std::size_t position;
+
+    /// Skip the whitespace before the next token.
+    void skip_space() {
+        while (position < text.size() && std::isspace(static_cast<unsigned char>(text[position])))
+            position++;
+    }
+
+    /// Consume a character if it's next.
+    bool consume(char character) {
+        skip_space();
+        if (position < text.size() && text[position] == character) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    /// Read a string literal.
+    bool read_string(std::string& value) {
+        if (!consume('"'))
+            return false;
+        value.clear();
+        while (position < text.size() && text[position] != '"') {
+            char character = text[position++];
+            if (character == '\\') {
+                if (position >= text.size())
+                    return false;
+                character = text[position++];
+                if (character == 'u') {
+                    if (position + 4 > text.size())
+                        return false;
+                    character = static_cast<char>(std::stoi(text.substr(position, 4), nullptr, 16));
+                    position += 4;
+                }
+                else if (character == 'n') character = '\n';
+                else if (character == 't') character = '\t';
+            }
+            value += character;
+        }
+        return consume('"');
+    }
+
+    /// Read a number.
+    bool read_number(double& value) {
+        skip_space();
+        const char* start = text.c_str() + position;
+        char* end;
+        value = std::strtod(start, &end);
+        position += end - start;
+        return end != start;
+    }
+
+    /// Read the members of an object, handing each key to a function that
+    /// reads its value.
+    template <typename Function>
+    bool read_object(Function read_member) {
+        if (!consume('{'))
+            return false;
+        if (consume('}'))
+            return true;
+        do {
+            std::string key;
+            if (!read_string(key) || !consume(':') || !read_member(key))
+                return false;
+        } while (consume(','));
+        return consume('}');
+    }
+
+    /// Read the elements of an array with a function that reads each one.
+    template <typename Function>
+    bool read_array(Function read_element) {
+        if (!consume('['))
+            return false;
+        if (consume(']'))
+            return true;
+        do {
+            if (!read_element())
+                return false;
+        } while (consume(','));
+        return consume(']');
+    }
+
+    /// Read a value that isn't needed.
+    bool skip_value() {
+        skip_space();
+        if (position >= text.size())
+            return false;
+        switch (text[position]) {
+        case '{': return read_object([&](const std::string&) { return skip_value(); });
+        case '[': return read_array([&] { return skip_value(); });
+        case '"': { std::string value; return read_string(value); }
+        case 't': return skip_word("true");
+        case 'f': return skip_word("false");
+        case 'n': return skip_word("null");
+        default: { double value; return read_number(value); }
+        }
+    }
+
+    /// Skip a literal word.
+    bool skip_word(const std::string& word) {
+        if (text.compare(position, word.size(), word) != 0)
+            return false;
+        position += word.size();
+        return true;
+    }
+
+    /// Read a result, leaving the metrics it lacks at NaN.
+    bool read_result(BenchmarkResult& result) {
+        for (const BenchmarkMetric& metric : BENCHMARK_METRICS)
+            result.*metric.value = NAN;
+        return read_object([&](const std::string& key) {
+            if (key == "rom")
+                return read_string(result.rom);
+            for (const BenchmarkMetric& metric : BENCHMARK_METRICS) {
+                if (key == metric.name)
+                    return read_number(result.*metric.value);
+            }
+            return skip_value();
+        });
+    }
+
+public:
+    /// Initialize a new reader over the text of a report.
+    explicit ReportReader(std::string text) : text(std::move(text)), position(0) { };
+
+    /// Read the results of the report.
+    bool read(std::vector<BenchmarkResult>& results) {
+        bool is_valid = read_object([&](const std::string& key) {
+            if (key != "results")
+                return skip_value();
+            return read_array([&] {
+                results.emplace_back();
+                return read_result(results.back());
+            });
+        });
+        skip_space();
+        return is_valid && position == text.size();
+    }
+
+};
+
+bool read_report(std::istream& in, std::vector<BenchmarkResult>& results) {
+    std::string text{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    return ReportReader(std::move(text)).read(results);
+}
+
+/// Return the file name of a ROM path, the key results are matched on.
+static std::string get_rom_name(const std::string& rom) {
+    return std::filesystem::path(rom).filename().string();
+}
+
+int compare_results(std::ostream& out, const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkResult>& baseline, double tolerance) {
+    int regressions = 0;
+    for (const BenchmarkResult& result : results) {
+        // the baseline may have been run from another directory
+        std::string name = get_rom_name(result.rom);
+        const BenchmarkResult* base = nullptr;
+        for (const BenchmarkResult& candidate : baseline) {
+            if (get_rom_name(candidate.rom) == name)
+                base = &candidate;
+        }
+        // a ROM that can't be compared can't pass the gate either
+        if (base == nullptr) {
+            out << result.rom << ": not in the baseline  REGRESSION\n";
+            regressions++;
+            continue;
+        }
+        out << result.rom << ":\n";
+        for (const BenchmarkMetric& metric : BENCHMARK_METRICS) {
+            double before = base->*metric.value;
+            double after = result.*metric.value;
+            // a metric one of the runs didn't measure is 0
+            if (!std::isfinite(before) || before <= 0 || after <= 0)
+                continue;
+            // the change in speed, positive when faster whichever way the
+            // metric is measured
+            double speedup = metric.is_higher_better ? after / before - 1 : before / after - 1;
+            bool is_regression = speedup < -tolerance;
+            regressions += is_regression;
+            char line[128];
+            std::snprintf(line, sizeof(line), "  %-20s %12.3f -> %12.3f  %+7.1f%%%s\n",
+                metric.name, before, after, speedup * 100, is_regression ? "  REGRESSION" : "");
+            out << line;
+        }
+    }
+    return regressions;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "benchmark.hpp"
+
+/// Write benchmark results as a JSON report.
+///
+/// @param out the stream to write the report to
+/// @param frames the number of frames each ROM ran for
+/// @param results the results to report
+///
+void write_report(std::ostream& out, int frames, const std::vector<BenchmarkResult>& results);
+
+/// Read the results of a JSON report written by write_report.
+///
+/// Keys the benchmark doesn't know are skipped, so reports from newer or
+/// older versions still compare on the metrics they share.
+///
+/// @param in the stream to read the report from
+/// @param results the results read from the report
+/// @return true if the report was read, false if it isn't valid JSON
+///
+bool read_report(std::istream& in, std::vector<BenchmarkResult>& results);
+
+/// Compare results against a baseline, printing the change of each metric.
+///
+/// ROMs are matched on their file name, so the baseline may be run from
+/// another directory. A metric regresses when it's slower than the baseline
+/// by more than the tolerance, and a ROM missing from the baseline counts as
+/// a regression. Metrics either run didn't measure are skipped.
+///
+/// @param out the stream to print the comparison to
+/// @param results the results of this run
+/// @param baseline the results to compare against
+/// @param tolerance the fraction a metric may slow down by, e.g. 0.05
+/// @return the number of metrics that regressed and ROMs that are missing
+///
+int compare_results(std::ostream& out, const std::vector<BenchmarkResult>& results, const std::vector<BenchmarkResult>& baseline, double tolerance);
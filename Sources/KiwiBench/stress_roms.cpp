@@ -0,0 +1,456 @@
+#include <fstream>
+
+#include "assembler.hpp"
+#include "bus/bus.hpp"
+#include "stress_roms.hpp"
+
+/// Assemble an iNES image around a program.
+///
+/// Each 16KB of PRG ROM ends with the program, so it runs whichever bank the
+/// mapper powers on with, and starts with its 8KB bank number repeated, so
+/// reads through the mapper show which bank is in. The CHR ROM is filled
+/// with distinct tiles with every color in them.
+///
+/// @param program the assembled program of $E000-$FFFF
+/// @param mapper the iNES mapper number
+/// @param prg_banks the number of 16KB PRG ROM banks
+/// @param chr_banks the number of 8KB CHR ROM banks, 0 for CHR RAM
+/// @return the iNES image
+///
+static std::vector<std::uint8_t> make_image(const Assembler& program, int mapper, int prg_banks, int chr_banks) {
+    std::vector<std::uint8_t> image = {
+        'N', 'E', 'S', 0x1a,
+        static_cast<std::uint8_t>(prg_banks),
+        static_cast<std::uint8_t>(chr_banks),
+        // vertical mirroring, for boards that don't switch it
+        static_cast<std::uint8_t>(((mapper & 0x0f) << 4) | 0x01),
+        static_cast<std::uint8_t>(mapper & 0xf0),
+        0, 0, 0, 0, 0, 0, 0, 0
+    };
+    for (int bank = 0; bank < prg_banks; bank++) {
+        image.insert(image.end(), 0x2000, static_cast<std::uint8_t>(bank * 2));
+        image.insert(image.end(), program.get_image().begin(), program.get_image().end());
+    }
+    for (int tile = 0; tile < chr_banks * 0x200; tile++) {
+        for (int plane = 0; plane < 2; plane++) {
+            for (int row = 0; row < 8; row++)
+                image.push_back(static_cast<std::uint8_t>(((tile * 0x1d + row * 0x33) >> plane) ^ (plane ? 0xa5 : 0)));
+        }
+    }
+    return image;
+}
+
+/// Assemble the power on sequence: interrupts off, the stack set up, the
+/// PPU and the APU interrupts off, then two waits for vertical blank while
+/// the PPU warms up.
+static void power_on(Assembler& a) {
+    a.op(SEI);
+    a.op(CLD);
+    // the frame counter interrupts from power on until it's told not to
+    a.op(LDA_IMM, 0x40);
+    a.op16(STA_ABS, 0x4017);
+    a.op(LDX_IMM, 0xff);
+    a.op(TXS);
+    a.op(INX);
+    a.op16(STX_ABS, PPUCTRL);
+    a.op16(STX_ABS, PPUMASK);
+    a.op16(STX_ABS, DMC_FREQ);
+    for (int frame = 0; frame < 2; frame++) {
+        std::uint16_t wait = a.here();
+        a.op16(BIT_ABS, PPUSTATUS);
+        a.branch(BPL, wait);
+    }
+}
+
+/// Assemble the fill of the palettes and all four name tables, tile numbers
+/// and attributes counting up, while rendering is off.
+static void draw_background(Assembler& a) {
+    a.op(LDA_IMM, 0x3f);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t palette = a.here();
+    a.op(TXA);
+    a.op16(STA_ABS, PPUDATA);
+    a.op(INX);
+    a.op(CPX_IMM, 0x20);
+    a.branch(BNE, palette);
+
+    a.op(LDA_IMM, 0x20);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(TAX);
+    a.op(LDY_IMM, 0x10);
+    std::uint16_t name_tables = a.here();
+    a.op(TXA);
+    a.op16(STA_ABS, PPUDATA);
+    a.op(INX);
+    a.branch(BNE, name_tables);
+    a.op(DEY);
+    a.branch(BNE, name_tables);
+}
+
+/// Assemble turning rendering on from the top left of the first name table.
+static void show(Assembler& a, std::uint8_t control, std::uint8_t mask) {
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op(LDA_IMM, control);
+    a.op16(STA_ABS, PPUCTRL);
+    a.op(LDA_IMM, mask);
+    a.op16(STA_ABS, PPUMASK);
+}
+
+/// Tight arithmetic, logic, shift, indexed memory and subroutine loops with
+/// the PPU off.
+static std::vector<std::uint8_t> build_alu() {
+    Assembler a;
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+    std::uint16_t subroutine = a.here();
+    a.op(PHA);
+    a.op(TYA);
+    a.op(EOR_IMM, 0x3c);
+    a.op(TAY);
+    a.op(PLA);
+    a.op(RTS);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    std::uint16_t loop = a.here();
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t inner = a.here();
+    a.op(TXA);
+    a.op(CLC);
+    a.op(ADC_ZP, 0x00);
+    a.op(STA_ZP, 0x00);
+    a.op(EOR_IMM, 0x5a);
+    a.op(ASL_A);
+    a.op(ROL_ZP, 0x01);
+    a.op(SEC);
+    a.op(SBC_IMM, 0x13);
+    a.op(AND_IMM, 0x7f);
+    a.op(ORA_IMM, 0x01);
+    a.op(LSR_A);
+    a.op16(STA_ABSX, 0x0200);
+    a.op16(ADC_ABSX, 0x0300);
+    a.op16(INC_ABSX, 0x0400);
+    a.op(TAY);
+    a.op16(JSR, subroutine);
+    a.op(DEY);
+    a.op(INX);
+    a.branch(BNE, inner);
+    a.op(INC_ZP, 0x02);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(ignore, reset, ignore);
+    return make_image(a, 0, 2, 1);
+}
+
+/// 64 sprites in 8 rows of 8, the most the PPU shows on a line, moved and
+/// copied in by DMA every frame.
+static std::vector<std::uint8_t> build_sprites() {
+    Assembler a;
+    // the sprites start 32 pixels apart in rows 28 lines apart
+    const std::uint16_t sprites = 0xf000;
+    a.org(sprites);
+    for (int sprite = 0; sprite < 64; sprite++) {
+        a.byte((sprite / 8) * 28 + 8);
+        a.byte(sprite);
+        a.byte(sprite & 0x3);
+        a.byte((sprite % 8) * 32);
+    }
+    a.org(Assembler::ORIGIN);
+
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+    std::uint16_t nmi = a.here();
+    a.op(PHA);
+    a.op(TXA);
+    a.op(PHA);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, OAMADDR);
+    a.op(LDA_IMM, 0x02);
+    a.op16(STA_ABS, OAMDMA);
+    // slide every sprite right a pixel for the next frame
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t slide = a.here();
+    a.op16(INC_ABSX, 0x0203);
+    a.op(INX);
+    a.op(INX);
+    a.op(INX);
+    a.op(INX);
+    a.branch(BNE, slide);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op(PLA);
+    a.op(TAX);
+    a.op(PLA);
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    draw_background(a);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t copy = a.here();
+    a.op16(LDA_ABSX, sprites);
+    a.op16(STA_ABSX, 0x0200);
+    a.op(INX);
+    a.branch(BNE, copy);
+    // NMI on, sprites from $1000
+    show(a, 0x88, 0x1e);
+    std::uint16_t idle = a.here();
+    a.op16(JMP_ABS, idle);
+
+    a.vectors(nmi, reset, ignore);
+    return make_image(a, 0, 2, 1);
+}
+
+/// PPUSCROLL and PPUCTRL rewritten every few CPU cycles while rendering, so
+/// every scanline scrolls and switches name and pattern tables mid line.
+static std::vector<std::uint8_t> build_scroll() {
+    Assembler a;
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    draw_background(a);
+    show(a, 0x00, 0x1e);
+    a.op(LDX_IMM, 0x00);
+    a.op(LDY_IMM, 0x00);
+    std::uint16_t loop = a.here();
+    a.op16(STX_ABS, PPUSCROL);
+    a.op16(STY_ABS, PPUSCROL);
+    // the name table and background pattern table, the NMI left off
+    a.op(TXA);
+    a.op(AND_IMM, 0x13);
+    a.op16(STA_ABS, PPUCTRL);
+    a.op(INX);
+    a.op(DEY);
+    a.op(DEY);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(ignore, reset, ignore);
+    return make_image(a, 0, 2, 1);
+}
+
+/// Assemble a write of A to an MMC1 register, a bit at a time.
+static void write_MMC1(Assembler& a, std::uint16_t address) {
+    for (int bit = 0; bit < 5; bit++) {
+        a.op16(STA_ABS, address);
+        if (bit < 4)
+            a.op(LSR_A);
+    }
+}
+
+/// The MMC1 switching its PRG bank and both 4KB CHR banks through the
+/// serial port on every pass of a loop, reading the switched bank in.
+static std::vector<std::uint8_t> build_MMC1() {
+    Assembler a;
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    // reset the shift register, which also fixes the last bank at $C000
+    a.op(LDA_IMM, 0x80);
+    a.op16(STA_ABS, 0x8000);
+    // 4KB CHR banks, 16KB PRG banks switched at $8000, vertical mirroring
+    a.op(LDA_IMM, 0x1e);
+    write_MMC1(a, 0x8000);
+    draw_background(a);
+    // background from $1000
+    show(a, 0x10, 0x1e);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t loop = a.here();
+    a.op(TXA);
+    a.op(AND_IMM, 0x07);
+    write_MMC1(a, 0xe000);
+    a.op16(LDA_ABS, 0x8000);
+    a.op(STA_ZP, 0x00);
+    a.op(TXA);
+    a.op(AND_IMM, 0x07);
+    write_MMC1(a, 0xa000);
+    a.op(TXA);
+    a.op(EOR_IMM, 0xff);
+    a.op(AND_IMM, 0x07);
+    write_MMC1(a, 0xc000);
+    a.op(INX);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(ignore, reset, ignore);
+    return make_image(a, 1, 8, 4);
+}
+
+/// The MMC3 switching all eight bank registers on every pass of a loop,
+/// with its scanline counter interrupting every 20 lines.
+static std::vector<std::uint8_t> build_MMC3() {
+    Assembler a;
+    std::uint16_t nmi = a.here();
+    a.op(PHA);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op16(STA_ABS, PPUSCROL);
+    a.op(PLA);
+    a.op(RTI);
+    // acknowledge the interrupt and enable the next one
+    std::uint16_t irq = a.here();
+    a.op(PHA);
+    a.op16(STA_ABS, 0xe000);
+    a.op16(STA_ABS, 0xe001);
+    a.op(PLA);
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, 0xa000);
+    draw_background(a);
+    a.op(LDA_IMM, 20);
+    a.op16(STA_ABS, 0xc000);
+    a.op16(STA_ABS, 0xc001);
+    a.op16(STA_ABS, 0xe001);
+    a.op(CLI);
+    // NMI on, sprites from $1000 so A12 rises once a line
+    show(a, 0x88, 0x1e);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t loop = a.here();
+    a.op(LDY_IMM, 0x00);
+    std::uint16_t select = a.here();
+    a.op16(STY_ABS, 0x8000);
+    a.op(TXA);
+    a.op16(STA_ABS, 0x8001);
+    a.op(INY);
+    a.op(CPY_IMM, 0x08);
+    a.branch(BNE, select);
+    a.op16(LDA_ABS, 0x8000);
+    a.op(STA_ZP, 0x00);
+    a.op16(LDA_ABS, 0xa000);
+    a.op(STA_ZP, 0x01);
+    a.op(INX);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(nmi, reset, irq);
+    return make_image(a, 4, 8, 16);
+}
+
+/// Tiles streamed into CHR RAM through PPUDATA without a break, with
+/// rendering off as while a game loads the tiles of its next screen.
+static std::vector<std::uint8_t> build_CHR_RAM() {
+    Assembler a;
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    draw_background(a);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t loop = a.here();
+    a.op(TXA);
+    a.op(STA_ZP, 0x00);
+    a.op(AND_IMM, 0x1f);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(LDA_IMM, 0x00);
+    a.op16(STA_ABS, PPUADDR);
+    a.op(LDY_IMM, 0x00);
+    std::uint16_t upload = a.here();
+    a.op(TYA);
+    a.op(EOR_ZP, 0x00);
+    a.op16(STA_ABS, PPUDATA);
+    a.op(INY);
+    a.branch(BNE, upload);
+    a.op(INX);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(ignore, reset, ignore);
+    return make_image(a, 0, 2, 0);
+}
+
+/// Every APU channel sounding with the pitch of each rewritten on every pass
+/// of a loop, the delta modulation channel looping a sample from the code.
+static std::vector<std::uint8_t> build_APU() {
+    Assembler a;
+    std::uint16_t ignore = a.here();
+    a.op(RTI);
+
+    std::uint16_t reset = a.here();
+    power_on(a);
+    // pulse 1 at a constant volume sweeping down, pulse 2 with a looping
+    // envelope, both holding their length counters
+    a.op(LDA_IMM, 0xbf);
+    a.op16(STA_ABS, SQ1_VOL);
+    a.op(LDA_IMM, 0x8b);
+    a.op16(STA_ABS, SQ1_SWEEP);
+    a.op(LDA_IMM, 0x60);
+    a.op16(STA_ABS, SQ2_VOL);
+    a.op(LDA_IMM, 0xff);
+    a.op16(STA_ABS, TRI_LINEAR);
+    a.op(LDA_IMM, 0x3f);
+    a.op16(STA_ABS, NOISE_VOL);
+    // the fastest rate, looping the 4KB from $E000 with its interrupt off
+    a.op(LDA_IMM, 0x4f);
+    a.op16(STA_ABS, DMC_FREQ);
+    a.op(LDA_IMM, 0x80);
+    a.op16(STA_ABS, DMC_START);
+    a.op(LDA_IMM, 0xff);
+    a.op16(STA_ABS, DMC_LEN);
+    a.op(LDA_IMM, 0x1f);
+    a.op16(STA_ABS, SND_CHN);
+    a.op(LDX_IMM, 0x00);
+    std::uint16_t loop = a.here();
+    a.op(TXA);
+    a.op16(STA_ABS, SQ1_LO);
+    a.op(EOR_IMM, 0xff);
+    a.op16(STA_ABS, SQ2_LO);
+    a.op16(STA_ABS, TRI_LO);
+    // the high period bits, reloading the length counters
+    a.op(TXA);
+    a.op(AND_IMM, 0x03);
+    a.op(ORA_IMM, 0xf8);
+    a.op16(STA_ABS, SQ1_HI);
+    a.op16(STA_ABS, SQ2_HI);
+    a.op16(STA_ABS, TRI_HI);
+    a.op16(STA_ABS, NOISE_HI);
+    a.op(TXA);
+    a.op(AND_IMM, 0x8f);
+    a.op16(STA_ABS, NOISE_LO);
+    a.op(INX);
+    a.op16(JMP_ABS, loop);
+
+    a.vectors(ignore, reset, ignore);
+    return make_image(a, 0, 2, 1);
+}
+
+/// The stress ROMs, in the order they are benchmarked
+static const StressRom STRESS_ROMS[] = {
+    { "stress_alu.nes", "CPU arithmetic, logic and memory loops", build_alu },
+    { "stress_sprites.nes", "sprite evaluation of 8 sprites a line, OAM DMA", build_sprites },
+    { "stress_scroll.nes", "mid scanline PPUSCROLL and PPUCTRL writes", build_scroll },
+    { "stress_mmc1.nes", "MMC1 serial bank switching", build_MMC1 },
+    { "stress_mmc3.nes", "MMC3 bank switching and scanline interrupts", build_MMC3 },
+    { "stress_chr_ram.nes", "CHR RAM uploads through PPUDATA", build_CHR_RAM },
+    { "stress_apu.nes", "every APU channel retuned without a break", build_APU },
+};
+
+std::span<const StressRom> get_stress_roms() {
+    return STRESS_ROMS;
+}
+
+bool write_stress_roms(const std::string& directory, std::vector<std::string>& paths, std::string& error) {
+    for (const StressRom& rom : get_stress_roms()) {
+        std::string path = directory + "/" + rom.name;
+        std::vector<std::uint8_t> image = rom.build();
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(image.data()), image.size());
+        if (!file) {
+            error = path + ": couldn't be written";
+            return false;
+        }
+        paths.push_back(path);
+    }
+    return true;
+}
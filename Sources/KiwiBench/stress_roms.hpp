@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+/// A generated ROM exercising one hot path of the emulator.
+///
+/// The ROMs are assembled from scratch, so they can be shipped and run
+/// anywhere, and run the same instructions on every emulator build.
+struct StressRom {
+    /// the file name of the ROM
+    const char* name;
+    /// the path through the emulator the ROM exercises
+    const char* description;
+    /// the function assembling the iNES image of the ROM
+    std::vector<std::uint8_t> (*build)();
+};
+
+/// Return the stress ROMs.
+std::span<const StressRom> get_stress_roms();
+
+/// Write every stress ROM into a directory.
+///
+/// @param directory the existing directory to write the ROMs into
+/// @param paths the paths of the ROMs written
+/// @param error the reason a ROM couldn't be written, if one couldn't
+/// @return true if every ROM was written
+///
+bool write_stress_roms(const std::string& directory, std::vector<std::string>& paths, std::string& error);
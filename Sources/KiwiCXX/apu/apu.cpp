@@ -0,0 +1,509 @@
+#include <algorithm>
+#include <type_traits>
+
+#include "apu/apu.hpp"
+
+/// The values loaded into the length counters
+static const std::uint8_t LENGTH_TABLE[32] = {
+    10, 254, 20, 2, 40, 4, 80, 6, 160, 8, 60, 10, 14, 12, 26, 14,
+    12, 16, 24, 18, 48, 20, 96, 22, 192, 24, 72, 26, 16, 28, 32, 30,
+};
+
+/// The wave sequences of the pulse duty cycles
+static const std::uint8_t DUTY_TABLE[4][8] = {
+    {0, 1, 0, 0, 0, 0, 0, 0},
+    {0, 1, 1, 0, 0, 0, 0, 0},
+    {0, 1, 1, 1, 1, 0, 0, 0},
+    {1, 0, 0, 1, 1, 1, 1, 1},
+};
+
+/// The wave sequence of the triangle channel
+static const std::uint8_t TRIANGLE_TABLE[32] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+};
+
+/// The periods of the noise channel in CPU cycles
+static const std::uint16_t NOISE_PERIODS[16] = {
+    4, 8, 16, 32, 64, 96, 128, 160, 202, 254, 380, 508, 762, 1016, 2034, 4068,
+};
+
+/// The periods of the delta modulation channel in CPU cycles
+static const std::uint16_t DMC_RATES[16] = {
+    428, 380, 340, 320, 286, 254, 226, 214, 190, 160, 142, 128, 106, 84, 72, 54,
+};
+
+/// The CPU cycles from the start of the frame counter's sequence to each of
+/// its steps, for the four and the five step sequence
+static const std::uint32_t SEQUENCE_STEPS[2][5] = {
+    {7457, 14913, 22371, 29829, 29830},
+    {7457, 14913, 22371, 37281, 37282},
+};
+
+/// The largest number of CPU cycles in a frame the output has to hold
+static const std::uint32_t MAX_FRAME_CYCLES = 32768;
+
+/// The CPU cycles a parked timer waits before checking its channel again
+static const std::uint32_t PARKED_CYCLES = 0x80000000;
+/// The CPU cycles beyond which a timer counts as parked, above any period
+static const std::uint32_t MAX_TIMER_CYCLES = 0x10000;
+
+/// Return the output of an envelope.
+static inline std::uint8_t get_volume(const auto& envelope) {
+    return envelope.is_constant ? envelope.volume : envelope.decay;
+}
+
+/// Clock an envelope.
+static inline void clock_envelope(auto& envelope) {
+    if (envelope.is_start) {
+        envelope.is_start = false;
+        envelope.decay = 15;
+        envelope.divider = envelope.volume;
+    }
+    else if (envelope.divider == 0) {
+        envelope.divider = envelope.volume;
+        if (envelope.decay)
+            --envelope.decay;
+        else if (envelope.is_looping)
+            envelope.decay = 15;
+    }
+    else {
+        --envelope.divider;
+    }
+}
+
+void APU::reset() {
+    pulses[0] = pulses[1] = Pulse{};
+    triangle = Triangle{};
+    noise = Noise{};
+    noise.shift = 1;
+    noise.period = NOISE_PERIODS[0];
+    dmc = DMC{};
+    dmc.rate = DMC_RATES[0];
+    dmc.bits_remaining = 8;
+    dmc.is_silent = dmc.is_buffer_empty = true;
+    enabled_channels = 0;
+    // restart the clock so a reset instance matches a new one
+    clock = frame_start = 0;
+    // the channels step on the first cycle, as their timers start expired
+    for (std::uint32_t& timer : timers)
+        timer = clock + 1;
+    sequence_start = clock;
+    sequence_step = 0;
+    timers[FRAME_TIMER] = clock + SEQUENCE_STEPS[0][0];
+    is_five_step = is_interrupt_inhibited = is_frame_interrupting = false;
+    is_changed = true;
+    schedule();
+}
+
+void APU::run_events(MainBus& bus) {
+    for (int i = 0; i < 2; i++) {
+        if (clock != timers[PULSE1_TIMER + i])
+            continue;
+        Pulse& pulse = pulses[i];
+        // the step of a silent or muted channel can't be heard
+        if (pulse.length && pulse.period >= 8) {
+            pulse.step = (pulse.step + 1) & 7;
+            is_changed = true;
+            timers[PULSE1_TIMER + i] = clock + (pulse.period + 1) * 2;
+        }
+        else {
+            timers[PULSE1_TIMER + i] = clock + PARKED_CYCLES;
+        }
+    }
+    if (clock == timers[TRIANGLE_TIMER]) {
+        if (triangle.length && triangle.linear_counter) {
+            triangle.step = (triangle.step + 1) & 31;
+            is_changed = true;
+            timers[TRIANGLE_TIMER] = clock + triangle.period + 1;
+        }
+        else {
+            timers[TRIANGLE_TIMER] = clock + PARKED_CYCLES;
+        }
+    }
+    if (clock == timers[NOISE_TIMER]) {
+        if (noise.length) {
+            std::uint16_t feedback = (noise.shift ^ (noise.shift >> (noise.is_short ? 6 : 1))) & 1;
+            noise.shift = (noise.shift >> 1) | (feedback << 14);
+            is_changed = true;
+            timers[NOISE_TIMER] = clock + noise.period;
+        }
+        else {
+            timers[NOISE_TIMER] = clock + PARKED_CYCLES;
+        }
+    }
+    // the delta modulation channel always runs, its reads are visible
+    if (clock == timers[DMC_TIMER]) {
+        timers[DMC_TIMER] = clock + dmc.rate;
+        clock_DMC();
+    }
+    if (dmc.is_buffer_empty && dmc.bytes_remaining)
+        fill_DMC(bus);
+    if (clock == timers[FRAME_TIMER])
+        clock_sequence();
+    schedule();
+    if (is_changed && !is_output_suppressed)
+        mix();
+}
+
+void APU::schedule() {
+    // wake parked channels that can be heard again
+    if (timers[PULSE1_TIMER] - clock > MAX_TIMER_CYCLES && pulses[0].length && pulses[0].period >= 8)
+        timers[PULSE1_TIMER] = clock + 1;
+    if (timers[PULSE2_TIMER] - clock > MAX_TIMER_CYCLES && pulses[1].length && pulses[1].period >= 8)
+        timers[PULSE2_TIMER] = clock + 1;
+    if (timers[TRIANGLE_TIMER] - clock > MAX_TIMER_CYCLES && triangle.length && triangle.linear_counter)
+        timers[TRIANGLE_TIMER] = clock + 1;
+    if (timers[NOISE_TIMER] - clock > MAX_TIMER_CYCLES && noise.length)
+        timers[NOISE_TIMER] = clock + 1;
+    std::uint32_t soonest = timers[0] - clock;
+    for (int i = 1; i < TIMER_COUNT; i++)
+        soonest = std::min(soonest, timers[i] - clock);
+    // an empty sample buffer is refilled on the next cycle
+    if (dmc.is_buffer_empty && dmc.bytes_remaining)
+        soonest = 1;
+    next_event = clock + soonest;
+}
+
+void APU::clock_sequence() {
+    switch (sequence_step) {
+    case 0:
+    case 2:
+        clock_quarter_frame();
+        break;
+    case 1:
+        clock_quarter_frame();
+        clock_half_frame();
+        break;
+    case 3:
+        clock_quarter_frame();
+        clock_half_frame();
+        if (!is_five_step)
+            is_frame_interrupting |= !is_interrupt_inhibited;
+        break;
+    case 4:
+        sequence_start = clock;
+        sequence_step = 0;
+        timers[FRAME_TIMER] = clock + SEQUENCE_STEPS[is_five_step][0];
+        return;
+    }
+    timers[FRAME_TIMER] = sequence_start + SEQUENCE_STEPS[is_five_step][++sequence_step];
+}
+
+void APU::clock_quarter_frame() {
+    clock_envelope(pulses[0].envelope);
+    clock_envelope(pulses[1].envelope);
+    clock_envelope(noise.envelope);
+    if (triangle.is_linear_reload)
+        triangle.linear_counter = triangle.linear_period;
+    else if (triangle.linear_counter)
+        --triangle.linear_counter;
+    if (!triangle.is_control)
+        triangle.is_linear_reload = false;
+    is_changed = true;
+}
+
+void APU::clock_half_frame() {
+    for (int i = 0; i < 2; i++) {
+        Pulse& pulse = pulses[i];
+        if (pulse.length && !pulse.envelope.is_looping)
+            --pulse.length;
+        // the first pulse negates with one's complement, the second with two's
+        std::uint16_t change = pulse.period >> pulse.sweep_shift;
+        int target = pulse.is_sweep_negated ? pulse.period - change - (i == 0) : pulse.period + change;
+        if (pulse.sweep_divider == 0 && pulse.is_sweep_enabled && pulse.sweep_shift && pulse.period >= 8 && target >= 0 && target <= 0x7ff)
+            pulse.period = target;
+        if (pulse.sweep_divider == 0 || pulse.is_sweep_reload) {
+            pulse.sweep_divider = pulse.sweep_period;
+            pulse.is_sweep_reload = false;
+        }
+        else {
+            --pulse.sweep_divider;
+        }
+    }
+    if (triangle.length && !triangle.is_control)
+        --triangle.length;
+    if (noise.length && !noise.envelope.is_looping)
+        --noise.length;
+}
+
+void APU::clock_DMC() {
+    if (!dmc.is_silent) {
+        if (dmc.shift & 1) {
+            if (dmc.output <= 125) {
+                dmc.output += 2;
+                is_changed = true;
+            }
+        }
+        else if (dmc.output >= 2) {
+            dmc.output -= 2;
+            is_changed = true;
+        }
+    }
+    dmc.shift >>= 1;
+    if (--dmc.bits_remaining == 0) {
+        // start the next byte of the sample, or fall silent without one
+        dmc.bits_remaining = 8;
+        dmc.is_silent = dmc.is_buffer_empty;
+        if (!dmc.is_buffer_empty) {
+            dmc.shift = dmc.buffer;
+            dmc.is_buffer_empty = true;
+        }
+    }
+}
+
+void APU::fill_DMC(MainBus& bus) {
+    dmc.buffer = bus.read(dmc.current_address);
+    dmc.is_buffer_empty = false;
+    dmc.current_address = dmc.current_address == 0xffff ? 0x8000 : dmc.current_address + 1;
+    if (--dmc.bytes_remaining == 0) {
+        if (dmc.is_looping) {
+            dmc.current_address = dmc.sample_address;
+            dmc.bytes_remaining = dmc.sample_length;
+        }
+        else if (dmc.is_interrupt_enabled) {
+            dmc.is_interrupting = true;
+        }
+    }
+}
+
+void APU::mix() {
+    is_changed = false;
+    int pulse_output = 0;
+    for (const Pulse& pulse : pulses) {
+        // a period out of range mutes the channel, as does the sweep target
+        bool is_muted = pulse.period < 8 || (!pulse.is_sweep_negated && pulse.period + (pulse.period >> pulse.sweep_shift) > 0x7ff);
+        if (pulse.length && !is_muted && DUTY_TABLE[pulse.duty][pulse.step])
+            pulse_output += get_volume(pulse.envelope);
+    }
+    int triangle_output = TRIANGLE_TABLE[triangle.step];
+    int noise_output = (noise.length && !(noise.shift & 1)) ? get_volume(noise.envelope) : 0;
+    // the nonlinear mixer, approximated as on the NESdev wiki
+    float output = 0;
+    if (pulse_output)
+        output += 95.88f / (8128.0f / pulse_output + 100.0f);
+    float tnd = triangle_output / 8227.0f + noise_output / 12241.0f + dmc.output / 22638.0f;
+    if (tnd > 0)
+        output += 159.79f / (1.0f / tnd + 100.0f);
+    if (output != level) {
+        blip.add_delta(clock - frame_start, output - level);
+        level = output;
+    }
+}
+
+void APU::write(std::uint16_t address, std::uint8_t value) {
+    switch (address) {
+    case 0x4000:
+    case 0x4004: {
+        Pulse& pulse = pulses[(address >> 2) & 1];
+        pulse.duty = value >> 6;
+        pulse.envelope.is_looping = value & 0x20;
+        pulse.envelope.is_constant = value & 0x10;
+        pulse.envelope.volume = value & 0xf;
+    }
+               break;
+    case 0x4001:
+    case 0x4005: {
+        Pulse& pulse = pulses[(address >> 2) & 1];
+        pulse.is_sweep_enabled = value & 0x80;
+        pulse.sweep_period = (value >> 4) & 7;
+        pulse.is_sweep_negated = value & 0x8;
+        pulse.sweep_shift = value & 7;
+        pulse.is_sweep_reload = true;
+    }
+               break;
+    case 0x4002:
+    case 0x4006: {
+        Pulse& pulse = pulses[(address >> 2) & 1];
+        pulse.period = (pulse.period & 0x700) | value;
+    }
+               break;
+    case 0x4003:
+    case 0x4007: {
+        int index = (address >> 2) & 1;
+        Pulse& pulse = pulses[index];
+        pulse.period = (pulse.period & 0xff) | (value & 7) << 8;
+        if (enabled_channels & (1 << index))
+            pulse.length = LENGTH_TABLE[value >> 3];
+        pulse.step = 0;
+        pulse.envelope.is_start = true;
+    }
+               break;
+    case 0x4008:
+        triangle.is_control = value & 0x80;
+        triangle.linear_period = value & 0x7f;
+        break;
+    case 0x400A:
+        triangle.period = (triangle.period & 0x700) | value;
+        break;
+    case 0x400B:
+        triangle.period = (triangle.period & 0xff) | (value & 7) << 8;
+        if (enabled_channels & 0x4)
+            triangle.length = LENGTH_TABLE[value >> 3];
+        triangle.is_linear_reload = true;
+        break;
+    case 0x400C:
+        noise.envelope.is_looping = value & 0x20;
+        noise.envelope.is_constant = value & 0x10;
+        noise.envelope.volume = value & 0xf;
+        break;
+    case 0x400E:
+        noise.is_short = value & 0x80;
+        noise.period = NOISE_PERIODS[value & 0xf];
+        break;
+    case 0x400F:
+        if (enabled_channels & 0x8)
+            noise.length = LENGTH_TABLE[value >> 3];
+        noise.envelope.is_start = true;
+        break;
+    case 0x4010:
+        dmc.is_interrupt_enabled = value & 0x80;
+        if (!dmc.is_interrupt_enabled)
+            dmc.is_interrupting = false;
+        dmc.is_looping = value & 0x40;
+        dmc.rate = DMC_RATES[value & 0xf];
+        break;
+    case 0x4011:
+        dmc.output = value & 0x7f;
+        break;
+    case 0x4012:
+        dmc.sample_address = 0xc000 | value << 6;
+        break;
+    case 0x4013:
+        dmc.sample_length = (value << 4) | 1;
+        break;
+    case 0x4015:
+        enabled_channels = value;
+        if (!(value & 0x1))
+            pulses[0].length = 0;
+        if (!(value & 0x2))
+            pulses[1].length = 0;
+        if (!(value & 0x4))
+            triangle.length = 0;
+        if (!(value & 0x8))
+            noise.length = 0;
+        if (!(value & 0x10)) {
+            dmc.bytes_remaining = 0;
+        }
+        else if (dmc.bytes_remaining == 0) {
+            dmc.current_address = dmc.sample_address;
+            dmc.bytes_remaining = dmc.sample_length;
+        }
+        dmc.is_interrupting = false;
+        break;
+    case 0x4017:
+        is_five_step = value & 0x80;
+        is_interrupt_inhibited = value & 0x40;
+        if (is_interrupt_inhibited)
+            is_frame_interrupting = false;
+        sequence_start = clock;
+        sequence_step = 0;
+        timers[FRAME_TIMER] = clock + SEQUENCE_STEPS[is_five_step][0];
+        if (is_five_step) {
+            clock_quarter_frame();
+            clock_half_frame();
+        }
+        break;
+    default:
+        break;
+    }
+    schedule();
+    is_changed = true;
+    if (!is_output_suppressed)
+        mix();
+}
+
+std::uint8_t APU::get_status() {
+    std::uint8_t status = (pulses[0].length > 0) | (pulses[1].length > 0) << 1 | (triangle.length > 0) << 2 |
+        (noise.length > 0) << 3 | (dmc.bytes_remaining > 0) << 4 | is_frame_interrupting << 6 | dmc.is_interrupting << 7;
+    is_frame_interrupting = false;
+    return status;
+}
+
+void APU::set_output_suppressed(bool is_suppressed) {
+    if (!is_suppressed && ring.capacity() == 0)
+        set_sample_rate(sample_rate);
+    is_output_suppressed = is_suppressed;
+    is_changed = true;
+}
+
+void APU::set_sample_rate(double sample_rate) {
+    this->sample_rate = sample_rate;
+    blip.set_rates(CPU_CLOCK_RATE, sample_rate, MAX_FRAME_CYCLES);
+    // hold about a quarter of a second for the host
+    ring.resize(static_cast<std::size_t>(sample_rate / 4));
+    level = 0;
+}
+
+void APU::release_output() {
+    is_output_suppressed = true;
+    blip.set_rates(CPU_CLOCK_RATE, 0, 0);
+    ring.resize(0);
+    level = 0;
+}
+
+void APU::end_frame() {
+    if (!is_output_suppressed) {
+        blip.end_frame(clock - frame_start);
+        std::int16_t samples[512];
+        while (blip.samples_ready()) {
+            std::size_t count = blip.read_samples(samples, sizeof(samples) / sizeof(samples[0]));
+            ring.push(samples, count);
+        }
+    }
+    frame_start = clock;
+}
+
+void APU::save(StateWriter& state) {
+    // the channels are saved as raw bytes, so they must not hold any padding
+    static_assert(std::has_unique_object_representations_v<Pulse>, "the pulse channel must not hold padding");
+    static_assert(std::has_unique_object_representations_v<Triangle>, "the triangle channel must not hold padding");
+    static_assert(std::has_unique_object_representations_v<Noise>, "the noise channel must not hold padding");
+    static_assert(std::has_unique_object_representations_v<DMC>, "the delta modulation channel must not hold padding");
+    state.write(pulses[0]);
+    state.write(pulses[1]);
+    state.write(triangle);
+    state.write(noise);
+    state.write(dmc);
+    state.write(enabled_channels);
+    state.write(timers);
+    state.write(clock);
+    state.write(sequence_start);
+    state.write(sequence_step);
+    state.write(is_five_step);
+    state.write(is_interrupt_inhibited);
+    state.write(is_frame_interrupting);
+}
+
+void APU::load(StateReader& state) {
+    // keep the time into the audio frame across the jump of the clock
+    std::uint32_t frame_cycles = clock - frame_start;
+    state.read(pulses[0]);
+    state.read(pulses[1]);
+    state.read(triangle);
+    state.read(noise);
+    state.read(dmc);
+    state.read(enabled_channels);
+    state.read(timers);
+    state.read(clock);
+    state.read(sequence_start);
+    state.read(sequence_step);
+    // read the flag picking the sequence as a byte, it indexes a table
+    std::uint8_t five_step = 0;
+    state.read(five_step);
+    is_five_step = five_step;
+    state.read(is_interrupt_inhibited);
+    state.read(is_frame_interrupting);
+    // a state from a movie or a peer may hold anything, so the indices into
+    // the tables are put back in range
+    for (Pulse& pulse : pulses) {
+        pulse.duty &= 3;
+        pulse.step &= 7;
+        pulse.sweep_shift &= 7;
+    }
+    triangle.step &= 31;
+    sequence_step = std::min<std::uint8_t>(sequence_step, 4);
+    frame_start = clock - frame_cycles;
+    is_changed = true;
+    schedule();
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+
+#include "apu/blip_buffer.hpp"
+
+/// The cutoff of the kernels as a fraction of the Nyquist frequency
+static const double CUTOFF = 0.9;
+/// The frequency below which the output is filtered out in Hz
+static const double DC_CUTOFF = 20.0;
+
+/// Return the table of kernels, one per fractional sample position.
+///
+/// Each kernel is a windowed sinc, normalized so a full step of 1 always
+/// adds up to 1 no matter where between two samples it falls.
+///
+static const float (&get_kernels())[BlipBuffer::PHASES][BlipBuffer::KERNEL_WIDTH] {
+    static float kernels[BlipBuffer::PHASES][BlipBuffer::KERNEL_WIDTH];
+    static bool is_built = [&]() {
+        const double pi = std::acos(-1.0);
+        const int half = BlipBuffer::KERNEL_WIDTH / 2;
+        for (int phase = 0; phase < BlipBuffer::PHASES; phase++) {
+            double sum = 0;
+            for (int i = 0; i < BlipBuffer::KERNEL_WIDTH; i++) {
+                double x = i - (half - 1) - static_cast<double>(phase) / BlipBuffer::PHASES;
+                double sinc = x == 0 ? 1 : std::sin(pi * CUTOFF * x) / (pi * CUTOFF * x);
+                double window = 0.42 + 0.5 * std::cos(pi * x / half) + 0.08 * std::cos(2 * pi * x / half);
+                kernels[phase][i] = sinc * window;
+                sum += kernels[phase][i];
+            }
+            for (int i = 0; i < BlipBuffer::KERNEL_WIDTH; i++)
+                kernels[phase][i] /= sum;
+        }
+        return true;
+    }();
+    (void) is_built;
+    return kernels;
+}
+
+void BlipBuffer::set_rates(double clock_rate, double sample_rate, std::uint32_t max_frame_clocks) {
+    rate = sample_rate / clock_rate;
+    set_ratio(ratio);
+    offset = 0;
+    ready = 0;
+    integrator = dc = 0;
+    dc_rate = sample_rate > 0 ? 1 - std::exp(-2 * std::acos(-1.0) * DC_CUTOFF / sample_rate) : 0;
+    // room for two frames of samples, in case one is left unread
+    std::size_t size = sample_rate > 0 ? 2 * static_cast<std::size_t>(max_frame_clocks * sample_rate / clock_rate + 1) + KERNEL_WIDTH : 0;
+    std::vector<float>(size, 0).swap(deltas);
+}
+
+void BlipBuffer::set_ratio(double ratio) {
+    this->ratio = ratio;
+    factor = static_cast<std::uint64_t>(rate * ratio * 4294967296.0 + 0.5);
+}
+
+void BlipBuffer::add_delta(std::uint32_t time, float delta) {
+    std::uint64_t position = offset + time * factor;
+    std::size_t sample = position >> 32;
+    if (sample + KERNEL_WIDTH > deltas.size())
+        return;
+    const float* kernel = get_kernels()[(position >> (32 - PHASE_BITS)) & (PHASES - 1)];
+    float* output = &deltas[sample];
+    for (int i = 0; i < KERNEL_WIDTH; i++)
+        output[i] += kernel[i] * delta;
+}
+
+void BlipBuffer::end_frame(std::uint32_t clocks) {
+    offset += clocks * factor;
+    // a frame that overran the buffer loses its tail rather than overflowing
+    std::size_t limit = deltas.size() > KERNEL_WIDTH ? deltas.size() - KERNEL_WIDTH : 0;
+    if ((offset >> 32) > limit)
+        offset = static_cast<std::uint64_t>(limit) << 32;
+    ready = offset >> 32;
+}
+
+std::size_t BlipBuffer::read_samples(std::int16_t* data, std::size_t count) {
+    count = std::min(count, ready);
+    for (std::size_t i = 0; i < count; i++) {
+        integrator += deltas[i];
+        dc += (integrator - dc) * dc_rate;
+        float sample = (integrator - dc) * 32767.0f;
+        data[i] = static_cast<std::int16_t>(std::clamp(sample, -32768.0f, 32767.0f));
+    }
+    // shift the pending deltas down to the start of the buffer
+    std::copy(deltas.begin() + count, deltas.end(), deltas.begin());
+    std::fill(deltas.end() - count, deltas.end(), 0.0f);
+    offset -= static_cast<std::uint64_t>(count) << 32;
+    ready -= count;
+    return count;
+}
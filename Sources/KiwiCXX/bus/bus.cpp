@@ -1,6 +1,9 @@
+#include <algorithm>
+
 #include "bus/bus.hpp"
 
 std::uint8_t MainBus::read(std::uint16_t address) {
+    ++page_reads[address >> 13];
     if (address < 0x2000)
         return ram[address & 0x7ff];
     else if (address < 0x4020) {
@@ -32,7 +35,7 @@ std::uint8_t MainBus::read(std::uint16_t address) {
         return 0x00;
     }
     else if (address < 0x8000) {
-        if (mapper->hasExtendedRAM()) {
+        if (mapper->hasExtendedRAM() && mapper->isPRGRAMEnabled()) {
             return extended_ram[address - 0x6000];
         }
     }
@@ -43,8 +46,11 @@ std::uint8_t MainBus::read(std::uint16_t address) {
 }
 
 void MainBus::write(std::uint16_t address, std::uint8_t value) {
-    if (address < 0x2000)
+    ++page_writes[address >> 13];
+    if (address < 0x2000) {
         ram[address & 0x7ff] = value;
+        mark_dirty(dirty_ram, address & 0x7ff);
+    }
     else if (address < 0x4020) {
         //PPU registers, mirrored
         if (address < 0x4000) {
@@ -56,8 +62,8 @@ void MainBus::write(std::uint16_t address, std::uint8_t value) {
             else
                 return;
         }
-        //only some registers
-        else if (address < 0x4017 && address >= 0x4014) {
+        // APU and IO registers
+        else if (address < 0x4018) {
             auto it = write_callbacks.find(static_cast<IORegisters>(address));
             if (it != write_callbacks.end())
                 (it->second)(value);
@@ -74,8 +80,9 @@ void MainBus::write(std::uint16_t address, std::uint8_t value) {
         return;
     }
     else if (address < 0x8000) {
-        if (mapper->hasExtendedRAM()) {
+        if (mapper->hasExtendedRAM() && mapper->isPRGRAMEnabled()) {
             extended_ram[address - 0x6000] = value;
+            mark_dirty(dirty_extended_ram, address - 0x6000);
         }
     }
     else {
@@ -91,15 +98,62 @@ const std::uint8_t* MainBus::get_page_pointer(std::uint8_t page) {
         return nullptr;
     else if (address < 0x6000)
         return nullptr;
-    else if (address < 0x8000)
-        if (mapper->hasExtendedRAM())
+    else if (address < 0x8000) {
+        if (mapper->hasExtendedRAM() && mapper->isPRGRAMEnabled())
             return &extended_ram[address - 0x6000];
-
+    }
+    else {
+        return mapper->getPagePtr(address);
+    }
     return nullptr;
 }
 
 void MainBus::set_mapper(Mapper* mapper) {
     this->mapper = mapper;
-    if (mapper->hasExtendedRAM())
-        extended_ram.resize(0x2000);
+    // a new cartridge may drop the extended RAM of the last one
+    if (!mapper->hasExtendedRAM())
+        save_file.reset();
+    extended_ram_buffer.resize(mapper->hasExtendedRAM() ? EXTENDED_RAM_SIZE : 0);
+    if (save_file)
+        extended_ram = save_file->get_data().first(extended_ram_buffer.size());
+    else
+        extended_ram = extended_ram_buffer;
+    load_trainer();
+}
+
+void MainBus::set_save_file(std::unique_ptr<SaveFile> file) {
+    // keep playing from the contents of a file being detached
+    if (save_file && !file)
+        std::copy(extended_ram.begin(), extended_ram.end(), extended_ram_buffer.begin());
+    save_file = std::move(file);
+    if (save_file)
+        extended_ram = save_file->get_data().first(extended_ram_buffer.size());
+    else
+        extended_ram = extended_ram_buffer;
+    dirty_extended_ram = ~0ull;
+}
+
+void MainBus::load_trainer() {
+    auto trainer = mapper->getTrainer();
+    if (!trainer.empty() && !extended_ram.empty())
+        std::copy(trainer.begin(), trainer.end(), extended_ram.begin() + 0x1000);
+}
+
+void MainBus::clear() {
+    std::fill(ram.begin(), ram.end(), 0);
+    // the battery keeps the RAM of a cartridge with a save file
+    if (!save_file)
+        std::fill(extended_ram.begin(), extended_ram.end(), 0);
+    load_trainer();
+    dirty_ram = dirty_extended_ram = ~0ull;
+}
+
+void MainBus::save(StateWriter& state) {
+    state.write_pages(ram.data(), ram.size(), dirty_ram);
+    state.write_pages(extended_ram.data(), extended_ram.size(), dirty_extended_ram);
+}
+
+void MainBus::load(StateReader& state) {
+    state.read_pages(ram.data(), ram.size(), dirty_ram);
+    state.read_pages(extended_ram.data(), extended_ram.size(), dirty_extended_ram);
 }
\ No newline at end of file
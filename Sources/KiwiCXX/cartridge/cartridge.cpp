@@ -1,28 +1,43 @@
-#include <fstream>
+#include <algorithm>
 
 #include "cartridge/cartridge.hpp"
+#include "mappers/mapper.hpp"
 
-void Cartridge::loadFromFile(std::string path) {
-    // create a stream to load the ROM file
-    std::ifstream romFile(path, std::ios_base::binary | std::ios_base::in);
-    // create a byte vector for the iNES header
-    std::vector<std::uint8_t> header;
-    header.resize(0x10);
-    romFile.read(reinterpret_cast<char*>(&header[0]), 0x10);
-    // read internal data
-    name_table_mirroring = header[6] & 0xB;
-    mapper_number = ((header[6] >> 4) & 0xf) | (header[7] & 0xf0);
-    printf("mapper number: %lu\n", mapper_number);
+/// The header of the blank cartridge left by a failed load, 32KB of NROM
+static const std::uint8_t BLANK_HEADER[RomHeader::SIZE] = { 'N', 'E', 'S', 0x1a, 2, 1 };
 
-    has_extended_ram = header[6] & 0x2;
-    // read PRG-ROM 16KB banks
-    std::uint8_t banks = header[4];
-    prg_rom.resize(0x4000 * banks);
-    romFile.read(reinterpret_cast<char*>(&prg_rom[0]), 0x4000 * banks);
-    // read CHR-ROM 8KB banks
-    std::uint8_t vbanks = header[5];
-    if (!vbanks)
+/// Replace an image shorter than a size with a private copy padded with zeros.
+static void pad_image(std::shared_ptr<RomImage>& image, std::size_t size) {
+    std::span<const std::uint8_t> data = image ? image->get_data() : std::span<const std::uint8_t>();
+    if (data.size() >= size)
         return;
-    chr_rom.resize(0x2000 * vbanks);
-    romFile.read(reinterpret_cast<char*>(&chr_rom[0]), 0x2000 * vbanks);
+    std::vector<std::uint8_t> padded(size, 0);
+    std::copy(data.begin(), data.end(), padded.begin());
+    image = RomImage::share(std::move(padded));
+}
+
+RomError Cartridge::loadFromFile(std::string path) {
+    // map the ROM file, shared with every cartridge holding the same bytes
+    image = RomImage::open(path);
+    load_error = image ? RomHeader::parse(image->get_data(), header) : ROM_UNREADABLE;
+    // a truncated ROM is still run, so its mapper has to be checked too
+    if ((load_error == ROM_OK || load_error == ROM_TRUNCATED) && !Mapper::isSupported(header.mapper))
+        load_error = ROM_UNSUPPORTED_MAPPER;
+    if (load_error == ROM_TRUNCATED) {
+        // a short file reads as zeros past its end, like a short stream read
+        pad_image(image, header.get_chr_offset() + header.chr_rom_size);
+    }
+    else if (load_error != ROM_OK) {
+        std::vector<std::uint8_t> blank(RomHeader::SIZE + 0x8000 + 0x2000, 0);
+        std::copy(std::begin(BLANK_HEADER), std::end(BLANK_HEADER), blank.begin());
+        image = RomImage::share(std::move(blank));
+        RomHeader::parse(image->get_data(), header);
+    }
+    has_extended_ram = header.has_battery || header.has_trainer || (header.is_nes20 && header.prg_ram_size + header.prg_nvram_size > 0);
+    // the banks are views into the shared image, never copies
+    std::span<const std::uint8_t> data = image->get_data();
+    trainer = header.has_trainer ? data.subspan(header.get_trainer_offset(), RomHeader::TRAINER_SIZE) : std::span<const std::uint8_t>();
+    prg_rom = data.subspan(header.get_prg_offset(), header.prg_rom_size);
+    chr_rom = data.subspan(header.get_chr_offset(), header.chr_rom_size);
+    return load_error;
 }
\ No newline at end of file
@@ -0,0 +1,97 @@
+#include "cartridge/rom_header.hpp"
+
+const char* describe_rom_error(RomError error) {
+    switch (error) {
+    case ROM_OK:
+        return "ok";
+    case ROM_UNREADABLE:
+        return "the file couldn't be read";
+    case ROM_NO_HEADER:
+        return "the file is too short for an iNES header";
+    case ROM_BAD_MAGIC:
+        return "the file is not an iNES ROM";
+    case ROM_NO_PRG_ROM:
+        return "the header declares no PRG ROM";
+    case ROM_TRUNCATED:
+        return "the file is shorter than the ROM its header declares";
+    case ROM_UNSUPPORTED_MAPPER:
+        return "the mapper is not supported";
+    case ROM_TOO_LARGE:
+        return "the header declares a ROM larger than any cartridge";
+    case ROM_BAD_SIZE:
+        return "the header declares a ROM size no mapper can bank";
+    }
+    return "unknown error";
+}
+
+/// Return the size of a ROM area from the least and most significant parts
+/// of its NES 2.0 size field.
+///
+/// @param lsb the least significant byte of the size in units
+/// @param msb the most significant nibble of the size in units
+/// @param unit the size of a unit in bytes
+/// @return the size in bytes, saturated far past any real file
+///
+static std::uint64_t get_rom_size(std::uint8_t lsb, std::uint8_t msb, std::uint64_t unit) {
+    if (msb != 0xf)
+        return ((msb << 8) | lsb) * unit;
+    // the exponent-multiplier notation, 2^E * (MM * 2 + 1) bytes
+    int exponent = lsb >> 2;
+    if (exponent > 40)
+        return ~0ull >> 8;
+    return (1ull << exponent) * ((lsb & 3) * 2 + 1);
+}
+
+/// Return the size of a RAM area from its NES 2.0 shift count.
+static std::uint32_t get_ram_size(std::uint8_t shift) {
+    return shift ? 64u << shift : 0;
+}
+
+RomError RomHeader::parse(std::span<const std::uint8_t> data, RomHeader& header) {
+    if (data.size() < SIZE)
+        return ROM_NO_HEADER;
+    const std::uint8_t* bytes = data.data();
+    if (bytes[0] != 'N' || bytes[1] != 'E' || bytes[2] != 'S' || bytes[3] != 0x1a)
+        return ROM_BAD_MAGIC;
+    header = RomHeader{};
+    header.name_table_mirroring = bytes[6] & 0xB;
+    header.has_battery = bytes[6] & 0x2;
+    header.has_trainer = bytes[6] & 0x4;
+    header.is_nes20 = (bytes[7] & 0x0c) == 0x08;
+    header.mapper = bytes[6] >> 4;
+    if (header.is_nes20) {
+        header.console_type = bytes[7] & 3;
+        header.mapper |= (bytes[7] & 0xf0) | (bytes[8] & 0xf) << 8;
+        header.submapper = bytes[8] >> 4;
+        header.prg_rom_size = get_rom_size(bytes[4], bytes[9] & 0xf, 0x4000);
+        header.chr_rom_size = get_rom_size(bytes[5], bytes[9] >> 4, 0x2000);
+        header.prg_ram_size = get_ram_size(bytes[10] & 0xf);
+        header.prg_nvram_size = get_ram_size(bytes[10] >> 4);
+        header.chr_ram_size = get_ram_size(bytes[11] & 0xf);
+        header.chr_nvram_size = get_ram_size(bytes[11] >> 4);
+    }
+    else {
+        // old dumps have junk (e.g., "DiskDude!") where the upper nibble is
+        bool is_archaic = bytes[12] || bytes[13] || bytes[14] || bytes[15];
+        if (!is_archaic)
+            header.mapper |= bytes[7] & 0xf0;
+        header.prg_rom_size = bytes[4] * 0x4000ull;
+        header.chr_rom_size = bytes[5] * 0x2000ull;
+        // iNES counts PRG RAM in 8KB units, with 0 meaning one
+        std::uint32_t prg_ram_size = (bytes[8] ? bytes[8] : 1) * 0x2000u;
+        (header.has_battery ? header.prg_nvram_size : header.prg_ram_size) = prg_ram_size;
+        header.chr_ram_size = header.chr_rom_size ? 0 : 0x2000;
+    }
+    if (header.prg_rom_size == 0)
+        return ROM_NO_PRG_ROM;
+    // the sizes are saturated, so the sum can't wrap around
+    if (header.get_chr_offset() + header.chr_rom_size > SIZE + MAX_ROM_SIZE)
+        return ROM_TOO_LARGE;
+    // the exponent notation can declare any size, but the mappers assume
+    // whole 8KB PRG and 1KB CHR banks and at least 16KB of PRG ROM
+    if (header.prg_rom_size < 0x4000 || header.prg_rom_size % 0x2000 || header.chr_rom_size % 0x400)
+        return ROM_BAD_SIZE;
+    if (header.get_chr_offset() + header.chr_rom_size > data.size())
+        return ROM_TRUNCATED;
+    return ROM_OK;
+}
@@ -0,0 +1,95 @@
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+#include "cartridge/rom_image.hpp"
+#include "state/state.hpp"
+
+/// the lock guarding the registry
+static std::mutex registry_lock;
+/// the images currently alive, keyed by their fingerprint
+static std::unordered_multimap<std::uint64_t, std::weak_ptr<RomImage>> registry;
+
+/// The number of bytes at each end of an image its fingerprint covers
+static const std::size_t FINGERPRINT_SPAN = 0x1000;
+
+/// Return a hash of the size and both ends of an image.
+///
+/// Hashing every byte would fault in the whole file on open, while most of
+/// a large ROM may never be read. Images with equal fingerprints are still
+/// compared in full before they're shared.
+///
+static std::uint64_t fingerprint(const std::uint8_t* data, std::size_t size) {
+    if (size <= 2 * FINGERPRINT_SPAN)
+        return hash_state(data, size);
+    std::uint64_t head = hash_state(data, FINGERPRINT_SPAN);
+    std::uint64_t tail = hash_state(data + size - FINGERPRINT_SPAN, FINGERPRINT_SPAN);
+    return (head ^ size) * 0x9e3779b97f4a7c15ull ^ tail;
+}
+
+RomImage::RomImage(const std::uint8_t* data, std::size_t size) :
+    data(data),
+    size(size),
+    hash(fingerprint(data, size)),
+    is_mapped(true) { }
+
+RomImage::RomImage(std::vector<std::uint8_t> bytes) :
+    data(nullptr),
+    size(bytes.size()),
+    hash(fingerprint(bytes.data(), bytes.size())),
+    is_mapped(false),
+    bytes(std::move(bytes)) {
+    data = this->bytes.data();
+}
+
+RomImage::~RomImage() {
+    if (is_mapped)
+        munmap(const_cast<std::uint8_t*>(data), size);
+}
+
+std::shared_ptr<RomImage> RomImage::intern(std::shared_ptr<RomImage> image) {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    // forget the images no cartridge holds anymore, whatever their hash
+    std::erase_if(registry, [](const auto& entry) { return entry.second.expired(); });
+    auto [first, last] = registry.equal_range(image->hash);
+    for (auto entry = first; entry != last; ++entry) {
+        std::shared_ptr<RomImage> shared = entry->second.lock();
+        // the fingerprint only finds candidates, the bytes decide
+        if (shared && shared->size == image->size && std::memcmp(shared->data, image->data, image->size) == 0)
+            return shared;
+    }
+    registry.emplace(image->hash, image);
+    return image;
+}
+
+std::shared_ptr<RomImage> RomImage::open(std::string path) {
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        return nullptr;
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0)
+        mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // the mapping stays valid after the file is closed
+    close(file);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+    return intern(std::make_shared<RomImage>(static_cast<const std::uint8_t*>(mapping), info.st_size));
+}
+
+std::shared_ptr<RomImage> RomImage::share(std::vector<std::uint8_t> bytes) {
+    return intern(std::make_shared<RomImage>(std::move(bytes)));
+}
+
+std::size_t RomImage::get_image_count() {
+    std::lock_guard<std::mutex> guard(registry_lock);
+    std::size_t count = 0;
+    for (auto& entry : registry)
+        count += !entry.second.expired();
+    return count;
+}
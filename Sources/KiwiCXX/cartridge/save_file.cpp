@@ -0,0 +1,83 @@
+#include <algorithm>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "cartridge/save_file.hpp"
+
+/// The background thread writing the open save files back to disk.
+struct Flusher {
+    /// the lock guarding the open files
+    std::mutex lock;
+    /// the condition the thread sleeps on between flushes
+    std::condition_variable wake;
+    /// the save files currently open
+    std::vector<SaveFile*> files;
+    /// whether the thread is running
+    bool is_running = false;
+};
+
+/// Return the flusher, which is never destroyed so it outlives every file.
+static Flusher& get_flusher() {
+    static Flusher* flusher = new Flusher;
+    return *flusher;
+}
+
+/// Flush the open files on a timer until the last one is closed.
+static void flush_files() {
+    Flusher& flusher = get_flusher();
+    std::unique_lock<std::mutex> guard(flusher.lock);
+    while (!flusher.files.empty()) {
+        flusher.wake.wait_for(guard, SaveFile::FLUSH_INTERVAL);
+        // files closing wait on the lock, so none is unmapped mid flush
+        for (SaveFile* file : flusher.files)
+            file->flush();
+    }
+    flusher.is_running = false;
+}
+
+std::unique_ptr<SaveFile> SaveFile::open(std::string path, std::size_t size) {
+    int file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file < 0)
+        return nullptr;
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    // a new or short file is grown with zeros, a longer one keeps its tail
+    if (fstat(file, &info) == 0 && (info.st_size >= static_cast<off_t>(size) || ftruncate(file, size) == 0))
+        mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    // the mapping stays valid after the file is closed
+    close(file);
+    if (mapping == MAP_FAILED)
+        return nullptr;
+    std::unique_ptr<SaveFile> save(new SaveFile(static_cast<std::uint8_t*>(mapping), size));
+    Flusher& flusher = get_flusher();
+    std::lock_guard<std::mutex> guard(flusher.lock);
+    flusher.files.push_back(save.get());
+    if (!flusher.is_running) {
+        flusher.is_running = true;
+        std::thread(flush_files).detach();
+    }
+    return save;
+}
+
+SaveFile::~SaveFile() {
+    Flusher& flusher = get_flusher();
+    {
+        std::lock_guard<std::mutex> guard(flusher.lock);
+        flusher.files.erase(std::find(flusher.files.begin(), flusher.files.end(), this));
+        // the thread notices there's nothing left to flush and stops
+        if (flusher.files.empty())
+            flusher.wake.notify_one();
+    }
+    flush();
+    munmap(data, size);
+}
+
+void SaveFile::flush() {
+    msync(data, size, MS_SYNC);
+}
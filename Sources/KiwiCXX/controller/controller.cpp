@@ -15,4 +15,16 @@ std::uint8_t Controller::read() {
         joypad_bits >>= 1;
     }
     return ret | 0x40;
+}
+
+void Controller::save(StateWriter& state) {
+    state.write(is_strobe);
+    state.write(joypad_buttons);
+    state.write(joypad_bits);
+}
+
+void Controller::load(StateReader& state) {
+    state.read(is_strobe);
+    state.read(joypad_buttons);
+    state.read(joypad_bits);
 }
\ No newline at end of file
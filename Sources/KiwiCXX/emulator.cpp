@@ -1,6 +1,36 @@
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
 #include "emulator.hpp"
+#include "lockstep/lockstep.hpp"
+
+/// Load a cartridge from a ROM file.
+static Cartridge load_cartridge(const std::string& rom_path) {
+    Cartridge cartridge;
+    // map and validate the ROM, a bad file leaves a blank cartridge
+    cartridge.loadFromFile(rom_path);
+    return cartridge;
+}
 
-Emulator::Emulator(std::string rom_path) {
+Emulator::Emulator(std::string rom_path) : Emulator(load_cartridge(rom_path), rom_path) { }
+
+Emulator::Emulator(const Cartridge& game, std::string rom_path) :
+    cartridge(game),
+    rewind_interval(1),
+    rewind_counter(0),
+    is_rewind_current(false),
+    rom_path(rom_path),
+    is_headless(false),
+    run_ahead_frames(0),
+    run_ahead_time(0),
+    is_slim(false),
+    lockstep(nullptr),
+    lockstep_lane(0),
+    cycles_run(0),
+    scale_time(0),
+    counted(),
+    stats() {
     // set the read callbacks
     bus.set_read_callback(PPUSTATUS, [&](void) {return ppu.get_status(); });
     bus.set_read_callback(PPUDATA, [&](void) {return ppu.get_data(picture_bus); });
@@ -18,26 +48,111 @@ Emulator::Emulator(std::string rom_path) {
     bus.set_write_callback(OAMDMA, [&](std::uint8_t b) {DMA(b); });
     bus.set_write_callback(JOY1, [&](std::uint8_t b) {controllers[0].strobe(b); controllers[1].strobe(b); });
     bus.set_write_callback(OAMDATA, [&](std::uint8_t b) {ppu.set_OAM_data(b); });
+    // the APU registers, the frame counter shares its address with JOY2
+    for (int reg = SQ1_VOL; reg <= DMC_LEN; reg++)
+        bus.set_write_callback(static_cast<IORegisters>(reg), [&, reg](std::uint8_t b) {apu.write(reg, b); });
+    bus.set_write_callback(SND_CHN, [&](std::uint8_t b) {apu.write(SND_CHN, b); });
+    bus.set_write_callback(JOY2, [&](std::uint8_t b) {apu.write(JOY2, b); });
+    bus.set_read_callback(SND_CHN, [&](void) {return apu.get_status(); });
 
     // set the interrupt callback for the PPU
-    ppu.set_interrupt_callback([&]() { cpu.interrupt(bus, CPU::NMI_INTERRUPT); });
-    // load the ROM from disk, expect that the Python code has validated it
-    cartridge.loadFromFile(rom_path);
+    ppu.set_interrupt_callback([&]() { interrupt(CPU::NMI_INTERRUPT); });
+    insert_cartridge();
+}
+
+void Emulator::insert_cartridge() {
     // create the mapper based on the mapper ID in the iNES header of the ROM
-    Mapper* mapper(Mapper::create(cartridge, [&]() { picture_bus.update_mirroring(); }, [&]() { cpu.interrupt(bus, CPU::InterruptType::IRQ_INTERRUPT); }));
+    mapper = Mapper::create(cartridge, [&]() { picture_bus.update_mirroring(); }, [&]() { interrupt(CPU::IRQ_INTERRUPT); });
     // give the IO buses a pointer to the mapper
-    bus.set_mapper(mapper);
-    picture_bus.set_mapper(mapper);
+    bus.set_mapper(mapper.get());
+    picture_bus.set_mapper(mapper.get());
+    // only interrupt counters hear about the lines
+    switch (mapper->getIRQSource()) {
+    case Mapper::A12_IRQ:
+        ppu.set_scanline_callback([&]() { mapper->clockScanline(); });
+        break;
+    case Mapper::CPU_CYCLE_IRQ:
+        ppu.set_scanline_callback([&]() { mapper->clockScanline(); }, true);
+        break;
+    default:
+        ppu.set_scanline_callback(nullptr);
+    }
+    // measure the save state once so saving never has to allocate
+    StateWriter measure(nullptr, 0);
+    save(measure);
+    save_state_size = measure.size();
+}
+
+void Emulator::power_cycle() {
+    insert_cartridge();
+    controllers[0] = Controller();
+    controllers[1] = Controller();
+    bus.clear();
+    picture_bus.clear();
+    ppu.clear();
+    // the backup and history no longer match, keep the backup's memory
+    backup_state.clear();
+    // start a new history sized for the new cartridge's states
+    if (rewind_buffer)
+        enable_rewind(rewind_interval, rewind_buffer->capacity());
+    reset();
+    if (run_ahead_instance)
+        run_ahead_instance->power_cycle();
+}
+
+void Emulator::load_rom(std::string rom_path) {
+    this->rom_path = rom_path;
+    // map and validate the ROM, a bad file leaves a blank cartridge
+    cartridge.loadFromFile(rom_path);
+    // the save file belongs to the last game
+    bus.set_save_file(nullptr);
+    // the run ahead instance shares the new cartridge
+    if (run_ahead_instance) {
+        run_ahead_instance->cartridge = cartridge;
+        run_ahead_instance->rom_path = rom_path;
+    }
+    power_cycle();
+}
+
+bool Emulator::set_save_file(std::string path) {
+    if (path.empty() || !cartridge.getHeader().has_battery) {
+        bus.set_save_file(nullptr);
+        return false;
+    }
+    auto file = SaveFile::open(path, EXTENDED_RAM_SIZE);
+    if (!file)
+        return false;
+    bus.set_save_file(std::move(file));
+    return true;
+}
+
+void Emulator::interrupt(CPU::InterruptType type) {
+    if (lockstep)
+        lockstep->interrupt(lockstep_lane, type);
+    else
+        cpu.interrupt(bus, type);
 }
 
 void Emulator::DMA(std::uint8_t page) {
     // skip the DMA cycles on the CPU
-    cpu.skip_DMA_cycles();
-    // do the DMA page change on the PPU
-    ppu.do_DMA(bus.get_page_pointer(page));
+    if (lockstep)
+        lockstep->skip_DMA_cycles(lockstep_lane);
+    else
+        cpu.skip_DMA_cycles();
+    // do the DMA page change on the PPU, straight from memory when it can be
+    const std::uint8_t* page_ptr = bus.get_page_pointer(page);
+    if (page_ptr) {
+        ppu.do_DMA(page_ptr);
+        return;
+    }
+    // I/O pages are read a byte at a time for the side effects of the reads
+    std::uint8_t buffer[256];
+    for (int i = 0; i < 256; i++)
+        buffer[i] = bus.read((page << 8) | i);
+    ppu.do_DMA(buffer);
 }
 
-void Emulator::step() {
+void Emulator::run_frame() {
     // render a single frame on the emulator
     for (int i = 0; i < CYCLES_PER_FRAME; i++) {
         // 3 PPU steps per CPU step
@@ -45,19 +160,239 @@ void Emulator::step() {
         ppu.cycle(picture_bus);
         ppu.cycle(picture_bus);
         cpu.cycle(bus);
+        apu.cycle(bus);
+        // the APU holds the interrupt line until it's acknowledged
+        if (apu.is_interrupting() && !cpu.is_interrupt_masked())
+            cpu.interrupt(bus, CPU::IRQ_INTERRUPT);
+    }
+    apu.end_frame();
+    cycles_run += CYCLES_PER_FRAME;
+}
+
+void Emulator::advance(bool is_drawing) {
+    auto start = std::chrono::steady_clock::now();
+    // the real frame is only drawn when not running ahead
+    ppu.set_render_suppressed(!is_drawing || run_ahead_frames > 0);
+    apu.set_output_suppressed(is_headless);
+    run_frame();
+    // capture a rewind snapshot every interval frames
+    is_rewind_current = rewind_buffer && ++rewind_counter >= rewind_interval;
+    if (is_rewind_current) {
+        rewind_counter = 0;
+        save_state(rewind_buffer->get_capture_buffer(), save_state_size);
+        rewind_buffer->push();
+    }
+    if (run_ahead_frames > 0 && is_drawing)
+        run_ahead();
+    count_step(start);
+}
+
+void Emulator::run_ahead() {
+    auto start = std::chrono::steady_clock::now();
+    backup();
+    Emulator& ahead = run_ahead_instance ? *run_ahead_instance : *this;
+    if (run_ahead_instance)
+        ahead.load_state(backup_state.data(), backup_state.size());
+    // run the frames ahead with the current input, drawing only the last one
+    for (int i = 0; i < run_ahead_frames; i++) {
+        ahead.ppu.set_render_suppressed(i + 1 < run_ahead_frames);
+        // the real frame was already heard
+        ahead.apu.set_output_suppressed(true);
+        ahead.run_frame();
+    }
+    if (!run_ahead_instance)
+        restore();
+    run_ahead_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+FrameStats Emulator::count_totals() {
+    FrameStats totals = {};
+    totals.cpu_instructions = cpu.get_instructions();
+    totals.cpu_cycles = cycles_run;
+    // 3 PPU dots per CPU cycle
+    totals.ppu_dots = cycles_run * 3;
+    totals.ppu_scanlines = ppu.get_rendered_scanlines();
+    for (int page = 0; page < 8; page++) {
+        totals.bus_reads[get_bus_region(page)] += bus.get_page_reads()[page];
+        totals.bus_writes[get_bus_region(page)] += bus.get_page_writes()[page];
     }
+    return totals;
+}
+
+void Emulator::count_step(std::chrono::steady_clock::time_point start) {
+    FrameStats totals = count_totals();
+    FrameStats& frame = stats.last_frame;
+    frame.cpu_instructions = totals.cpu_instructions - counted.cpu_instructions;
+    frame.cpu_cycles = totals.cpu_cycles - counted.cpu_cycles;
+    frame.ppu_dots = totals.ppu_dots - counted.ppu_dots;
+    frame.ppu_scanlines = totals.ppu_scanlines - counted.ppu_scanlines;
+    for (int region = 0; region < BUS_REGION_COUNT; region++) {
+        frame.bus_reads[region] = totals.bus_reads[region] - counted.bus_reads[region];
+        frame.bus_writes[region] = totals.bus_writes[region] - counted.bus_writes[region];
+    }
+    counted = totals;
+    frame.step_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    // the screen of the last step is scaled after it, so it's counted now
+    frame.scale_time = scale_time;
+    scale_time = 0;
+    stats.frames++;
+    stats.frame_times[EmulatorStats::get_frame_time_bucket(frame.step_time)]++;
+    shared_stats.publish(stats);
+}
+
+void Emulator::save(StateWriter& state) {
+    state.write(StateHeader{ STATE_MAGIC, STATE_VERSION, cartridge.getMapper(), static_cast<std::uint32_t>(save_state_size) });
+    controllers[0].save(state);
+    controllers[1].save(state);
+    cpu.save(state);
+    ppu.save(state);
+    apu.save(state);
+    bus.save(state);
+    mapper->save(state);
+    picture_bus.save(state);
+}
+
+bool Emulator::load(StateReader& state) {
+    // validate the header before touching any component
+    StateHeader header;
+    state.read(header);
+    if (header.magic != STATE_MAGIC || header.version != STATE_VERSION || header.mapper != cartridge.getMapper() || header.size != save_state_size)
+        return false;
+    controllers[0].load(state);
+    controllers[1].load(state);
+    cpu.load(state);
+    ppu.load(state);
+    apu.load(state);
+    bus.load(state);
+    // the mapper must be loaded before the picture bus to restore mirroring
+    mapper->load(state);
+    picture_bus.load(state);
+    return true;
+}
+
+std::size_t Emulator::save_state(std::uint8_t* buffer, std::size_t size) {
+    if (size < save_state_size)
+        return 0;
+    StateWriter state(buffer, size);
+    save(state);
+    return state.size();
+}
+
+bool Emulator::load_state(const std::uint8_t* buffer, std::size_t size) {
+    if (size < save_state_size)
+        return false;
+    StateReader state(buffer, size);
+    is_rewind_current = false;
+    return load(state);
 }
 
 void Emulator::backup() {
-    backup_bus = bus;
-    backup_picture_bus = picture_bus;
-    backup_cpu = cpu;
-    backup_ppu = ppu;
+    // the first backup allocates the buffer and fills every page of it
+    bool is_incremental = !backup_state.empty();
+    if (!is_incremental)
+        backup_state.resize(save_state_size);
+    StateWriter state(backup_state.data(), backup_state.size(), is_incremental);
+    save(state);
 }
 
 void Emulator::restore() {
-    bus = backup_bus;
-    picture_bus = backup_picture_bus;
-    cpu = backup_cpu;
-    ppu = backup_ppu;
+    if (backup_state.empty())
+        return;
+    StateReader state(backup_state.data(), backup_state.size(), true);
+    load(state);
+}
+
+void Emulator::enable_rewind(int interval, std::size_t capacity) {
+    rewind_interval = interval;
+    rewind_counter = 0;
+    is_rewind_current = false;
+    rewind_buffer = std::make_unique<RewindBuffer>(save_state_size, capacity);
+}
+
+bool Emulator::rewind() {
+    if (!rewind_buffer)
+        return false;
+    // the newest snapshot is the frame on screen, rewinding to it would
+    // only move forward a frame
+    if (is_rewind_current)
+        rewind_buffer->pop();
+    is_rewind_current = false;
+    const std::uint8_t* state = rewind_buffer->pop();
+    if (state == nullptr)
+        return false;
+    auto start = std::chrono::steady_clock::now();
+    load_state(state, save_state_size);
+    rewind_counter = 0;
+    ppu.set_render_suppressed(is_headless);
+    apu.set_output_suppressed(true);
+    run_frame();
+    count_step(start);
+    return true;
+}
+
+void Emulator::set_headless(bool is_headless) {
+    this->is_headless = is_headless;
+    ppu.set_render_suppressed(is_headless);
+    apu.set_output_suppressed(is_headless);
+}
+
+void Emulator::set_slim(bool is_slim) {
+    this->is_slim = is_slim;
+    ppu.set_screen_allocated(!is_slim);
+    if (is_slim) {
+        std::vector<std::uint32_t>().swap(scaled_screen);
+        std::vector<std::uint8_t>().swap(backup_state);
+        apu.release_output();
+        is_headless = true;
+    }
+    ppu.set_render_suppressed(is_headless);
+    apu.set_output_suppressed(is_headless);
+}
+
+std::size_t Emulator::get_footprint() {
+    // the save state holds the RAM of every component
+    std::size_t bytes = sizeof(Emulator) + save_state_size + backup_state.capacity();
+    bytes += scaled_screen.capacity() * sizeof(std::uint32_t) + ppu.get_screen_size() + apu.get_output_size();
+    if (rewind_buffer)
+        bytes += rewind_buffer->memory_usage();
+    if (run_ahead_instance)
+        bytes += run_ahead_instance->get_footprint();
+    return bytes;
+}
+
+void Emulator::set_run_ahead(int frames, bool is_dual_instance) {
+    run_ahead_frames = frames;
+    run_ahead_time = 0;
+    if (frames > 0 && is_dual_instance) {
+        if (!run_ahead_instance)
+            run_ahead_instance.reset(new Emulator(cartridge, rom_path));
+    }
+    else {
+        run_ahead_instance.reset();
+    }
+}
+
+std::unique_ptr<Emulator> Emulator::fork(bool is_copying_screen) {
+    std::unique_ptr<Emulator> child(new Emulator(cartridge, rom_path));
+    child->set_slim(is_slim);
+    child->set_headless(is_headless);
+    fork_into(*child, is_copying_screen);
+    return child;
+}
+
+bool Emulator::fork_into(Emulator& target, bool is_copying_screen) {
+    if (target.cartridge.getImage() != cartridge.getImage() || &target == this)
+        return false;
+    // stream the state through a scratch buffer that each thread keeps
+    static thread_local std::vector<std::uint8_t> scratch;
+    if (scratch.size() < save_state_size)
+        scratch.resize(save_state_size);
+    StateWriter writer(scratch.data(), save_state_size);
+    save(writer);
+    // a full load leaves every page of the target dirty for its own backups
+    StateReader reader(scratch.data(), save_state_size);
+    target.load(reader);
+    if (is_copying_screen && !is_slim && !target.is_slim)
+        std::copy_n(ppu.get_screen_buffer(), WIDTH * HEIGHT, target.ppu.get_screen_buffer());
+    return true;
 }
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstring>
+
+#include "farm/batch.hpp"
+
+EmulatorBatch::EmulatorBatch(std::string rom_path, std::size_t count, std::size_t threads, bool is_pinned) :
+    pool(threads, is_pinned),
+    is_done(count, 0),
+    step_task([this](std::size_t index) { step_environment(index); }),
+    step_inputs(nullptr),
+    step_frames(0),
+    step_observations(nullptr),
+    step_ram(nullptr),
+    step_dones(nullptr) {
+    for (std::size_t i = 0; i < count; i++) {
+        emulators.push_back(std::make_unique<Emulator>(rom_path));
+        emulators.back()->reset();
+    }
+    if (count > 0)
+        set_initial_state(0);
+}
+
+void EmulatorBatch::set_initial_state(std::size_t index) {
+    initial_state.resize(emulators[index]->state_size());
+    emulators[index]->save_state(initial_state.data(), initial_state.size());
+}
+
+void EmulatorBatch::reset() {
+    pool.run(emulators.size(), [this](std::size_t index) {
+        emulators[index]->load_state(initial_state.data(), initial_state.size());
+        is_done[index] = 0;
+    });
+}
+
+void EmulatorBatch::step_environment(std::size_t index) {
+    Emulator& emulator = *emulators[index];
+    if (is_done[index]) {
+        emulator.load_state(initial_state.data(), initial_state.size());
+        is_done[index] = 0;
+    }
+    *emulator.get_controller(0) = step_inputs[index * INPUT_SIZE];
+    *emulator.get_controller(1) = step_inputs[index * INPUT_SIZE + 1];
+    for (int frame = 0; frame < step_frames && !is_done[index]; frame++) {
+        // only the frame that is observed needs drawing
+        emulator.set_headless(step_observations == nullptr || frame + 1 < step_frames);
+        emulator.step();
+        if (done_condition && done_condition(emulator.get_memory_buffer()))
+            is_done[index] = 1;
+    }
+    if (step_observations != nullptr) {
+        std::uint32_t* observation = step_observations + index * OBSERVATION_SIZE;
+        // a slim environment has no screen, so it's observed as all zeros
+        const std::uint32_t* screen = emulator.get_unscaled_screen_buffer();
+        if (screen != nullptr)
+            std::memcpy(observation, screen, OBSERVATION_SIZE * sizeof(std::uint32_t));
+        else
+            std::fill_n(observation, OBSERVATION_SIZE, 0);
+    }
+    if (step_ram != nullptr)
+        std::memcpy(step_ram + index * RAM_SIZE, emulator.get_memory_buffer(), RAM_SIZE);
+    if (step_dones != nullptr)
+        step_dones[index] = is_done[index];
+}
+
+void EmulatorBatch::step(const std::uint8_t* inputs, int frames, std::uint32_t* observations, std::uint8_t* ram, std::uint8_t* dones) {
+    step_inputs = inputs;
+    step_frames = frames;
+    step_observations = observations;
+    step_ram = ram;
+    step_dones = dones;
+    pool.run(emulators.size(), step_task);
+}
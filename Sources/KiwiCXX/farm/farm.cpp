@@ -0,0 +1,17 @@
+#include "farm/farm.hpp"
+
+EmulatorFarm::EmulatorFarm(std::size_t threads, bool is_pinned) :
+    pool(threads, is_pinned),
+    step_task([this](std::size_t index) { emulators[index]->step(); }),
+    frame_count(0) { }
+
+std::size_t EmulatorFarm::add(std::string rom_path) {
+    emulators.push_back(std::make_unique<Emulator>(rom_path));
+    emulators.back()->reset();
+    return emulators.size() - 1;
+}
+
+void EmulatorFarm::step() {
+    pool.run(emulators.size(), step_task);
+    frame_count += emulators.size();
+}
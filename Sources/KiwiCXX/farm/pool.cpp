@@ -0,0 +1,56 @@
+#include <algorithm>
+
+#include "farm/pool.hpp"
+
+EmulatorPool::EmulatorPool(std::string rom_path, std::size_t count, bool is_slim) : is_slim(is_slim) {
+    idle.reserve(count);
+    for (std::size_t i = 0; i < count; i++) {
+        idle.push_back(std::make_unique<Emulator>(rom_path));
+        idle.back()->set_slim(is_slim);
+    }
+}
+
+std::unique_ptr<Emulator> EmulatorPool::acquire(std::string rom_path) {
+    std::unique_ptr<Emulator> emulator;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (!idle.empty()) {
+            // prefer an instance that already holds the ROM
+            auto match = std::find_if(idle.begin(), idle.end(), [&](auto& instance) { return instance->get_rom_path() == rom_path; });
+            if (match != idle.end())
+                std::iter_swap(match, idle.end() - 1);
+            emulator = std::move(idle.back());
+            idle.pop_back();
+        }
+    }
+    if (!emulator) {
+        emulator = std::make_unique<Emulator>(rom_path);
+        emulator->set_slim(is_slim);
+        emulator->reset();
+        return emulator;
+    }
+    // drop the settings of the last session before powering on
+    emulator->disable_rewind();
+    emulator->set_run_ahead(0);
+    emulator->set_slim(is_slim);
+    emulator->set_headless(is_slim);
+    if (emulator->get_rom_path() == rom_path)
+        emulator->power_cycle();
+    else
+        emulator->load_rom(rom_path);
+    return emulator;
+}
+
+void EmulatorPool::release(std::unique_ptr<Emulator> emulator) {
+    if (!emulator)
+        return;
+    // the next session must neither see nor write the save of this one
+    emulator->set_save_file("");
+    std::lock_guard<std::mutex> guard(lock);
+    idle.push_back(std::move(emulator));
+}
+
+std::size_t EmulatorPool::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return idle.size();
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "farm/worker_pool.hpp"
+
+/// Pack a range of indices into a single word.
+static inline std::uint64_t pack_range(std::uint64_t begin, std::uint64_t end) {
+    return begin | (end << 32);
+}
+
+WorkerPool::WorkerPool(std::size_t threads, bool is_pinned) :
+    task(nullptr),
+    generation(0),
+    active(0),
+    is_stopping(false) {
+    threads = std::max<std::size_t>(threads, 1);
+    for (std::size_t i = 0; i < threads; i++) {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->range.store(0);
+    }
+    // start the threads once every worker exists to steal from
+    for (std::size_t i = 0; i < threads; i++)
+        workers[i]->thread = std::thread(&WorkerPool::run_worker, this, i, is_pinned);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        is_stopping = true;
+    }
+    start_signal.notify_all();
+    for (auto& worker : workers)
+        worker->thread.join();
+}
+
+void WorkerPool::run_worker(std::size_t index, bool is_pinned) {
+#ifdef __linux__
+    if (is_pinned) {
+        cpu_set_t cores;
+        CPU_ZERO(&cores);
+        CPU_SET(index % std::max(std::thread::hardware_concurrency(), 1u), &cores);
+        pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+    }
+#endif
+    std::uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            start_signal.wait(guard, [&]() { return is_stopping || generation != seen; });
+            if (is_stopping)
+                return;
+            seen = generation;
+        }
+        // run our own range, then keep stealing until every range is empty
+        std::size_t item;
+        do {
+            while (pop(index, item))
+                (*task)(item);
+        } while (steal(index));
+        std::lock_guard<std::mutex> guard(lock);
+        if (--active == 0)
+            done_signal.notify_one();
+    }
+}
+
+bool WorkerPool::pop(std::size_t index, std::size_t& item) {
+    std::atomic<std::uint64_t>& range = workers[index]->range;
+    std::uint64_t current = range.load(std::memory_order_acquire);
+    while (true) {
+        std::uint64_t begin = current & 0xffffffff, end = current >> 32;
+        if (begin >= end)
+            return false;
+        if (range.compare_exchange_weak(current, pack_range(begin + 1, end), std::memory_order_acq_rel)) {
+            item = begin;
+            return true;
+        }
+    }
+}
+
+bool WorkerPool::steal(std::size_t index) {
+    for (std::size_t offset = 1; offset < workers.size(); offset++) {
+        std::atomic<std::uint64_t>& victim = workers[(index + offset) % workers.size()]->range;
+        std::uint64_t current = victim.load(std::memory_order_acquire);
+        while (true) {
+            std::uint64_t begin = current & 0xffffffff, end = current >> 32;
+            if (begin >= end)
+                break;
+            // take the back half, leaving the victim the indices it's about to run
+            std::uint64_t middle = begin + (end - begin) / 2;
+            if (victim.compare_exchange_weak(current, pack_range(begin, middle), std::memory_order_acq_rel)) {
+                workers[index]->range.store(pack_range(middle, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void WorkerPool::run(std::size_t count, const std::function<void(std::size_t)>& task) {
+    if (count == 0)
+        return;
+    std::unique_lock<std::mutex> guard(lock);
+    this->task = &task;
+    // deal out an even contiguous range to each worker
+    for (std::size_t i = 0; i < workers.size(); i++)
+        workers[i]->range.store(pack_range(count * i / workers.size(), count * (i + 1) / workers.size()));
+    active = workers.size();
+    ++generation;
+    start_signal.notify_all();
+    done_signal.wait(guard, [&]() { return active == 0; });
+    this->task = nullptr;
+}
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "apu/audio_ring.hpp"
+#include "apu/blip_buffer.hpp"
+#include "bus/bus.hpp"
+#include "state/state.hpp"
+
+/// The number of CPU cycles per second on an NTSC NES
+const double CPU_CLOCK_RATE = 1789773.0;
+
+/// The Audio Processing Unit (APU) for the NES
+class APU {
+
+private:
+    /// The volume envelope shared by the pulse and noise channels
+    struct Envelope {
+        /// whether the envelope restarts on the next quarter frame
+        bool is_start;
+        /// whether the decay loops (also halts the length counter)
+        bool is_looping;
+        /// whether the volume is constant rather than decaying
+        bool is_constant;
+        /// the constant volume, or the period of the decay
+        std::uint8_t volume;
+        /// the divider counting down the decay period
+        std::uint8_t divider;
+        /// the decaying volume
+        std::uint8_t decay;
+    };
+
+    /// A pulse (square wave) channel
+    struct Pulse {
+        /// the period of the wave in APU cycles, less one
+        std::uint16_t period;
+        /// the length counter
+        std::uint16_t length;
+        /// the envelope of the channel
+        Envelope envelope;
+        /// the duty cycle of the wave
+        std::uint8_t duty;
+        /// the step of the wave sequence
+        std::uint8_t step;
+        /// the period of the sweep divider
+        std::uint8_t sweep_period;
+        /// the shift of the period the sweep adds
+        std::uint8_t sweep_shift;
+        /// the sweep divider
+        std::uint8_t sweep_divider;
+        /// whether the sweep unit changes the period
+        bool is_sweep_enabled;
+        /// whether the sweep lowers the period
+        bool is_sweep_negated;
+        /// whether the sweep divider reloads on the next half frame
+        bool is_sweep_reload;
+    };
+
+    /// The triangle wave channel
+    struct Triangle {
+        /// the period of the wave in CPU cycles, less one
+        std::uint16_t period;
+        /// whether the linear counter reloads (also halts the length counter)
+        bool is_control;
+        /// whether the linear counter reloads on the next quarter frame
+        bool is_linear_reload;
+        /// the value the linear counter reloads to
+        std::uint8_t linear_period;
+        /// the linear counter
+        std::uint8_t linear_counter;
+        /// the length counter
+        std::uint8_t length;
+        /// the step of the wave sequence
+        std::uint8_t step;
+    };
+
+    /// The noise channel
+    struct Noise {
+        /// the period of the shift register in CPU cycles
+        std::uint16_t period;
+        /// the shift register generating the noise
+        std::uint16_t shift;
+        /// the envelope of the channel
+        Envelope envelope;
+        /// the length counter
+        std::uint8_t length;
+        /// whether the shift register uses the short loop
+        bool is_short;
+    };
+
+    /// The delta modulation channel, playing samples from PRG memory
+    struct DMC {
+        /// the period of the output in CPU cycles
+        std::uint16_t rate;
+        /// the output level
+        std::uint16_t output;
+        /// the address of the sample
+        std::uint16_t sample_address;
+        /// the length of the sample in bytes
+        std::uint16_t sample_length;
+        /// the address of the next byte of the sample
+        std::uint16_t current_address;
+        /// the number of bytes of the sample left to read
+        std::uint16_t bytes_remaining;
+        /// the bits being played
+        std::uint8_t shift;
+        /// the number of bits left to play
+        std::uint8_t bits_remaining;
+        /// the next byte of the sample
+        std::uint8_t buffer;
+        /// whether the next byte has yet to be read
+        bool is_buffer_empty;
+        /// whether the output is silent for the current byte
+        bool is_silent;
+        /// whether the sample restarts at its end
+        bool is_looping;
+        /// whether the end of a sample raises an interrupt
+        bool is_interrupt_enabled;
+        /// whether the end of a sample has raised an interrupt
+        bool is_interrupting;
+    };
+
+    /// the two pulse channels
+    Pulse pulses[2];
+    /// the triangle channel
+    Triangle triangle;
+    /// the noise channel
+    Noise noise;
+    /// the delta modulation channel
+    DMC dmc;
+    /// the channels enabled through the status register
+    std::uint8_t enabled_channels;
+
+    /// The timers counting down to the events of the APU
+    enum Timer {
+        PULSE1_TIMER,
+        PULSE2_TIMER,
+        TRIANGLE_TIMER,
+        NOISE_TIMER,
+        DMC_TIMER,
+        FRAME_TIMER,
+        TIMER_COUNT,
+    };
+
+    /// the clock each timer next fires on, silent channels are parked far ahead
+    std::uint32_t timers[TIMER_COUNT];
+    /// the CPU cycles the APU has run, wrapping around
+    std::uint32_t clock;
+    /// the clock of the soonest event
+    std::uint32_t next_event;
+
+    /// the clock the frame counter's sequence started on
+    std::uint32_t sequence_start;
+    /// the next step of the frame counter's sequence
+    std::uint8_t sequence_step;
+    /// whether the frame counter runs the five step sequence
+    bool is_five_step;
+    /// whether the frame counter is kept from interrupting
+    bool is_interrupt_inhibited;
+    /// whether the frame counter has raised an interrupt
+    bool is_frame_interrupting;
+
+    /// whether the output may have changed since it was last mixed
+    bool is_changed;
+    /// whether the output is left unsynthesized
+    bool is_output_suppressed;
+    /// the clock the audio frame started on
+    std::uint32_t frame_start;
+    /// the mixed output last added to the synthesis buffer
+    float level;
+    /// the output sample rate in Hz
+    double sample_rate;
+    /// the band-limited synthesis of the mixed output
+    BlipBuffer blip;
+    /// the samples waiting for the host
+    AudioRing ring;
+
+    /// Run the events due on the current clock.
+    ///
+    /// @param bus the bus to read samples of the delta modulation channel from
+    ///
+    void run_events(MainBus& bus);
+
+    /// Restart the timers of silent channels that can now be heard and find
+    /// the soonest event.
+    void schedule();
+
+    /// Clock the frame counter's sequence.
+    void clock_sequence();
+
+    /// Clock the envelopes and the linear counter.
+    void clock_quarter_frame();
+
+    /// Clock the length counters and the sweeps.
+    void clock_half_frame();
+
+    /// Clock the output unit of the delta modulation channel.
+    void clock_DMC();
+
+    /// Read the next byte of the delta modulation sample.
+    ///
+    /// @param bus the bus to read the sample from
+    ///
+    void fill_DMC(MainBus& bus);
+
+    /// Mix the channels and add any change to the synthesis buffer.
+    void mix();
+
+public:
+    /// Initialize a new APU.
+    APU() : is_output_suppressed(true), level(0), sample_rate(44100) { reset(); };
+
+    /// Reset the APU to its power on state.
+    void reset();
+
+    /// Perform a single CPU cycle on the APU.
+    ///
+    /// The channels only do work when one of their timers fires, so most
+    /// cycles are a single comparison.
+    ///
+    /// @param bus the bus to read samples of the delta modulation channel from
+    ///
+    inline void cycle(MainBus& bus) {
+        if (++clock == next_event)
+            run_events(bus);
+    };
+
+    /// Return true while the APU holds the interrupt line.
+    inline bool is_interrupting() { return is_frame_interrupting || dmc.is_interrupting; };
+
+    /// Write to an APU register.
+    ///
+    /// @param address the address of the register, $4000-$4013, $4015 or $4017
+    /// @param value the value to write
+    ///
+    void write(std::uint16_t address, std::uint8_t value);
+
+    /// Read the status register, acknowledging the frame interrupt.
+    std::uint8_t get_status();
+
+    /// Stop (or resume) synthesizing the output.
+    ///
+    /// The channels still run so frames played this way can be discarded
+    /// without changing the emulation. Resuming allocates the output buffers
+    /// if they aren't yet.
+    ///
+    /// @param is_suppressed true to skip synthesis
+    ///
+    void set_output_suppressed(bool is_suppressed);
+
+    /// Set the output sample rate, reallocating the output buffers.
+    ///
+    /// The ring must not be in use by the host while the rate changes.
+    ///
+    /// @param sample_rate the number of samples per second
+    ///
+    void set_sample_rate(double sample_rate);
+
+    /// Return the output sample rate in Hz.
+    inline double get_sample_rate() { return sample_rate; };
+
+    /// Nudge the output sample rate to steer the fill of the ring.
+    ///
+    /// @param ratio the factor to scale the sample rate by, close to 1
+    ///
+    inline void set_rate_adjustment(double ratio) { blip.set_ratio(ratio); };
+
+    /// Free the output buffers until the output is next resumed.
+    void release_output();
+
+    /// Return the number of bytes held by the output buffers.
+    inline std::size_t get_output_size() { return blip.get_memory_size() + ring.capacity() * sizeof(std::int16_t); };
+
+    /// Move the samples of the frame just run into the ring.
+    void end_frame();
+
+    /// Return the ring the host's audio thread pops samples from.
+    inline AudioRing& get_ring() { return ring; };
+
+    /// Serialize the APU state, excluding the synthesized output.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the APU state, excluding the synthesized output.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state);
+
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// A lock-free ring of audio samples with one producer and one consumer.
+///
+/// The emulator pushes the samples of each frame and the host's audio thread
+/// pops them. Neither side ever blocks, samples that don't fit are dropped
+/// and a short read leaves the rest of the host's buffer to the host.
+class AudioRing {
+
+private:
+    /// the samples, sized to a power of two
+    std::vector<std::int16_t> samples;
+    /// the mask that wraps an index into the samples
+    std::size_t mask;
+    /// the total number of samples pushed, written only by the producer
+    alignas(64) std::atomic<std::size_t> head;
+    /// the total number of samples popped, written only by the consumer
+    alignas(64) std::atomic<std::size_t> tail;
+
+public:
+    /// Initialize a new empty ring without storage.
+    AudioRing() : mask(0), head(0), tail(0) { };
+
+    /// Allocate (or free) the storage and drop every sample.
+    ///
+    /// Neither side may use the ring while it is being resized.
+    ///
+    /// @param capacity the least number of samples to hold, or 0 to free
+    ///
+    inline void resize(std::size_t capacity) {
+        std::size_t size = capacity ? std::bit_ceil(capacity) : 0;
+        std::vector<std::int16_t>(size).swap(samples);
+        mask = size ? size - 1 : 0;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    };
+
+    /// Return the number of samples the ring can hold.
+    inline std::size_t capacity() { return samples.size(); };
+
+    /// Return the number of samples waiting to be popped.
+    inline std::size_t size() {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    };
+
+    /// Push samples into the ring, from the producer only.
+    ///
+    /// @param data the samples to push
+    /// @param count the number of samples to push
+    /// @return the number of samples pushed, the rest are dropped
+    ///
+    inline std::size_t push(const std::int16_t* data, std::size_t count) {
+        std::size_t write = head.load(std::memory_order_relaxed);
+        std::size_t read = tail.load(std::memory_order_acquire);
+        count = std::min(count, samples.size() - (write - read));
+        for (std::size_t i = 0; i < count; i++)
+            samples[(write + i) & mask] = data[i];
+        head.store(write + count, std::memory_order_release);
+        return count;
+    };
+
+    /// Pop samples out of the ring, from the consumer only.
+    ///
+    /// @param data the buffer to pop the samples into
+    /// @param count the largest number of samples to pop
+    /// @return the number of samples popped
+    ///
+    inline std::size_t pop(std::int16_t* data, std::size_t count) {
+        std::size_t read = tail.load(std::memory_order_relaxed);
+        std::size_t write = head.load(std::memory_order_acquire);
+        count = std::min(count, write - read);
+        for (std::size_t i = 0; i < count; i++)
+            data[i] = samples[(read + i) & mask];
+        tail.store(read + count, std::memory_order_release);
+        return count;
+    };
+
+};
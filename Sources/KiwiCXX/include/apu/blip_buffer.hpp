@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// A buffer that turns amplitude steps at clock times into audio samples.
+///
+/// Rather than sampling the output every clock, each change in amplitude
+/// adds a band-limited step, taken from a table of windowed sinc kernels at
+/// the fractional sample position of the change. Summing the buffer then
+/// yields the samples, so the cost scales with the number of changes and
+/// not the clock rate.
+class BlipBuffer {
+
+public:
+    /// The number of taps in each kernel
+    const static int KERNEL_WIDTH = 16;
+    /// The number of bits of the fractional sample positions with a kernel
+    const static int PHASE_BITS = 6;
+    /// The number of fractional sample positions with their own kernel
+    const static int PHASES = 1 << PHASE_BITS;
+
+private:
+    /// the nominal number of samples per clock
+    double rate;
+    /// the adjustment of the nominal rate
+    double ratio;
+    /// the adjusted number of samples per clock in 32.32 fixed point
+    std::uint64_t factor;
+    /// the time of the start of the frame in 32.32 fixed point samples
+    std::uint64_t offset;
+    /// the number of samples ready to be read
+    std::size_t ready;
+    /// the deltas added to each pending sample
+    std::vector<float> deltas;
+    /// the running sum of the deltas read so far
+    float integrator;
+    /// the slowly moving average removed to block DC
+    float dc;
+    /// how quickly the average follows the signal
+    float dc_rate;
+
+public:
+    /// Initialize a new buffer without storage.
+    BlipBuffer() : rate(0), ratio(1), factor(0), offset(0), ready(0), integrator(0), dc(0), dc_rate(0) { };
+
+    /// Set the rates and allocate (or free) the storage.
+    ///
+    /// @param clock_rate the number of clocks per second
+    /// @param sample_rate the number of samples per second, or 0 to free
+    /// @param max_frame_clocks the largest number of clocks in a frame
+    ///
+    void set_rates(double clock_rate, double sample_rate, std::uint32_t max_frame_clocks);
+
+    /// Nudge the number of samples per clock without reallocating.
+    ///
+    /// The adjustment is kept when the rates change.
+    ///
+    /// @param ratio the factor to scale the nominal sample rate by, close to 1
+    ///
+    void set_ratio(double ratio);
+
+    /// Return the number of bytes held by the buffer.
+    inline std::size_t get_memory_size() { return deltas.capacity() * sizeof(float); };
+
+    /// Add a change in amplitude at a time in the current frame.
+    ///
+    /// @param time the clock of the change since the start of the frame
+    /// @param delta the change in amplitude
+    ///
+    void add_delta(std::uint32_t time, float delta);
+
+    /// End the current frame, making its samples ready.
+    ///
+    /// @param clocks the number of clocks in the frame
+    ///
+    void end_frame(std::uint32_t clocks);
+
+    /// Return the number of samples ready to be read.
+    inline std::size_t samples_ready() { return ready; };
+
+    /// Read ready samples out of the buffer.
+    ///
+    /// @param data the buffer to read the samples into
+    /// @param count the largest number of samples to read
+    /// @return the number of samples read
+    ///
+    std::size_t read_samples(std::int16_t* data, std::size_t count);
+
+};
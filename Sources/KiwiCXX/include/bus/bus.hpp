@@ -4,9 +4,12 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <span>
 #include <vector>
 
+#include "cartridge/save_file.hpp"
 #include "mappers/mapper.hpp"
+#include "state/state.hpp"
 
 enum IORegisters {
     PPUCTRL = 0x2000,
@@ -17,32 +20,71 @@ enum IORegisters {
     PPUSCROL,
     PPUADDR,
     PPUDATA,
+    SQ1_VOL = 0x4000,
+    SQ1_SWEEP,
+    SQ1_LO,
+    SQ1_HI,
+    SQ2_VOL,
+    SQ2_SWEEP,
+    SQ2_LO,
+    SQ2_HI,
+    TRI_LINEAR,
+    TRI_LO = 0x400A,
+    TRI_HI,
+    NOISE_VOL,
+    NOISE_LO = 0x400E,
+    NOISE_HI,
+    DMC_FREQ,
+    DMC_RAW,
+    DMC_START,
+    DMC_LEN,
     OAMDMA = 0x4014,
+    SND_CHN = 0x4015,
     JOY1 = 0x4016,
     JOY2 = 0x4017,
 };
 
+/// The number of bytes of extended RAM at $6000-$7FFF
+const std::size_t EXTENDED_RAM_SIZE = 0x2000;
+
 /// The main bus for data to travel along the NES hardware
 class MainBus {
 
 private:
     /// The RAM on the main bus
     std::vector<std::uint8_t> ram;
+    /// The extended RAM held by the bus while it isn't mapped onto a save file
+    std::vector<std::uint8_t> extended_ram_buffer;
     /// The extended RAM (if the mapper has extended RAM)
-    std::vector<std::uint8_t> extended_ram;
+    std::span<std::uint8_t> extended_ram;
+    /// the save file the extended RAM is mapped onto (if any)
+    std::unique_ptr<SaveFile> save_file;
+    /// the pages of RAM written since the last incremental snapshot
+    std::uint64_t dirty_ram;
+    /// the pages of extended RAM written since the last incremental snapshot
+    std::uint64_t dirty_extended_ram;
     /// a pointer to the mapper on the cartridge
     Mapper* mapper;
+    /// the reads of each 8KB page of the address space
+    std::uint64_t page_reads[8];
+    /// the writes of each 8KB page of the address space
+    std::uint64_t page_writes[8];
     /// a map of IO registers to callback methods for writes
     std::map<IORegisters, std::function<void(std::uint8_t)>> write_callbacks;
     /// a map of IO registers to callback methods for reads
     std::map<IORegisters, std::function<std::uint8_t(void)>> read_callbacks;
 
+    /// Copy the cartridge's trainer (if any) into extended RAM at $7000.
+    void load_trainer();
+
 public:
     /// Initialize a new main bus.
-    MainBus() : ram(0x800, 0), mapper(nullptr) {};
+    MainBus() : ram(0x800, 0), dirty_ram(~0ull), dirty_extended_ram(~0ull), mapper(nullptr), page_reads(), page_writes() {};
 
     /// Return a 8-bit pointer to the RAM buffer's first address.
     ///
+    /// Writes through this pointer are not tracked for incremental snapshots.
+    ///
     /// @return a 8-bit pointer to the RAM buffer's first address
     ///
     inline std::uint8_t* get_memory_buffer() { return &ram.front(); };
@@ -55,6 +97,14 @@ public:
     ///
     std::uint8_t read(std::uint16_t address);
 
+    /// Return the reads of each 8KB page of the address space since the bus
+    /// was created.
+    inline const std::uint64_t* get_page_reads() { return page_reads; };
+
+    /// Return the writes of each 8KB page of the address space since the bus
+    /// was created.
+    inline const std::uint64_t* get_page_writes() { return page_writes; };
+
     /// Write a byte to an address in the RAM.
     ///
     /// @param address the 16-bit address to write the byte to in RAM
@@ -68,6 +118,24 @@ public:
     ///
     void set_mapper(Mapper* mapper);
 
+    /// Clear the RAM and extended RAM to their power on state.
+    ///
+    /// Extended RAM mapped onto a save file is battery backed and kept.
+    ///
+    void clear();
+
+    /// Map the extended RAM onto a save file, or back into memory.
+    ///
+    /// The RAM takes the contents of the file. Detaching keeps the contents
+    /// in memory, and the file is flushed and closed.
+    ///
+    /// @param file the save file to map the RAM onto, nullptr to detach
+    ///
+    void set_save_file(std::unique_ptr<SaveFile> file);
+
+    /// Return true if the extended RAM is mapped onto a save file.
+    inline bool has_save_file() { return save_file != nullptr; };
+
     /// Set a callback for when writes occur.
     inline void set_write_callback(IORegisters reg, std::function<void(std::uint8_t)> callback) {
         write_callbacks.emplace(reg, callback);
@@ -78,7 +146,27 @@ public:
         read_callbacks.emplace(reg, callback);
     };
 
-    /// Return a pointer to the page in memory.
+    /// Return a pointer to a 256 byte page of memory.
+    ///
+    /// RAM, PRG RAM and PRG ROM pages resolve through the current bank
+    /// layout of the mapper.
+    ///
+    /// @param page the high byte of the address of the page
+    /// @return the pointer to the page, or nullptr if reading it goes through
+    ///         I/O registers or open bus and has to be done a byte at a time
+    ///
     const std::uint8_t* get_page_pointer(std::uint8_t page);
 
+    /// Serialize the RAM on the bus.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the RAM on the bus.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state);
+
 };
\ No newline at end of file
@@ -1,43 +1,75 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <string>
-#include <vector>
+
+#include "cartridge/rom_header.hpp"
+#include "cartridge/rom_image.hpp"
 
 class Cartridge {
 
 private:
-    /// the PRG ROM
-    std::vector<std::uint8_t> prg_rom;
-    /// the CHR ROM
-    std::vector<std::uint8_t> chr_rom;
-    /// the name table mirroring mode
-    std::uint8_t name_table_mirroring;
-    /// the mapper ID number
-    std::uint8_t mapper_number;
+    /// the ROM file, shared with other cartridges holding the same bytes
+    std::shared_ptr<RomImage> image;
+    /// the header of the ROM file
+    RomHeader header;
+    /// the reason the last load failed, or ROM_OK
+    RomError load_error;
+    /// the trainer in the image, empty if there is none
+    std::span<const std::uint8_t> trainer;
+    /// the PRG ROM in the image
+    std::span<const std::uint8_t> prg_rom;
+    /// the CHR ROM in the image
+    std::span<const std::uint8_t> chr_rom;
     /// whether this cartridge uses extended RAM
     bool has_extended_ram;
 
 public:
     /// Initialize a new cartridge
-    Cartridge() : name_table_mirroring(0), mapper_number(0), has_extended_ram(false) { };
+    Cartridge() : header(), load_error(ROM_OK), has_extended_ram(false) { };
 
     /// Return the ROM data.
-    const inline std::vector<std::uint8_t>& getROM() { return prg_rom; };
+    inline std::span<const std::uint8_t> getROM() { return prg_rom; };
 
     /// Return the VROM data.
-    const inline std::vector<std::uint8_t>& getVROM() { return chr_rom; };
+    inline std::span<const std::uint8_t> getVROM() { return chr_rom; };
+
+    /// Return the trainer to load at $7000, empty if there is none.
+    inline std::span<const std::uint8_t> getTrainer() { return trainer; };
 
     /// Return the mapper ID number.
-    inline std::uint8_t getMapper() { return mapper_number; };
+    inline std::uint16_t getMapper() { return header.mapper; };
+
+    /// Return the submapper number, 0 unless the header is NES 2.0.
+    inline std::uint8_t getSubmapper() { return header.submapper; };
 
     /// Return the name table mirroring mode.
-    inline std::uint8_t getNameTableMirroring() { return name_table_mirroring; };
+    inline std::uint8_t getNameTableMirroring() { return header.name_table_mirroring; };
 
     /// Return a boolean determining whether this cartridge uses extended RAM.
     inline bool hasExtendedRAM() { return has_extended_ram; };
 
-    /// Load a ROM file into the cartridge and build the corresponding mapper.
-    void loadFromFile(std::string path);
+    /// Return the header of the ROM file.
+    inline const RomHeader& getHeader() { return header; };
+
+    /// Return the reason the last load failed, or ROM_OK.
+    inline RomError getLoadError() { return load_error; };
+
+    /// Return the ROM file the cartridge was loaded from.
+    inline std::shared_ptr<RomImage> getImage() { return image; };
+
+    /// Load a ROM file into the cartridge.
+    ///
+    /// The file is memory-mapped and the header validated. The ROM banks
+    /// are views into the mapping, nothing is copied. A file shorter than
+    /// its header declares is padded with zeros, any other failure leaves a
+    /// blank NROM cartridge so an emulator never runs off the end of a ROM.
+    ///
+    /// @param path the path to the ROM file
+    /// @return ROM_OK, or the reason the file couldn't be loaded as is
+    ///
+    RomError loadFromFile(std::string path);
 
 };
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/// The reasons a ROM file can fail to load
+enum RomError {
+    /// the ROM is valid
+    ROM_OK,
+    /// the file couldn't be opened or mapped
+    ROM_UNREADABLE,
+    /// the file is shorter than the 16 byte header
+    ROM_NO_HEADER,
+    /// the header doesn't start with the iNES magic number
+    ROM_BAD_MAGIC,
+    /// the header declares no PRG ROM
+    ROM_NO_PRG_ROM,
+    /// the file is shorter than the trainer and ROM the header declares
+    ROM_TRUNCATED,
+    /// the mapper isn't implemented
+    ROM_UNSUPPORTED_MAPPER,
+    /// the header declares a ROM larger than any cartridge
+    ROM_TOO_LARGE,
+    /// the header declares a ROM size the mappers can't bank, PRG ROM under
+    /// 16KB or not in 8KB units, or CHR ROM not in 1KB units
+    ROM_BAD_SIZE,
+};
+
+/// Return a short description of a ROM error.
+///
+/// @param error the error to describe
+/// @return a static string describing the error
+///
+const char* describe_rom_error(RomError error);
+
+/// The fields of an iNES or NES 2.0 header
+struct RomHeader {
+    /// The size of the header in bytes
+    const static std::size_t SIZE = 0x10;
+    /// The size of the trainer in bytes
+    const static std::size_t TRAINER_SIZE = 0x200;
+    /// The largest trainer and ROM a header may declare in bytes, above the
+    /// largest sizes NES 2.0 can declare without its exponent notation
+    const static std::size_t MAX_ROM_SIZE = 0x8000000;
+
+    /// whether the header is in the NES 2.0 format
+    bool is_nes20;
+    /// the mapper ID number, up to 12 bits with NES 2.0
+    std::uint16_t mapper;
+    /// the variant of the mapper, 0 unless NES 2.0
+    std::uint8_t submapper;
+    /// the name table mirroring bits of flags 6
+    std::uint8_t name_table_mirroring;
+    /// the console the ROM is for (0 for the NES / Famicom)
+    std::uint8_t console_type;
+    /// whether the cartridge keeps its PRG RAM with a battery
+    bool has_battery;
+    /// whether a 512 byte trainer precedes the PRG ROM
+    bool has_trainer;
+    /// the size of the PRG ROM in bytes
+    std::uint64_t prg_rom_size;
+    /// the size of the CHR ROM in bytes
+    std::uint64_t chr_rom_size;
+    /// the size of the volatile PRG RAM in bytes
+    std::uint32_t prg_ram_size;
+    /// the size of the battery backed PRG RAM in bytes
+    std::uint32_t prg_nvram_size;
+    /// the size of the volatile CHR RAM in bytes
+    std::uint32_t chr_ram_size;
+    /// the size of the battery backed CHR RAM in bytes
+    std::uint32_t chr_nvram_size;
+
+    /// Parse and validate the header of a ROM file.
+    ///
+    /// Only the header is read, the sizes it declares are checked against
+    /// the size of the data without touching the rest of it.
+    ///
+    /// @param data the bytes of the whole ROM file
+    /// @param header the header to fill in, valid when ROM_OK is returned
+    /// @return ROM_OK, or the reason the file is not a usable ROM
+    ///
+    static RomError parse(std::span<const std::uint8_t> data, RomHeader& header);
+
+    /// Return the offset of the trainer in the file.
+    inline std::size_t get_trainer_offset() const { return SIZE; };
+
+    /// Return the offset of the PRG ROM in the file.
+    inline std::size_t get_prg_offset() const { return SIZE + (has_trainer ? TRAINER_SIZE : 0); };
+
+    /// Return the offset of the CHR ROM in the file.
+    inline std::size_t get_chr_offset() const { return get_prg_offset() + prg_rom_size; };
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+/// An immutable ROM file shared by every cartridge loaded with the same bytes.
+///
+/// Files are memory-mapped read only, so instances running the same game
+/// share one copy of the ROM. Images are kept in a registry keyed by a hash of
+/// their size and ends and are unmapped when the last cartridge using them is
+/// gone.
+class RomImage {
+
+private:
+    /// the bytes of the image
+    const std::uint8_t* data;
+    /// the number of bytes in the image
+    std::size_t size;
+    /// the hash of the size and the first and last pages of the image
+    std::uint64_t hash;
+    /// whether the bytes are mapped from a file rather than held in bytes
+    bool is_mapped;
+    /// the bytes of an image that isn't mapped from a file
+    std::vector<std::uint8_t> bytes;
+
+    /// Return the shared image with the same bytes, or register this one.
+    static std::shared_ptr<RomImage> intern(std::shared_ptr<RomImage> image);
+
+public:
+    /// Initialize a new image over a mapped file.
+    ///
+    /// @param data the start of the mapping
+    /// @param size the size of the mapping in bytes
+    ///
+    RomImage(const std::uint8_t* data, std::size_t size);
+
+    /// Initialize a new image holding its own bytes.
+    ///
+    /// @param bytes the bytes of the image
+    ///
+    RomImage(std::vector<std::uint8_t> bytes);
+
+    ~RomImage();
+
+    RomImage(const RomImage&) = delete;
+    RomImage& operator=(const RomImage&) = delete;
+
+    /// Return the shared image of a ROM file.
+    ///
+    /// @param path the path to the ROM file
+    /// @return the image, or nullptr if the file couldn't be read
+    ///
+    static std::shared_ptr<RomImage> open(std::string path);
+
+    /// Return the shared image of some ROM bytes.
+    ///
+    /// @param bytes the bytes of the ROM
+    /// @return the image with the same bytes
+    ///
+    static std::shared_ptr<RomImage> share(std::vector<std::uint8_t> bytes);
+
+    /// Return the bytes of the image.
+    inline std::span<const std::uint8_t> get_data() { return { data, size }; };
+
+    /// Return the hash of the size and the first and last pages of the image.
+    inline std::uint64_t get_hash() { return hash; };
+
+    /// Return the number of images currently shared.
+    static std::size_t get_image_count();
+
+};
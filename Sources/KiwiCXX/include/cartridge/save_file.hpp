@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+/// A battery backed RAM mapped straight onto a save file.
+///
+/// Writes land in the page cache as the game makes them. A background thread
+/// shared by every open save file writes the dirty pages back to disk on a
+/// timer, and closing a file writes back whatever is left, so the emulation
+/// thread never waits on the disk.
+class SaveFile {
+
+private:
+    /// the mapped bytes of the file
+    std::uint8_t* data;
+    /// the number of bytes mapped
+    std::size_t size;
+
+    /// Initialize a new save file over a mapping.
+    ///
+    /// @param data the start of the mapping
+    /// @param size the size of the mapping in bytes
+    ///
+    SaveFile(std::uint8_t* data, std::size_t size) : data(data), size(size) { };
+
+public:
+    /// The time between background flushes of every open save file
+    static constexpr std::chrono::milliseconds FLUSH_INTERVAL{1000};
+
+    ~SaveFile();
+
+    SaveFile(const SaveFile&) = delete;
+    SaveFile& operator=(const SaveFile&) = delete;
+
+    /// Map a save file, creating it or growing it with zeros if it is short.
+    ///
+    /// @param path the path to the save file
+    /// @param size the number of bytes of RAM the file holds
+    /// @return the save file, or nullptr if it couldn't be opened or mapped
+    ///
+    static std::unique_ptr<SaveFile> open(std::string path, std::size_t size);
+
+    /// Return the mapped RAM.
+    inline std::span<std::uint8_t> get_data() { return { data, size }; };
+
+    /// Write the dirty pages back to the file, waiting for the disk.
+    void flush();
+
+};
@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include "state/state.hpp"
+
 class Controller {
 
 private:
@@ -34,4 +36,16 @@ public:
     ///
     std::uint8_t read();
 
+    /// Serialize the controller state.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the controller state.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state);
+
 };
\ No newline at end of file
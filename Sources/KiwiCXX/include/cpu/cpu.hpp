@@ -4,8 +4,14 @@
 
 #include "bus/bus.hpp"
 #include "cpu/opcodes.hpp"
+#include "state/state.hpp"
 
 class CPU {
+    // the lockstep engine runs lanes on copies of the registers
+    friend class LockstepEngine;
+    // the instructions run on the registers directly
+    template<typename Registers> friend class InstructionSet;
+
 private:
     /// The program counter register
     std::uint16_t register_PC;
@@ -31,13 +37,11 @@ private:
     /// The number of cycles the CPU has run
     int cycles;
 
-    /// Set the zero and negative flags based on the given value.
-    ///
-    /// @param value the value to set the zero and negative flags using
-    ///
-    inline void set_ZN(std::uint8_t value) {
-        flags.bits.Z = !value; flags.bits.N = value & 0x80;
-    };
+    /// whether an OAM DMA halts the CPU after the current instruction
+    bool is_DMA_pending;
+
+    /// The number of instructions the CPU has executed
+    std::uint64_t instructions;
 
     /// Read a 16-bit address from the bus given an address.
     ///
@@ -49,74 +53,6 @@ private:
         return bus.read(address) | bus.read(address + 1) << 8;
     };
 
-    /// Push a value onto the stack.
-    ///
-    /// @param bus the bus to read data from
-    /// @param value the value to push onto the stack
-    ///
-    inline void push_stack(MainBus& bus, std::uint8_t value) {
-        bus.write(0x100 | register_SP--, value);
-    };
-
-    /// Pop a value off the stack.
-    ///
-    /// @param bus the bus to read data from
-    /// @return the value on the top of the stack
-    ///
-    inline std::uint8_t pop_stack(MainBus& bus) {
-        return bus.read(0x100 | ++register_SP);
-    };
-
-    /// Increment the skip cycles if two addresses refer to different pages.
-    ///
-    /// @param a an address
-    /// @param b another address
-    /// @param inc the number of skip cycles to add
-    ///
-    inline void set_page_crossed(std::uint16_t a, std::uint16_t b, int inc = 1) {
-        if ((a & 0xff00) != (b & 0xff00)) skip_cycles += inc;
-    };
-
-    /// Execute an implied mode instruction.
-    ///
-    /// @param bus the bus to read and write data from and to
-    /// @param opcode the opcode of the operation to perform
-    /// @return true if the instruction succeeds
-    ///
-    bool implied(MainBus& bus, std::uint8_t opcode);
-
-    /// Execute a branch instruction.
-    ///
-    /// @param bus the bus to read and write data from and to
-    /// @param opcode the opcode of the operation to perform
-    /// @return true if the instruction succeeds
-    ///
-    bool branch(MainBus& bus, std::uint8_t opcode);
-
-    /// Execute a type 0 instruction.
-    ///
-    /// @param bus the bus to read and write data from and to
-    /// @param opcode the opcode of the operation to perform
-    /// @return true if the instruction succeeds
-    ///
-    bool type0(MainBus& bus, std::uint8_t opcode);
-
-    /// Execute a type 1 instruction.
-    ///
-    /// @param bus the bus to read and write data from and to
-    /// @param opcode the opcode of the operation to perform
-    /// @return true if the instruction succeeds
-    ///
-    bool type1(MainBus& bus, std::uint8_t opcode);
-
-    /// Execute a type 2 instruction.
-    ///
-    /// @param bus the bus to read and write data from and to
-    /// @param opcode the opcode of the operation to perform
-    /// @return true if the instruction succeeds
-    ///
-    bool type2(MainBus& bus, std::uint8_t opcode);
-
     /// Reset the emulator using the given starting address.
     ///
     /// @param start_address the starting address for the program counter
@@ -132,7 +68,7 @@ public:
     };
 
     /// Initialize a new CPU.
-    CPU() { };
+    CPU() : is_DMA_pending(false), instructions(0) { };
 
     /// Reset using the given main bus to lookup a starting address.
     ///
@@ -150,17 +86,40 @@ public:
     ///
     void interrupt(MainBus& bus, InterruptType type);
 
+    /// Return true if IRQ interrupts are currently ignored.
+    inline bool is_interrupt_masked() { return flags.bits.I; };
+
     /// Perform a full CPU cycle using and storing data in the given bus.
     ///
     /// @param bus the bus to read and write data from / to
     ///
     void cycle(MainBus& bus);
 
-    /// Skip DMA cycles.
+    /// Return the number of instructions executed since the CPU was created.
+    inline std::uint64_t get_instructions() const { return instructions; };
+
+    /// Skip DMA cycles once the current instruction finishes its write.
+    inline void skip_DMA_cycles() { is_DMA_pending = true; };
+
+    /// Return the number of cycles an OAM DMA halts the CPU for.
     ///
     /// 513 = 256 read + 256 write + 1 dummy read
-    /// &1 -> +1 if on odd cycle
+    /// +1 if the CPU halts on an odd cycle, to align the reads
+    ///
+    /// @param halt_cycle the cycle after the write that started the DMA
+    ///
+    static inline int DMA_cycles(int halt_cycle) { return 513 + (halt_cycle & 1); };
+
+    /// Serialize the CPU state.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the CPU state.
+    ///
+    /// @param state the reader to deserialize the state from
     ///
-    inline void skip_DMA_cycles() { skip_cycles += 513 + (cycles & 1); };
+    void load(StateReader& state);
 
 };
\ No newline at end of file
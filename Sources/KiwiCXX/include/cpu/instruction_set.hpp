@@ -0,0 +1,606 @@
+#pragma once
+
+#include <cstdint>
+
+#include "bus/bus.hpp"
+#include "cpu/cpu.hpp"
+#include "cpu/opcodes.hpp"
+
+/// The instructions of the 6502, executed on registers kept anywhere.
+///
+/// The CPU keeps one set of registers while the lockstep engine keeps a set
+/// per lane in its own arrays, and both run the same instruction bodies
+/// through this template. Registers is any type with members register_PC,
+/// register_SP, register_A, register_X, register_Y, flags and skip_cycles of
+/// the CPU's types, or references to them.
+///
+template<typename Registers>
+class InstructionSet {
+
+private:
+    /// Set the zero and negative flags based on the given value.
+    ///
+    /// @param r the registers to set the flags of
+    /// @param value the value to set the zero and negative flags using
+    ///
+    static inline void set_ZN(Registers& r, std::uint8_t value) {
+        r.flags.bits.Z = !value; r.flags.bits.N = value & 0x80;
+    };
+
+    /// Read a 16-bit address from the bus given an address.
+    ///
+    /// @param bus the bus to read data from
+    /// @param address the address in memory to read an address from
+    /// @return the 16-bit address located at the given memory address
+    ///
+    static inline std::uint16_t read_address(MainBus& bus, std::uint16_t address) {
+        return bus.read(address) | bus.read(address + 1) << 8;
+    };
+
+    /// Push a value onto the stack.
+    ///
+    /// @param r the registers holding the stack pointer
+    /// @param bus the bus to read data from
+    /// @param value the value to push onto the stack
+    ///
+    static inline void push_stack(Registers& r, MainBus& bus, std::uint8_t value) {
+        bus.write(0x100 | r.register_SP--, value);
+    };
+
+    /// Pop a value off the stack.
+    ///
+    /// @param r the registers holding the stack pointer
+    /// @param bus the bus to read data from
+    /// @return the value on the top of the stack
+    ///
+    static inline std::uint8_t pop_stack(Registers& r, MainBus& bus) {
+        return bus.read(0x100 | ++r.register_SP);
+    };
+
+    /// Increment the skip cycles if two addresses refer to different pages.
+    ///
+    /// @param r the registers holding the skip cycles
+    /// @param a an address
+    /// @param b another address
+    /// @param inc the number of skip cycles to add
+    ///
+    static inline void set_page_crossed(Registers& r, std::uint16_t a, std::uint16_t b, int inc = 1) {
+        if ((a & 0xff00) != (b & 0xff00)) r.skip_cycles += inc;
+    };
+
+    /// Execute an implied mode instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the instruction succeeds
+    ///
+    static inline bool implied(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        switch (static_cast<OperationImplied>(opcode)) {
+        case NOP:
+            break;
+        case BRK:
+            interrupt(r, bus, CPU::BRK_INTERRUPT);
+            break;
+        case JSR:
+            // Push address of next instruction - 1, thus r.register_PC + 1
+            // instead of r.register_PC + 2 since r.register_PC and
+            // r.register_PC + 1 are address of subroutine
+            push_stack(r, bus, static_cast<std::uint8_t>((r.register_PC + 1) >> 8));
+            push_stack(r, bus, static_cast<std::uint8_t>(r.register_PC + 1));
+            r.register_PC = read_address(bus, r.register_PC);
+            break;
+        case RTS:
+            r.register_PC = pop_stack(r, bus);
+            r.register_PC |= pop_stack(r, bus) << 8;
+            ++r.register_PC;
+            break;
+        case RTI: {
+            r.flags.byte = pop_stack(r, bus);
+        }
+                r.register_PC = pop_stack(r, bus);
+                r.register_PC |= pop_stack(r, bus) << 8;
+                break;
+        case JMP:
+            r.register_PC = read_address(bus, r.register_PC);
+            break;
+        case JMPI: {
+            std::uint16_t location = read_address(bus, r.register_PC);
+            // 6502 has a bug such that the when the vector of an indirect
+            // address begins at the last byte of a page, the second byte
+            // is fetched from the beginning of that page rather than the
+            // beginning of the next
+            // Recreating here:
+            std::uint16_t Page = location & 0xff00;
+            r.register_PC = bus.read(location) |
+                bus.read(Page | ((location + 1) & 0xff)) << 8;
+        }
+                 break;
+        case PHP: {
+            push_stack(r, bus, r.flags.byte);
+        }
+                break;
+        case PLP: {
+            r.flags.byte = pop_stack(r, bus);
+        }
+                break;
+        case PHA:
+            push_stack(r, bus, r.register_A);
+            break;
+        case PLA:
+            r.register_A = pop_stack(r, bus);
+            set_ZN(r, r.register_A);
+            break;
+        case DEY:
+            --r.register_Y;
+            set_ZN(r, r.register_Y);
+            break;
+        case DEX:
+            --r.register_X;
+            set_ZN(r, r.register_X);
+            break;
+        case TAY:
+            r.register_Y = r.register_A;
+            set_ZN(r, r.register_Y);
+            break;
+        case INY:
+            ++r.register_Y;
+            set_ZN(r, r.register_Y);
+            break;
+        case INX:
+            ++r.register_X;
+            set_ZN(r, r.register_X);
+            break;
+        case CLC:
+            r.flags.bits.C = false;
+            break;
+        case SEC:
+            r.flags.bits.C = true;
+            break;
+        case CLI:
+            r.flags.bits.I = false;
+            break;
+        case SEI:
+            r.flags.bits.I = true;
+            break;
+        case CLD:
+            r.flags.bits.D = false;
+            break;
+        case SED:
+            r.flags.bits.D = true;
+            break;
+        case TYA:
+            r.register_A = r.register_Y;
+            set_ZN(r, r.register_A);
+            break;
+        case CLV:
+            r.flags.bits.V = false;
+            break;
+        case TXA:
+            r.register_A = r.register_X;
+            set_ZN(r, r.register_A);
+            break;
+        case TXS:
+            r.register_SP = r.register_X;
+            break;
+        case TAX:
+            r.register_X = r.register_A;
+            set_ZN(r, r.register_X);
+            break;
+        case TSX:
+            r.register_X = r.register_SP;
+            set_ZN(r, r.register_X);
+            break;
+        default:
+            return false;
+        };
+        return true;
+    };
+
+    /// Execute a branch instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the instruction succeeds
+    ///
+    static inline bool branch(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        if ((opcode & BRANCH_INSTRUCTION_MASK) == BRANCH_INSTRUCTION_MASK_RESULT) {
+            // branch is initialized to the condition required (for the flag
+            // specified later)
+            bool branch = opcode & BRANCH_CONDITION_MASK;
+
+            // set branch to true if the given condition is met by the given flag
+            // We use xnor here, it is true if either both operands are true or
+            // false
+            switch (opcode >> BRANCH_ON_FLAG_SHIFT) {
+            case NEGATIVE:
+                branch = !(branch ^ r.flags.bits.N);
+                break;
+            case OVERFLOW:
+                branch = !(branch ^ r.flags.bits.V);
+                break;
+            case CARRY:
+                branch = !(branch ^ r.flags.bits.C);
+                break;
+            case ZERO:
+                branch = !(branch ^ r.flags.bits.Z);
+                break;
+            default:
+                return false;
+            }
+
+            if (branch) {
+                int8_t offset = bus.read(r.register_PC++);
+                ++r.skip_cycles;
+                auto newPC = static_cast<std::uint16_t>(r.register_PC + offset);
+                set_page_crossed(r, r.register_PC, newPC, 2);
+                r.register_PC = newPC;
+            }
+            else
+                ++r.register_PC;
+            return true;
+        }
+        return false;
+    };
+
+    /// Execute a type 0 instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the instruction succeeds
+    ///
+    static inline bool type0(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        if ((opcode & INSTRUCTION_MODE_MASK) == 0x0) {
+            std::uint16_t location = 0;
+            switch (static_cast<AddrMode2>((opcode & ADRESS_MODE_MASK) >> ADDRESS_MODE_SHIFT)) {
+            case M2_IMMEDIATE:
+                location = r.register_PC++;
+                break;
+            case M2_ZERO_PAGE:
+                location = bus.read(r.register_PC++);
+                break;
+            case M2_ABSOLUTE:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                break;
+            case M2_INDEXED:
+                // Address wraps around in the zero page
+                location = (bus.read(r.register_PC++) + r.register_X) & 0xff;
+                break;
+            case M2_ABSOLUTE_INDEXED:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                set_page_crossed(r, location, location + r.register_X);
+                location += r.register_X;
+                break;
+            default:
+                return false;
+            }
+            std::uint16_t operand = 0;
+            switch (static_cast<Operation0>((opcode & OPERATION_MASK) >> OPERATION_SHIFT)) {
+            case BIT:
+                operand = bus.read(location);
+                r.flags.bits.Z = !(r.register_A & operand);
+                r.flags.bits.V = operand & 0x40;
+                r.flags.bits.N = operand & 0x80;
+                break;
+            case STY:
+                bus.write(location, r.register_Y);
+                break;
+            case LDY:
+                r.register_Y = bus.read(location);
+                set_ZN(r, r.register_Y);
+                break;
+            case CPY: {
+                std::uint16_t diff = r.register_Y - bus.read(location);
+                r.flags.bits.C = !(diff & 0x100);
+                set_ZN(r, diff);
+            }
+                    break;
+            case CPX: {
+                std::uint16_t diff = r.register_X - bus.read(location);
+                r.flags.bits.C = !(diff & 0x100);
+                set_ZN(r, diff);
+            }
+                    break;
+            default:
+                return false;
+            }
+
+            return true;
+        }
+        return false;
+    };
+
+    /// Execute a type 1 instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the instruction succeeds
+    ///
+    static inline bool type1(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        if ((opcode & INSTRUCTION_MODE_MASK) == 0x1) {
+            std::uint16_t location = 0; //Location of the operand, could be in RAM
+            auto op = static_cast<Operation1>((opcode & OPERATION_MASK) >> OPERATION_SHIFT);
+            switch (static_cast<AddrMode1>((opcode & ADRESS_MODE_MASK) >> ADDRESS_MODE_SHIFT)) {
+            case M1_INDEXED_INDIRECT_X: {
+                std::uint8_t zero_address = r.register_X + bus.read(r.register_PC++);
+                //Addresses wrap in zero page mode, thus pass through a mask
+                location = bus.read(zero_address & 0xff) | bus.read((zero_address + 1) & 0xff) << 8;
+            }
+                                      break;
+            case M1_ZERO_PAGE:
+                location = bus.read(r.register_PC++);
+                break;
+            case M1_IMMEDIATE:
+                location = r.register_PC++;
+                break;
+            case M1_ABSOLUTE:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                break;
+            case M1_INDIRECT_Y: {
+                std::uint8_t zero_address = bus.read(r.register_PC++);
+                location = bus.read(zero_address & 0xff) | bus.read((zero_address + 1) & 0xff) << 8;
+                if (op != STA)
+                    set_page_crossed(r, location, location + r.register_Y);
+                location += r.register_Y;
+            }
+                              break;
+            case M1_INDEXED_X:
+                // Address wraps around in the zero page
+                location = (bus.read(r.register_PC++) + r.register_X) & 0xff;
+                break;
+            case M1_ABSOLUTE_Y:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                if (op != STA)
+                    set_page_crossed(r, location, location + r.register_Y);
+                location += r.register_Y;
+                break;
+            case M1_ABSOLUTE_X:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                if (op != STA)
+                    set_page_crossed(r, location, location + r.register_X);
+                location += r.register_X;
+                break;
+            default:
+                return false;
+            }
+
+            switch (op) {
+            case ORA:
+                r.register_A |= bus.read(location);
+                set_ZN(r, r.register_A);
+                break;
+            case AND:
+                r.register_A &= bus.read(location);
+                set_ZN(r, r.register_A);
+                break;
+            case EOR:
+                r.register_A ^= bus.read(location);
+                set_ZN(r, r.register_A);
+                break;
+            case ADC: {
+                std::uint8_t operand = bus.read(location);
+                std::uint16_t sum = r.register_A + operand + r.flags.bits.C;
+                //Carry forward or UNSIGNED overflow
+                r.flags.bits.C = sum & 0x100;
+                //SIGNED overflow, would only happen if the sign of sum is
+                //different from BOTH the operands
+                r.flags.bits.V = (r.register_A ^ sum) & (operand ^ sum) & 0x80;
+                r.register_A = static_cast<std::uint8_t>(sum);
+                set_ZN(r, r.register_A);
+            }
+                    break;
+            case STA:
+                bus.write(location, r.register_A);
+                break;
+            case LDA:
+                r.register_A = bus.read(location);
+                set_ZN(r, r.register_A);
+                break;
+            case SBC: {
+                //High carry means "no borrow", thus negate and subtract
+                std::uint16_t subtrahend = bus.read(location),
+                    diff = r.register_A - subtrahend - !r.flags.bits.C;
+                //if the ninth bit is 1, the resulting number is negative => borrow => low carry
+                r.flags.bits.C = !(diff & 0x100);
+                //Same as ADC, except instead of the subtrahend,
+                //substitute with it's one complement
+                r.flags.bits.V = (r.register_A ^ diff) & (~subtrahend ^ diff) & 0x80;
+                r.register_A = diff;
+                set_ZN(r, diff);
+            }
+                    break;
+            case CMP: {
+                std::uint16_t diff = r.register_A - bus.read(location);
+                r.flags.bits.C = !(diff & 0x100);
+                set_ZN(r, diff);
+            }
+                    break;
+            default:
+                return false;
+            }
+            return true;
+        }
+        return false;
+    };
+
+    /// Execute a type 2 instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the instruction succeeds
+    ///
+    static inline bool type2(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        if ((opcode & INSTRUCTION_MODE_MASK) == 2) {
+            std::uint16_t location = 0;
+            auto op = static_cast<Operation2>((opcode & OPERATION_MASK) >> OPERATION_SHIFT);
+            auto address_mode =
+                static_cast<AddrMode2>((opcode & ADRESS_MODE_MASK) >> ADDRESS_MODE_SHIFT);
+            switch (address_mode) {
+            case M2_IMMEDIATE:
+                location = r.register_PC++;
+                break;
+            case M2_ZERO_PAGE:
+                location = bus.read(r.register_PC++);
+                break;
+            case M2_ACCUMULATOR:
+                break;
+            case M2_ABSOLUTE:
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                break;
+            case M2_INDEXED: {
+                location = bus.read(r.register_PC++);
+                std::uint8_t index;
+                if (op == LDX || op == STX)
+                    index = r.register_Y;
+                else
+                    index = r.register_X;
+                //The mask wraps address around zero page
+                location = (location + index) & 0xff;
+            }
+                           break;
+            case M2_ABSOLUTE_INDEXED: {
+                location = read_address(bus, r.register_PC);
+                r.register_PC += 2;
+                std::uint8_t index;
+                if (op == LDX || op == STX)
+                    index = r.register_Y;
+                else
+                    index = r.register_X;
+                set_page_crossed(r, location, location + index);
+                location += index;
+            }
+                                    break;
+            default:
+                return false;
+            }
+
+            std::uint16_t operand = 0;
+            switch (op) {
+            case ASL:
+            case ROL:
+                if (address_mode == M2_ACCUMULATOR) {
+                    auto prev_C = r.flags.bits.C;
+                    r.flags.bits.C = r.register_A & 0x80;
+                    r.register_A <<= 1;
+                    //If Rotating, set the bit-0 to the the previous carry
+                    r.register_A = r.register_A | (prev_C && (op == ROL));
+                    set_ZN(r, r.register_A);
+                }
+                else {
+                    auto prev_C = r.flags.bits.C;
+                    operand = bus.read(location);
+                    r.flags.bits.C = operand & 0x80;
+                    operand = operand << 1 | (prev_C && (op == ROL));
+                    set_ZN(r, operand);
+                    bus.write(location, operand);
+                }
+                break;
+            case LSR:
+            case ROR:
+                if (address_mode == M2_ACCUMULATOR) {
+                    auto prev_C = r.flags.bits.C;
+                    r.flags.bits.C = r.register_A & 1;
+                    r.register_A >>= 1;
+                    //If Rotating, set the bit-7 to the previous carry
+                    r.register_A = r.register_A | (prev_C && (op == ROR)) << 7;
+                    set_ZN(r, r.register_A);
+                }
+                else {
+                    auto prev_C = r.flags.bits.C;
+                    operand = bus.read(location);
+                    r.flags.bits.C = operand & 1;
+                    operand = operand >> 1 | (prev_C && (op == ROR)) << 7;
+                    set_ZN(r, operand);
+                    bus.write(location, operand);
+                }
+                break;
+            case STX:
+                bus.write(location, r.register_X);
+                break;
+            case LDX:
+                r.register_X = bus.read(location);
+                set_ZN(r, r.register_X);
+                break;
+            case DEC: {
+                auto tmp = bus.read(location) - 1;
+                set_ZN(r, tmp);
+                bus.write(location, tmp);
+            }
+                    break;
+            case INC: {
+                auto tmp = bus.read(location) + 1;
+                set_ZN(r, tmp);
+                bus.write(location, tmp);
+            }
+                    break;
+            default:
+                return false;
+            }
+            return true;
+        }
+        return false;
+    };
+
+public:
+    /// Interrupt the CPU.
+    ///
+    /// @param r the registers to interrupt
+    /// @param bus the main bus of the machine
+    /// @param type the type of interrupt to issue
+    ///
+    static inline void interrupt(Registers& r, MainBus& bus, CPU::InterruptType type) {
+        if (r.flags.bits.I && type != CPU::NMI_INTERRUPT && type != CPU::BRK_INTERRUPT)
+            return;
+        // Add one if BRK, a quirk of 6502
+        if (type == CPU::BRK_INTERRUPT)
+            ++r.register_PC;
+        // push values on to the stack
+        push_stack(r, bus, r.register_PC >> 8);
+        push_stack(r, bus, r.register_PC);
+        // the pushed flags have the unused bit set and B set only by BRK, set
+        // through the fields as the layout of the byte is reversed
+        CPU_Flags pushed = r.flags;
+        pushed.bits.ONE = true;
+        pushed.bits.B = type == CPU::BRK_INTERRUPT;
+        push_stack(r, bus, pushed.byte);
+        // set the interrupt flag
+        r.flags.bits.I = true;
+        // handle the kind of interrupt
+        switch (type) {
+        case CPU::IRQ_INTERRUPT:
+        case CPU::BRK_INTERRUPT:
+            r.register_PC = read_address(bus, IRQ_VECTOR);
+            break;
+        case CPU::NMI_INTERRUPT:
+            r.register_PC = read_address(bus, NMI_VECTOR);
+            break;
+        }
+        // add the number of cycles to handle the interrupt
+        r.skip_cycles += 7;
+    };
+
+    /// Execute an instruction.
+    ///
+    /// @param r the registers to execute on
+    /// @param bus the bus to read and write data from and to
+    /// @param opcode the opcode of the operation to perform
+    /// @return true if the opcode is a known instruction
+    ///
+    static inline bool execute(Registers& r, MainBus& bus, std::uint8_t opcode) {
+        // Using short-circuit evaluation, call the other function only if the
+        // first failed. implied must be called first and branch must be
+        // before type0
+        return implied(r, bus, opcode) || branch(r, bus, opcode) || type1(r, bus, opcode) || type2(r, bus, opcode) || type0(r, bus, opcode);
+    };
+
+};
@@ -1,20 +1,32 @@
 #pragma once
 
+#include "apu/apu.hpp"
 #include "bus/bus.hpp"
 #include "cartridge/cartridge.hpp"
 #include "controller/controller.hpp"
 #include "cpu/cpu.hpp"
 #include "ppu/ppu.hpp"
 #include "ppu/ppu_bus.hpp"
+#include "rewind/rewind.hpp"
+#include "state/state.hpp"
+#include "stats/frame_stats.hpp"
+
+#include <chrono>
+#include <memory>
 
 #include <xbrz/xbrz.h>
 
+class LockstepEngine;
+
 class Emulator {
+    // the lockstep engine steps the components of each lane directly
+    friend class LockstepEngine;
 
-private:
-    /// The number of cycles in 1 frame
+public:
+    /// The number of CPU cycles in 1 frame
     const static int CYCLES_PER_FRAME = 29781;
 
+private:
     /// the virtual cartridge with ROM and mapper data
     Cartridge cartridge;
     /// the 2 controllers on the emulator
@@ -28,19 +40,108 @@ private:
     CPU cpu;
     /// the emulators' PPU
     PPU ppu;
+    /// the emulator's APU
+    APU apu;
+    /// the mapper for the cartridge
+    std::unique_ptr<Mapper> mapper;
 
-    /// the main data bus of the emulator
-    MainBus backup_bus;
-    /// the picture bus from the PPU of the emulator
-    PictureBus backup_picture_bus;
-    /// The emulator's CPU
-    CPU backup_cpu;
-    /// the emulators' PPU
-    PPU backup_ppu;
+    /// the size of a save state for this emulator in bytes
+    std::size_t save_state_size;
+    /// the save state created by the last backup
+    std::vector<std::uint8_t> backup_state;
+
+    /// the snapshots to rewind through (if rewinding is enabled)
+    std::unique_ptr<RewindBuffer> rewind_buffer;
+    /// the number of frames between rewind snapshots
+    int rewind_interval;
+    /// the number of frames since the last rewind snapshot
+    int rewind_counter;
+    /// whether the newest rewind snapshot is of the current frame
+    bool is_rewind_current;
+
+    /// the path to the ROM, for creating a second run ahead instance
+    std::string rom_path;
+    /// whether the screen buffer is left untouched
+    bool is_headless;
+    /// the number of frames to run ahead of the real frame
+    int run_ahead_frames;
+    /// the instance that runs ahead (if running ahead with two instances)
+    std::unique_ptr<Emulator> run_ahead_instance;
+    /// the time spent running ahead in the last step in nanoseconds
+    std::int64_t run_ahead_time;
+
+    /// the scaled copy of the screen, allocated on first use
+    std::vector<std::uint32_t> scaled_screen;
+    /// whether the screen buffers are released to save memory
+    bool is_slim;
+
+    /// the lockstep engine running this instance's CPU (if any)
+    LockstepEngine* lockstep;
+    /// the lane of the lockstep engine holding this instance's CPU
+    int lockstep_lane;
+
+    /// the cycles the CPU has run since the emulator was created
+    std::uint64_t cycles_run;
+    /// the time spent scaling the screen since the last step in nanoseconds
+    std::int64_t scale_time;
+    /// the totals of the counters at the end of the last step
+    FrameStats counted;
+    /// the statistics as of the last step, written by the emulation thread
+    EmulatorStats stats;
+    /// the statistics published to other threads
+    SharedStats shared_stats;
+
+    /// Initialize a new emulator sharing an already loaded cartridge.
+    ///
+    /// @param game the cartridge to share the ROM image of
+    /// @param rom_path the path the cartridge was loaded from
+    ///
+    Emulator(const Cartridge& game, std::string rom_path);
+
+    /// Create the mapper for the cartridge and connect it to the buses.
+    void insert_cartridge();
+
+    /// Interrupt the CPU, wherever its registers currently live.
+    void interrupt(CPU::InterruptType type);
 
     /// Skip DMA cycle and perform a DMA copy.
     void DMA(std::uint8_t page);
 
+    /// Run the CPU and PPU for a single frame.
+    void run_frame();
+
+    /// Run the frames ahead of the real frame and draw the last of them.
+    void run_ahead();
+
+    /// Return the totals of the counters of the components since they were
+    /// created, without the times.
+    FrameStats count_totals();
+
+    /// Count the work of a step and publish the statistics.
+    ///
+    /// @param start the time the step started
+    ///
+    void count_step(std::chrono::steady_clock::time_point start);
+
+    /// Perform a step on the emulator, drawing the frame or not.
+    ///
+    /// @param is_drawing false to leave the screen buffer untouched
+    ///
+    void advance(bool is_drawing);
+
+    /// Serialize the header and every component of the emulator.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the header and every component of the emulator.
+    ///
+    /// @param state the reader to deserialize the state from
+    /// @return true if the header matches this emulator and it was loaded
+    ///
+    bool load(StateReader& state);
+
 public:
     /// The width of the NES screen in pixels
     const static int WIDTH = SCANLINE_VISIBLE_DOTS;
@@ -58,13 +159,27 @@ public:
     /// @return a 32-bit pointer to the screen buffer's first address
     ///
     inline std::uint32_t* get_screen_buffer() {
-        static std::vector<uint32_t> trgt(WIDTH * HEIGHT * xbrz::SCALE_FACTOR_MAX);
-        xbrz::scale(xbrz::SCALE_FACTOR_MAX, ppu.get_screen_buffer(), trgt.data(), WIDTH, HEIGHT, xbrz::ColorFormat::ARGB);
-        return trgt.data();
-        
-        /*return ppu.get_screen_buffer();*/
+        // a slim instance has no screen to scale
+        if (is_slim)
+            return nullptr;
+        // each instance scales into its own buffer, sized for the largest scale
+        if (scaled_screen.empty())
+            scaled_screen.resize(WIDTH * HEIGHT * xbrz::SCALE_FACTOR_MAX * xbrz::SCALE_FACTOR_MAX);
+        // the second run ahead instance holds the frame to present
+        PPU& screen_ppu = run_ahead_instance ? run_ahead_instance->ppu : ppu;
+        auto start = std::chrono::steady_clock::now();
+        xbrz::scale(xbrz::SCALE_FACTOR_MAX, screen_ppu.get_screen_buffer(), scaled_screen.data(), WIDTH, HEIGHT, xbrz::ColorFormat::ARGB);
+        scale_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        return scaled_screen.data();
     };
 
+    /// Return a 32-bit pointer to the unscaled screen buffer's first address.
+    ///
+    /// @return a pointer to WIDTH * HEIGHT ARGB pixels, row by row, or
+    ///         nullptr if the instance is slim
+    ///
+    inline std::uint32_t* get_unscaled_screen_buffer() { return ppu.get_screen_buffer(); };
+
     /// Return a 8-bit pointer to the RAM buffer's first address.
     ///
     /// @return a 8-bit pointer to the RAM buffer's first address
@@ -79,15 +194,223 @@ public:
     inline std::uint8_t* get_controller(int port) { return controllers[port].get_joypad_buffer(); };
 
     /// Load the ROM into the NES.
-    inline void reset() { cpu.reset(bus); ppu.reset(); };
+    inline void reset() { cpu.reset(bus); ppu.reset(); apu.reset(); };
+
+    /// Return every component to the state of a newly created instance.
+    ///
+    /// The mapper is recreated, RAM is cleared and the CPU and PPU are reset.
+    /// Callbacks and buffers are kept, as are the headless, slim, rewind and
+    /// run ahead settings. The backup and rewind history are dropped.
+    ///
+    void power_cycle();
+
+    /// Load a new ROM into the instance and power cycle it.
+    ///
+    /// This reuses the instance instead of constructing a new one.
+    ///
+    /// @param rom_path the path to the ROM for the emulator to run
+    ///
+    void load_rom(std::string rom_path);
+
+    /// Map the battery backed RAM of the cartridge onto a save file.
+    ///
+    /// The RAM takes the contents of the file and is written back to it in
+    /// the background, so it outlives the process. Power cycling keeps the
+    /// file, loading another ROM detaches it. Forks and the run ahead
+    /// instance keep their RAM in memory, and no two instances should map
+    /// the same file.
+    ///
+    /// @param path the path to the save file, empty to detach the file
+    /// @return true if the RAM is mapped onto the file
+    ///
+    bool set_save_file(std::string path);
+
+    /// Return the ring the host's audio thread pops samples from.
+    ///
+    /// Samples are signed 16-bit mono, pushed at the end of every frame that
+    /// isn't headless. Samples the host doesn't pop in time are dropped.
+    ///
+    inline AudioRing& get_audio_ring() { return apu.get_ring(); };
+
+    /// Set the audio output sample rate.
+    ///
+    /// The ring is reallocated, so the host must not be popping from it.
+    ///
+    /// @param sample_rate the number of samples per second
+    ///
+    inline void set_sample_rate(double sample_rate) { apu.set_sample_rate(sample_rate); };
+
+    /// Return the audio output sample rate in samples per second.
+    inline double get_sample_rate() { return apu.get_sample_rate(); };
+
+    /// Nudge the audio output sample rate to keep the ring from draining or
+    /// filling up when the host's audio clock drifts from the emulator's.
+    ///
+    /// @param ratio the factor to scale the sample rate by, close to 1
+    ///
+    inline void set_audio_rate_adjustment(double ratio) { apu.set_rate_adjustment(ratio); };
+
+    /// Return the reason the ROM failed to load, or ROM_OK.
+    ///
+    /// A ROM that fails to load leaves a blank cartridge in the instance,
+    /// except one shorter than its header declares, which is padded.
+    ///
+    inline RomError get_load_error() { return cartridge.getLoadError(); };
+
+    /// Return the path to the ROM the instance is running.
+    inline const std::string& get_rom_path() { return rom_path; };
+
+    /// Return the hash identifying the ROM the instance is running.
+    inline std::uint64_t get_rom_hash() { return cartridge.getImage()->get_hash(); };
 
     /// Perform a step on the emulator, i.e., a single frame.
-    void step();
+    inline void step() { advance(!is_headless); };
+
+    /// Perform a step without drawing the frame, to catch up when behind.
+    ///
+    /// The frame is still heard unless the emulator is headless. Nothing is
+    /// run ahead, as none of the frames would be drawn.
+    ///
+    inline void skip_frame() { advance(false); };
+
+    /// Return the size of a save state for this emulator in bytes.
+    inline std::size_t state_size() { return save_state_size; };
+
+    /// Serialize the state of the emulator into a buffer.
+    ///
+    /// The state is a versioned binary blob that does not include the screen
+    /// buffer. Nothing is allocated while saving.
+    ///
+    /// @param buffer the buffer to write the state into
+    /// @param size the size of the buffer in bytes
+    /// @return the number of bytes written, or 0 if the buffer is too small
+    ///
+    std::size_t save_state(std::uint8_t* buffer, std::size_t size);
+
+    /// Deserialize the state of the emulator from a buffer.
+    ///
+    /// @param buffer the buffer to read the state from
+    /// @param size the size of the buffer in bytes
+    /// @return true if the state was loaded, false if it does not belong to
+    ///         this version of the emulator or this cartridge's mapper
+    ///
+    bool load_state(const std::uint8_t* buffer, std::size_t size);
 
     /// Create a backup state on the emulator.
+    ///
+    /// The backup is incremental, only the RAM pages written since the last
+    /// backup or restore are copied, which keeps per-frame backups cheap.
+    /// The backup buffer is allocated by the first backup.
+    ///
     void backup();
 
     /// Restore the backup state on the emulator.
+    ///
+    /// Only the RAM pages written since the backup are copied back.
+    ///
     void restore();
 
+    /// Start capturing snapshots for rewinding.
+    ///
+    /// @param interval the number of frames between snapshots
+    /// @param capacity the number of bytes of compressed history to keep
+    ///
+    void enable_rewind(int interval, std::size_t capacity);
+
+    /// Stop capturing snapshots and free the rewind history.
+    inline void disable_rewind() { rewind_buffer.reset(); };
+
+    /// Return the rewind history, or nullptr if rewinding is disabled.
+    inline RewindBuffer* get_rewind_buffer() { return rewind_buffer.get(); };
+
+    /// Stop (or resume) drawing frames to the screen buffer.
+    ///
+    /// @param is_headless true to run without drawing any frames
+    ///
+    void set_headless(bool is_headless);
+
+    /// Return true if frames are not being drawn to the screen buffer.
+    inline bool get_headless() { return is_headless; };
+
+    /// Release (or reallocate) every buffer a headless instance doesn't need.
+    ///
+    /// A slim instance is headless and frees its screen, its scaled screen
+    /// and its backup. Frames are never drawn while slim, even if headless
+    /// mode is turned off, and the screen buffers return nullptr.
+    ///
+    /// @param is_slim true to release the buffers, false to reallocate them
+    ///
+    void set_slim(bool is_slim);
+
+    /// Return true if the screen buffers are released.
+    inline bool get_slim() { return is_slim; };
+
+    /// Return the approximate number of bytes held by this instance.
+    ///
+    /// This counts the emulator itself, the mutable state of its components,
+    /// its buffers, rewind history and run ahead instance. The ROM image is
+    /// shared between instances and is not counted.
+    ///
+    std::size_t get_footprint();
+
+    /// Run ahead of the real frame to hide the game's built-in input lag.
+    ///
+    /// Each step runs the real frame without drawing it, takes a backup, runs
+    /// the given number of frames with the current input, draws the last of
+    /// them and restores the backup. This uses the backup slot, so backups
+    /// made by the caller are overwritten while running ahead.
+    ///
+    /// With two instances a second emulator loads the backup and runs ahead
+    /// instead, so the real instance never has to restore.
+    ///
+    /// @param frames the number of frames to run ahead, or 0 to disable
+    /// @param is_dual_instance true to run ahead on a second instance
+    ///
+    void set_run_ahead(int frames, bool is_dual_instance = false);
+
+    /// Return the time spent running ahead in the last step in nanoseconds.
+    inline std::int64_t get_run_ahead_time() { return run_ahead_time; };
+
+    /// Return the statistics as of the last step, from any thread.
+    ///
+    /// The counters are kept on every step, skipped frame and rewound frame.
+    /// The snapshot is taken without locks, so a frontend can poll it from
+    /// its own thread while the emulator runs. The frames of a lockstep
+    /// engine and of a second run ahead instance are not counted.
+    ///
+    inline EmulatorStats get_stats() const { return shared_stats.read(); };
+
+    /// Create an independent copy of the emulator in its current state.
+    ///
+    /// The copy shares the immutable ROM image instead of reloading it and
+    /// starts without rewind history or run ahead. It is headless when this
+    /// emulator is headless.
+    ///
+    /// @param is_copying_screen true to copy the screen buffer as well
+    /// @return the new emulator
+    ///
+    std::unique_ptr<Emulator> fork(bool is_copying_screen = false);
+
+    /// Copy the current state of the emulator into an existing fork.
+    ///
+    /// Only mutable state is copied and nothing is allocated, so trees of
+    /// forks can be recycled instead of rebuilt.
+    ///
+    /// @param target an emulator running the same ROM image
+    /// @param is_copying_screen true to copy the screen buffer as well
+    /// @return true if the state was copied, false if the ROMs differ
+    ///
+    bool fork_into(Emulator& target, bool is_copying_screen = false);
+
+    /// Step back to the newest snapshot and render a frame from it.
+    ///
+    /// Call this in place of step while rewinding, the frame it renders is
+    /// not captured so repeated calls keep moving back through the history.
+    /// A snapshot of the frame on screen is skipped, so the first call
+    /// renders from the snapshot before it.
+    ///
+    /// @return true if there was a snapshot to rewind to
+    ///
+    bool rewind();
+
 };
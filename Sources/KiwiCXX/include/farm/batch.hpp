@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "emulator.hpp"
+#include "farm/worker_pool.hpp"
+
+/// A batch of environments running the same ROM, stepped in lockstep.
+///
+/// Every step takes the input of every environment at once, runs all of them
+/// on a worker pool and writes the results into caller provided contiguous
+/// arrays, so stepping thousands of environments costs one call per batch and
+/// allocates nothing.
+class EmulatorBatch {
+
+public:
+    /// The number of pixels in an observation
+    const static std::size_t OBSERVATION_SIZE = Emulator::WIDTH * Emulator::HEIGHT;
+    /// The number of bytes in a RAM snapshot
+    const static std::size_t RAM_SIZE = 0x800;
+    /// The number of bytes of input per environment, one per controller
+    const static std::size_t INPUT_SIZE = 2;
+
+    /// A test for whether an environment's episode is over.
+    ///
+    /// @param ram the environment's RAM, RAM_SIZE bytes
+    /// @return true if the episode is over
+    ///
+    using DoneCondition = std::function<bool(const std::uint8_t* ram)>;
+
+private:
+    /// the workers that step the environments
+    WorkerPool pool;
+    /// the environments in the batch
+    std::vector<std::unique_ptr<Emulator>> emulators;
+    /// the state every environment starts its episodes from
+    std::vector<std::uint8_t> initial_state;
+    /// whether each environment's episode ended in the last step
+    std::vector<std::uint8_t> is_done;
+    /// the test for the end of an episode (if any)
+    DoneCondition done_condition;
+    /// the task that steps a single environment, built once
+    std::function<void(std::size_t)> step_task;
+
+    /// the arguments of the step being run, read by the step task
+    const std::uint8_t* step_inputs;
+    int step_frames;
+    std::uint32_t* step_observations;
+    std::uint8_t* step_ram;
+    std::uint8_t* step_dones;
+
+    /// Step a single environment with the arguments of the current step.
+    void step_environment(std::size_t index);
+
+public:
+    /// Initialize a new batch of environments.
+    ///
+    /// @param rom_path the path to the ROM for every environment to run
+    /// @param count the number of environments
+    /// @param threads the number of worker threads
+    /// @param is_pinned true to pin each worker to its own core
+    ///
+    EmulatorBatch(std::string rom_path, std::size_t count, std::size_t threads = std::thread::hardware_concurrency(), bool is_pinned = false);
+
+    /// Return the number of environments.
+    inline std::size_t size() { return emulators.size(); };
+
+    /// Return the environment at an index.
+    inline Emulator& get(std::size_t index) { return *emulators[index]; };
+
+    /// Set the test for the end of an episode.
+    ///
+    /// An environment whose episode is over stops stepping for the rest of the
+    /// step and starts a new episode at the start of the next one.
+    ///
+    /// @param condition the test, or nullptr for episodes that never end
+    ///
+    inline void set_done_condition(DoneCondition condition) { done_condition = std::move(condition); };
+
+    /// Use the current state of an environment as the start of every episode.
+    void set_initial_state(std::size_t index);
+
+    /// Start a new episode in every environment.
+    void reset();
+
+    /// Step every environment by a number of frames.
+    ///
+    /// Only the last frame is drawn, and only if observations are wanted, so
+    /// an episode that ends early is observed at the last frame drawn. A slim
+    /// environment has no screen and is observed as all zeros. Any output
+    /// array may be null to skip it.
+    ///
+    /// @param inputs INPUT_SIZE bytes per environment, held for every frame
+    /// @param frames the number of frames to step
+    /// @param observations OBSERVATION_SIZE pixels per environment
+    /// @param ram RAM_SIZE bytes per environment
+    /// @param dones 1 byte per environment, 1 if its episode ended
+    ///
+    void step(const std::uint8_t* inputs, int frames, std::uint32_t* observations, std::uint8_t* ram, std::uint8_t* dones);
+
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "emulator.hpp"
+#include "farm/worker_pool.hpp"
+
+/// A set of independent emulators stepped together on a worker pool.
+///
+/// Instances share nothing, so each step runs every instance's frame on
+/// whichever worker claims it.
+class EmulatorFarm {
+
+private:
+    /// the workers that step the instances
+    WorkerPool pool;
+    /// the instances in the farm
+    std::vector<std::unique_ptr<Emulator>> emulators;
+    /// the task that steps an instance, kept to avoid rebuilding it each step
+    std::function<void(std::size_t)> step_task;
+    /// the total number of frames stepped across every instance
+    std::uint64_t frame_count;
+
+public:
+    /// Initialize a new empty farm.
+    ///
+    /// @param threads the number of worker threads
+    /// @param is_pinned true to pin each worker to its own core
+    ///
+    EmulatorFarm(std::size_t threads = std::thread::hardware_concurrency(), bool is_pinned = false);
+
+    /// Add a new instance running a ROM.
+    ///
+    /// @param rom_path the path to the ROM for the instance to run
+    /// @return the index of the new instance
+    ///
+    std::size_t add(std::string rom_path);
+
+    /// Return the instance at an index.
+    inline Emulator& get(std::size_t index) { return *emulators[index]; };
+
+    /// Return the number of instances.
+    inline std::size_t size() { return emulators.size(); };
+
+    /// Return the number of worker threads.
+    inline std::size_t get_thread_count() { return pool.size(); };
+
+    /// Step every instance by a frame and wait for all of them.
+    void step();
+
+    /// Return the total number of frames stepped across every instance.
+    inline std::uint64_t get_frame_count() { return frame_count; };
+
+};
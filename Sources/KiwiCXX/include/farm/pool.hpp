@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "emulator.hpp"
+
+/// A pool of idle emulators, created ahead of time and recycled.
+///
+/// Acquiring an instance prefers an idle one already running the ROM, which
+/// only needs a power cycle, then any idle one, which loads the ROM, and
+/// only constructs a new instance when the pool is empty.
+class EmulatorPool {
+
+private:
+    /// the idle instances
+    std::vector<std::unique_ptr<Emulator>> idle;
+    /// whether acquired instances are slim
+    bool is_slim;
+    /// the lock guarding the idle instances
+    std::mutex lock;
+
+public:
+    /// Initialize a new pool of warm instances.
+    ///
+    /// @param rom_path the path to the ROM to warm the instances with
+    /// @param count the number of instances to create ahead of time
+    /// @param is_slim true to hand out slim headless instances
+    ///
+    EmulatorPool(std::string rom_path, std::size_t count, bool is_slim = false);
+
+    /// Take an instance running a ROM out of the pool.
+    ///
+    /// The instance is powered on with the default settings, headless and
+    /// slim if the pool is slim, without rewind, run ahead or a save file.
+    ///
+    /// @param rom_path the path to the ROM for the instance to run
+    /// @return an instance ready to step
+    ///
+    std::unique_ptr<Emulator> acquire(std::string rom_path);
+
+    /// Return an instance to the pool to be recycled.
+    ///
+    /// The save file of the instance is detached, so the file is free to be
+    /// mapped again as soon as this returns.
+    ///
+    /// @param emulator the instance to return
+    ///
+    void release(std::unique_ptr<Emulator> emulator);
+
+    /// Return the number of idle instances.
+    std::size_t size();
+
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A fixed pool of worker threads that run batches of indexed tasks.
+///
+/// Each batch is split into one contiguous range of indices per worker. A
+/// worker that runs out of indices steals half of the remaining range of
+/// another worker, so uneven tasks (a frame of one game costing more than
+/// another) don't leave cores idle at the end of a batch.
+class WorkerPool {
+
+private:
+    /// A worker thread and the range of indices it has left to run
+    struct alignas(64) Worker {
+        /// the remaining range, the first index in the low 32 bits and the
+        /// end in the high 32 bits so it can be claimed and stolen atomically
+        std::atomic<std::uint64_t> range;
+        /// the thread running the worker
+        std::thread thread;
+    };
+
+    /// the workers in the pool
+    std::vector<std::unique_ptr<Worker>> workers;
+    /// the task of the current batch
+    const std::function<void(std::size_t)>* task;
+    /// the lock guarding the batch state
+    std::mutex lock;
+    /// signalled when a batch starts or the pool stops
+    std::condition_variable start_signal;
+    /// signalled when the last worker finishes a batch
+    std::condition_variable done_signal;
+    /// the number of batches started, so workers can tell a new one apart
+    std::uint64_t generation;
+    /// the number of workers still running the current batch
+    std::size_t active;
+    /// whether the workers should exit
+    bool is_stopping;
+
+    /// Run a worker until the pool stops.
+    void run_worker(std::size_t index, bool is_pinned);
+
+    /// Claim the next index from a worker's own range.
+    bool pop(std::size_t index, std::size_t& item);
+
+    /// Move half the range of another worker into a worker's own range.
+    bool steal(std::size_t index);
+
+public:
+    /// Initialize a new worker pool.
+    ///
+    /// @param threads the number of worker threads
+    /// @param is_pinned true to pin each worker to its own core, where the
+    ///        platform supports it
+    ///
+    WorkerPool(std::size_t threads = std::thread::hardware_concurrency(), bool is_pinned = false);
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    /// Return the number of worker threads.
+    inline std::size_t size() { return workers.size(); };
+
+    /// Run a task once for every index and wait for all of them to finish.
+    ///
+    /// @param count the number of indices to run the task for
+    /// @param task the task to run, called with each index from 0 to count
+    ///
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Return the CRC-32 (the zip / No-Intro polynomial) of some bytes.
+///
+/// The table is sliced eight ways so eight bytes are folded in per step
+/// instead of one.
+///
+/// @param data the bytes to checksum
+/// @param size the number of bytes
+/// @param crc the CRC-32 of the bytes before these, to continue a checksum
+/// @return the CRC-32 of all the bytes so far
+///
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc = 0);
+
+/// An incremental SHA-1 digest
+class Sha1 {
+
+public:
+    /// The size of a digest in bytes
+    const static std::size_t DIGEST_SIZE = 20;
+
+private:
+    /// the intermediate hash
+    std::uint32_t state[5];
+    /// the bytes of the block being filled
+    std::uint8_t block[64];
+    /// the number of bytes added so far
+    std::uint64_t length;
+
+    /// Fold a full block into the intermediate hash.
+    void compress(const std::uint8_t* data);
+
+public:
+    /// Initialize a new digest.
+    Sha1();
+
+    /// Add bytes to the digest.
+    ///
+    /// @param data the bytes to add
+    /// @param size the number of bytes
+    ///
+    void update(const std::uint8_t* data, std::size_t size);
+
+    /// Finish the digest.
+    ///
+    /// @param digest the buffer to write the 20 byte digest into
+    ///
+    void finish(std::uint8_t* digest);
+
+};
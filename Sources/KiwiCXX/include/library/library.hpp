@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cartridge/rom_header.hpp"
+#include "library/checksum.hpp"
+
+/// The magic number at the start of a library index ("KWLI")
+const std::uint32_t LIBRARY_MAGIC = 0x494c574b;
+/// The version of the layout of library indices
+const std::uint16_t LIBRARY_VERSION = 1;
+
+/// A ROM file in the library, as stored in the index
+struct LibraryEntry {
+    /// the last modification time of the file in nanoseconds
+    std::int64_t modified;
+    /// the size of the file in bytes
+    std::uint64_t file_size;
+    /// the size of the PRG ROM in bytes
+    std::uint64_t prg_rom_size;
+    /// the size of the CHR ROM in bytes
+    std::uint64_t chr_rom_size;
+    /// the offset of the path in the index's path table
+    std::uint32_t path_offset;
+    /// the length of the path in bytes
+    std::uint32_t path_length;
+    /// the CRC-32 of the PRG and CHR ROM (without the header or trainer)
+    std::uint32_t crc;
+    /// the size of the volatile PRG RAM in bytes
+    std::uint32_t prg_ram_size;
+    /// the size of the battery backed PRG RAM in bytes
+    std::uint32_t prg_nvram_size;
+    /// the size of the volatile CHR RAM in bytes
+    std::uint32_t chr_ram_size;
+    /// the size of the battery backed CHR RAM in bytes
+    std::uint32_t chr_nvram_size;
+    /// the mapper ID number
+    std::uint16_t mapper;
+    /// the variant of the mapper
+    std::uint8_t submapper;
+    /// the RomError of the file, ROM_OK if it can be played
+    std::uint8_t error;
+    /// the SHA-1 of the PRG and CHR ROM (without the header or trainer)
+    std::uint8_t sha1[Sha1::DIGEST_SIZE];
+    /// whether the header is in the NES 2.0 format
+    bool is_nes20;
+    /// whether the cartridge keeps its PRG RAM with a battery
+    bool has_battery;
+    /// whether a trainer precedes the PRG ROM
+    bool has_trainer;
+    /// the console the ROM is for
+    std::uint8_t console_type;
+};
+
+/// An index of the ROM files in a set of directories, kept on disk.
+///
+/// The index is a single file of fixed size entries followed by their paths
+/// and is memory-mapped as is, so listing a library costs one mmap no matter
+/// its size. Refreshing walks the directories again, reuses the entries of
+/// files whose size and modification time are unchanged and parses and
+/// hashes the rest in parallel, then replaces the index atomically.
+class RomLibrary {
+
+public:
+    /// The result of a refresh
+    struct RefreshStats {
+        /// the number of ROM files found
+        std::size_t files;
+        /// the number of files that were new or changed and were hashed
+        std::size_t hashed;
+        /// whether the new index was written to disk
+        bool is_saved;
+    };
+
+private:
+    /// the path of the index file
+    std::string index_path;
+    /// the mapping of the index file, or nullptr
+    const std::uint8_t* mapping;
+    /// the size of the mapping in bytes
+    std::size_t mapping_size;
+    /// the entries in the mapping
+    std::span<const LibraryEntry> entries;
+    /// the path table in the mapping
+    std::string_view paths;
+
+    /// Map the index file, leaving the library empty if it isn't valid.
+    void map();
+
+    /// Unmap the index file.
+    void unmap();
+
+public:
+    /// Initialize a new library over an index file, mapping it if it exists.
+    ///
+    /// @param index_path the path of the index file
+    ///
+    RomLibrary(std::string index_path);
+
+    ~RomLibrary();
+
+    RomLibrary(const RomLibrary&) = delete;
+    RomLibrary& operator=(const RomLibrary&) = delete;
+
+    /// Return the number of ROM files in the library.
+    inline std::size_t size() { return entries.size(); };
+
+    /// Return an entry of the library, valid until the next refresh.
+    inline const LibraryEntry& get_entry(std::size_t index) { return entries[index]; };
+
+    /// Return the path of an entry, valid until the next refresh.
+    inline std::string_view get_path(std::size_t index) { return paths.substr(entries[index].path_offset, entries[index].path_length); };
+
+    /// Scan directories for ROM files and bring the index up to date.
+    ///
+    /// Directories are walked recursively for files ending in .nes. Files
+    /// are parsed and hashed on a pool of worker threads.
+    ///
+    /// @param directories the directories to scan
+    /// @param threads the number of threads to parse and hash with
+    /// @return the number of files found and hashed, and whether the index
+    ///         was saved
+    ///
+    RefreshStats refresh(const std::vector<std::string>& directories, std::size_t threads = 0);
+
+    /// Parse and hash a single ROM file.
+    ///
+    /// @param path the path to the ROM file
+    /// @param entry the entry to fill in, apart from the path and the file's
+    ///        size and modification time
+    ///
+    static void scan_file(const std::string& path, LibraryEntry& entry);
+
+};
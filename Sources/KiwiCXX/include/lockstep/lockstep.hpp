@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "emulator.hpp"
+
+/// An experimental engine that runs the CPUs of up to 16 emulators of one ROM
+/// in lockstep.
+///
+/// The CPU registers of every lane are kept in structure-of-arrays form.
+/// Each CPU cycle every lane due an instruction fetches and runs it through
+/// the same InstructionSet as the CPU, one lane after the other. The lanes
+/// share no decoding or execution, so the engine is only as fast as running
+/// the emulators in turn: KiwiBench --lockstep measures it against them.
+///
+/// RAM, mappers, the PPU and the APU stay per lane, reached through each emulator's
+/// own buses, so every lane matches a scalar emulator exactly. Frames run
+/// this way skip the rewind and run ahead features of Emulator::step.
+class LockstepEngine {
+
+public:
+    /// The largest number of lanes in an engine
+    static constexpr int MAX_LANES = 16;
+
+private:
+    /// the emulators in each lane
+    Emulator* lanes[MAX_LANES];
+    /// the number of lanes in use
+    int lane_count;
+
+    /// the program counter register of each lane
+    alignas(64) std::uint16_t register_PC[MAX_LANES];
+    /// the stack pointer register of each lane
+    alignas(16) std::uint8_t register_SP[MAX_LANES];
+    /// the A register of each lane
+    alignas(16) std::uint8_t register_A[MAX_LANES];
+    /// the X register of each lane
+    alignas(16) std::uint8_t register_X[MAX_LANES];
+    /// the Y register of each lane
+    alignas(16) std::uint8_t register_Y[MAX_LANES];
+    /// the flags register of each lane
+    alignas(16) CPU_Flags flags[MAX_LANES];
+    /// the number of cycles to skip on each lane
+    alignas(64) int skip_cycles[MAX_LANES];
+    /// the number of cycles each lane has run
+    alignas(64) int cycles[MAX_LANES];
+    /// whether an OAM DMA halts each lane after its current instruction
+    bool is_DMA_pending[MAX_LANES];
+
+    /// The registers of a lane, named like the CPU's for InstructionSet
+    struct LaneRegisters {
+        std::uint16_t& register_PC;
+        std::uint8_t& register_SP;
+        std::uint8_t& register_A;
+        std::uint8_t& register_X;
+        std::uint8_t& register_Y;
+        CPU_Flags& flags;
+        int& skip_cycles;
+    };
+
+    /// Return the registers of a lane.
+    inline LaneRegisters get_registers(int lane) {
+        return { register_PC[lane], register_SP[lane], register_A[lane], register_X[lane], register_Y[lane], flags[lane], skip_cycles[lane] };
+    };
+
+    /// Return the main bus of a lane.
+    inline MainBus& bus(int lane) { return lanes[lane]->bus; };
+
+    /// Perform a CPU cycle on every lane.
+    void cycle();
+
+public:
+    /// Initialize a new lockstep engine.
+    ///
+    /// The emulators must all run the same ROM, or the engine runs no lanes.
+    ///
+    /// @param emulators the emulators to run, only the first MAX_LANES are used
+    ///
+    LockstepEngine(const std::vector<Emulator*>& emulators);
+
+    /// Return the number of lanes, 0 if the emulators run different ROMs.
+    inline int size() { return lane_count; };
+
+    /// Step every lane by a single frame.
+    void step();
+
+    /// Interrupt the CPU of a lane.
+    ///
+    /// @param lane the lane to interrupt
+    /// @param type the type of interrupt to issue
+    ///
+    void interrupt(int lane, CPU::InterruptType type);
+
+    /// Skip DMA cycles on the CPU of a lane once its current instruction
+    /// finishes its write.
+    inline void skip_DMA_cycles(int lane) { is_DMA_pending[lane] = true; };
+
+};
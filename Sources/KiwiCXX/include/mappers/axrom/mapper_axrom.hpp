@@ -0,0 +1,28 @@
+#pragma once
+
+#include "mappers/board_mapper.hpp"
+
+/// AxROM (mapper 7), a 32KB PRG bank and a one screen name table switched by
+/// a single register, over 8KB of CHR RAM
+struct AxROMBoard {
+    enum { PRG_BANK, NAME_TABLE, REGISTER_COUNT };
+
+    static constexpr RegisterField FIELDS[] = {
+        // $8000-$FFFF: xxxM xPPP
+        { 0x8000, 0x8000, PRG_BANK, 0, 3, 0 },
+        { 0x8000, 0x8000, NAME_TABLE, 4, 1, 0 },
+    };
+
+    static constexpr std::size_t PRG_WINDOW = 0x8000;
+    static constexpr std::size_t CHR_WINDOW = 0x2000;
+
+    static inline int prgBank(const std::uint16_t* registers, int) { return registers[PRG_BANK]; };
+
+    static inline int chrBank(const std::uint16_t*, int) { return 0; };
+
+    static inline NameTableMirroring mirroring(const std::uint16_t* registers) {
+        return registers[NAME_TABLE] ? ONE_SCREEN_HIGHER : ONE_SCREEN_LOWER;
+    };
+};
+
+using MapperAxROM = BoardMapper<AxROMBoard>;
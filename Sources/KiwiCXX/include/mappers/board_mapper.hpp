@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "mappers/mapper.hpp"
+
+/// A field of a board register loaded by CPU writes to $8000-$FFFF
+struct RegisterField {
+    /// the address bits the board decodes
+    std::uint16_t mask;
+    /// the value of the decoded bits that selects the field
+    std::uint16_t match;
+    /// the register holding the field
+    std::uint8_t reg;
+    /// the first bit of the written value that goes in the field
+    std::uint8_t value_shift;
+    /// the number of bits in the field
+    std::uint8_t width;
+    /// the first bit of the register the field fills
+    std::uint8_t reg_shift;
+};
+
+/// A mapper generated from a declarative description of a board.
+///
+/// The board is a struct of static members describing the hardware:
+///
+/// - `REGISTER_COUNT`, the number of 16-bit registers the board holds
+/// - `FIELDS`, the RegisterField decode of writes into those registers
+/// - `PRG_WINDOW` and `CHR_WINDOW`, the sizes of the switched windows of
+///   $8000-$FFFF and $0000-$1FFF
+/// - `prgBank(registers, window)` and `chrBank(registers, window)`, the
+///   bank in each window, negative banks counting back from the last
+///
+/// and optionally:
+///
+/// - `HAS_BUS_CONFLICTS`, whether writes are ANDed with the ROM byte
+/// - `decode(address)`, the wiring of the CPU address lines to the board
+/// - `mirroring(registers)`, the name table mirroring the board selects
+/// - `onWrite(registers, address, value)`, side effects of decoded writes
+/// - `latch(registers, address)`, the CHR latches, true when one flips
+/// - `IRQ_SOURCE` and `clockScanline(registers)`, the interrupt counter,
+///   returning true while the interrupt is asserted
+///
+/// Every write recomputes the banks and maps them onto the page tables of
+/// the buses, so reads never call into the mapper.
+template <typename Board>
+class BoardMapper : public Mapper {
+
+private:
+    /// the callback to signify a change in mirroring mode
+    std::function<void(void)> mirroring_callback;
+    /// the callback to raise an interrupt on the CPU
+    std::function<void(void)> interrupt_callback;
+    /// the registers of the board
+    std::uint16_t registers[Board::REGISTER_COUNT] = {};
+    /// the current name table mirroring mode
+    NameTableMirroring mirroring;
+    /// the CHR RAM of boards without CHR ROM
+    std::vector<std::uint8_t> character_ram;
+    /// the pages of character RAM written since the last incremental snapshot
+    std::uint64_t dirty_character_ram = ~0ull;
+
+    /// Map the banks the registers select into every window.
+    void mapBanks() {
+        auto rom = cartridge.getROM();
+        const std::size_t prg_count = std::max<std::size_t>(1, rom.size() / Board::PRG_WINDOW);
+        for (int window = 0; window < static_cast<int>(0x8000 / Board::PRG_WINDOW); window++) {
+            std::size_t offset = wrapBank(Board::prgBank(registers, window), prg_count) * Board::PRG_WINDOW;
+            // windows larger than the ROM mirror it
+            for (std::size_t page = 0; page < Board::PRG_WINDOW / 0x2000; page++)
+                mapPRG(window * Board::PRG_WINDOW / 0x2000 + page, 1, rom.data() + (offset + page * 0x2000) % rom.size());
+        }
+        mapCHRBanks();
+    }
+
+    /// Map the banks the registers select into the CHR windows.
+    void mapCHRBanks() {
+        const std::uint8_t* chr = character_ram.empty() ? cartridge.getVROM().data() : character_ram.data();
+        const std::size_t size = character_ram.empty() ? cartridge.getVROM().size() : character_ram.size();
+        const std::size_t chr_count = std::max<std::size_t>(1, size / Board::CHR_WINDOW);
+        for (int window = 0; window < static_cast<int>(0x2000 / Board::CHR_WINDOW); window++) {
+            std::size_t offset = wrapBank(Board::chrBank(registers, window), chr_count) * Board::CHR_WINDOW;
+            for (std::size_t page = 0; page < Board::CHR_WINDOW / 0x400; page++)
+                mapCHR(window * Board::CHR_WINDOW / 0x400 + page, 1, chr + (offset + page * 0x400) % size);
+        }
+    }
+
+    /// Return a bank number in range, counting negative banks from the end.
+    static inline std::size_t wrapBank(int bank, std::size_t count) {
+        return bank < 0 ? (count - (-bank % count)) % count : bank % count;
+    }
+
+    /// Return the mirroring the registers select.
+    NameTableMirroring selectMirroring() {
+        std::uint8_t header = cartridge.getNameTableMirroring();
+        // four screen boards wire the name tables past the mapper
+        if (header & FOUR_SCREEN)
+            return FOUR_SCREEN;
+        if constexpr (requires { Board::mirroring(registers); })
+            return Board::mirroring(registers);
+        return static_cast<NameTableMirroring>(header & VERTICAL);
+    }
+
+public:
+    /// Create a new mapper with a cartridge.
+    ///
+    /// @param cart a reference to a cartridge for the mapper to access
+    /// @param mirroring_cb the callback to signify a change in mirroring mode
+    /// @param interrupt_cb the callback to raise an interrupt on the CPU
+    ///
+    BoardMapper(Cartridge& cart, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb) :
+        Mapper(cart),
+        mirroring_callback(mirroring_cb),
+        interrupt_callback(interrupt_cb) {
+        if (cart.getVROM().size() == 0)
+            character_ram.resize(0x2000);
+        mirroring = selectMirroring();
+        mapBanks();
+    }
+
+    /// Decode a write into the registers of the board and remap the banks.
+    ///
+    /// @param address the 16-bit address to write to
+    /// @param value the byte to write to the given address
+    ///
+    void writePRG(std::uint16_t address, std::uint8_t value) {
+        if constexpr (requires { Board::HAS_BUS_CONFLICTS; }) {
+            // the ROM drives the bus too, so only bits both agree on are set
+            if (Board::HAS_BUS_CONFLICTS)
+                value &= readPRG(address);
+        }
+        if constexpr (requires { Board::decode(address); })
+            address = Board::decode(address);
+        for (const RegisterField& field : Board::FIELDS) {
+            if ((address & field.mask) != field.match)
+                continue;
+            std::uint16_t mask = ((1 << field.width) - 1) << field.reg_shift;
+            registers[field.reg] = (registers[field.reg] & ~mask) | (((value >> field.value_shift) << field.reg_shift) & mask);
+        }
+        if constexpr (requires { Board::onWrite(registers, address, value); })
+            Board::onWrite(registers, address, value);
+        mapBanks();
+        NameTableMirroring selected = selectMirroring();
+        if (selected != mirroring) {
+            mirroring = selected;
+            mirroring_callback();
+        }
+    }
+
+    /// Write a byte to an address in the CHR RAM.
+    ///
+    /// @param address the 16-bit address to write to
+    /// @param value the byte to write to the given address
+    ///
+    void writeCHR(std::uint16_t address, std::uint8_t value) {
+        if (character_ram.empty())
+            return;
+        // banks of CHR RAM wrap, so find the offset through the mapped page
+        std::size_t offset = chr_pages[address >> 10] - character_ram.data() + (address & 0x3ff);
+        character_ram[offset] = value;
+        mark_dirty(dirty_character_ram, offset);
+    }
+
+    /// Return the name table mirroring mode of this mapper.
+    inline NameTableMirroring getNameTableMirroring() { return mirroring; };
+
+    /// Return the signal that clocks the interrupt counter of this mapper.
+    inline IRQSource getIRQSource() {
+        if constexpr (requires { Board::IRQ_SOURCE; })
+            return Board::IRQ_SOURCE;
+        return NO_IRQ;
+    }
+
+    /// Clock the interrupt counter, holding the line while it's asserted.
+    void clockScanline() {
+        if constexpr (requires { Board::clockScanline(registers); }) {
+            if (Board::clockScanline(registers))
+                interrupt_callback();
+        }
+    }
+
+    /// Return true if this mapper switches CHR banks on PPU reads.
+    inline bool hasCHRLatch() { return requires { Board::latch(registers, 0); }; };
+
+    /// Flip the CHR latches on reads of their tiles.
+    ///
+    /// @param address the address the PPU read, $0000-$1FFF
+    ///
+    void latchCHR(std::uint16_t address) {
+        if constexpr (requires { Board::latch(registers, address); }) {
+            if (Board::latch(registers, address))
+                mapCHRBanks();
+        }
+    }
+
+    /// Serialize the mapper registers and RAM.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state) {
+        state.write(registers);
+        state.write_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
+    }
+
+    /// Deserialize the mapper registers and RAM.
+    ///
+    /// The banks and mirroring are derived from the registers.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state) {
+        state.read(registers);
+        state.read_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
+        mirroring = selectMirroring();
+        mapBanks();
+    }
+
+};
@@ -17,26 +17,12 @@ public:
     ///
     MapperCNROM(Cartridge& cart);
 
-    /// Read a byte from the PRG RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in PRG RAM
-    ///
-    std::uint8_t readPRG(std::uint16_t address);
-
     /// Write a byte to an address in the PRG RAM.
     ///
     /// @param address the 16-bit address to write to
     /// @param value the byte to write to the given address
     ///
-    inline void writePRG(std::uint16_t address, std::uint8_t value) { select_chr = value & 0x3; };
-
-    /// Read a byte from the CHR RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in CHR RAM
-    ///
-    inline std::uint8_t readCHR(std::uint16_t address) { return cartridge.getVROM()[address | (select_chr << 13)]; };
+    void writePRG(std::uint16_t address, std::uint8_t value);
 
     /// Write a byte to an address in the CHR RAM.
     ///
@@ -45,11 +31,16 @@ public:
     ///
     void writeCHR(std::uint16_t address, std::uint8_t value);
 
-    /// Return the page pointer for the given address.
+    /// Serialize the mapper registers and RAM.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the mapper registers and RAM.
     ///
-    /// @param address the address of the page pointer to get
-    /// @return the page pointer at the given address
+    /// @param state the reader to deserialize the state from
     ///
-    const std::uint8_t* getPagePtr(std::uint16_t address);
+    void load(StateReader& state);
 
 };
\ No newline at end of file
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "mappers/board_mapper.hpp"
+
+/// Color Dreams (mapper 11), a 32KB PRG bank and an 8KB CHR bank switched by
+/// a single register with bus conflicts
+struct ColorDreamsBoard {
+    enum { PRG_BANK, CHR_BANK, REGISTER_COUNT };
+
+    static constexpr RegisterField FIELDS[] = {
+        // $8000-$FFFF: CCCC xxPP
+        { 0x8000, 0x8000, PRG_BANK, 0, 2, 0 },
+        { 0x8000, 0x8000, CHR_BANK, 4, 4, 0 },
+    };
+
+    static constexpr std::size_t PRG_WINDOW = 0x8000;
+    static constexpr std::size_t CHR_WINDOW = 0x2000;
+    static constexpr bool HAS_BUS_CONFLICTS = true;
+
+    static inline int prgBank(const std::uint16_t* registers, int) { return registers[PRG_BANK]; };
+
+    static inline int chrBank(const std::uint16_t* registers, int) { return registers[CHR_BANK]; };
+};
+
+using MapperColorDreams = BoardMapper<ColorDreamsBoard>;
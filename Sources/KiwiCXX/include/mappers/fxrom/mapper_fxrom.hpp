@@ -0,0 +1,18 @@
+#pragma once
+
+#include "mappers/pxrom/mapper_pxrom.hpp"
+
+/// FxROM (MMC4, mapper 10), the latches of the MMC2 with a 16KB PRG bank at
+/// $8000 and the last bank fixed at $C000
+struct FxROMBoard : PxROMBoard {
+    static constexpr std::size_t PRG_WINDOW = 0x4000;
+
+    static inline int prgBank(const std::uint16_t* registers, int window) {
+        return window == 0 ? registers[PRG_BANK] : -1;
+    };
+
+    /// Flip a latch on a read of the high plane of tile $FD or $FE, any row.
+    static inline bool latch(std::uint16_t* registers, std::uint16_t address) { return flipTile(registers, address); };
+};
+
+using MapperFxROM = BoardMapper<FxROMBoard>;
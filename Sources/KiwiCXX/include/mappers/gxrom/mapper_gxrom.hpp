@@ -0,0 +1,25 @@
+#pragma once
+
+#include "mappers/board_mapper.hpp"
+
+/// GxROM (mapper 66), a 32KB PRG bank and an 8KB CHR bank switched by a
+/// single register with bus conflicts
+struct GxROMBoard {
+    enum { PRG_BANK, CHR_BANK, REGISTER_COUNT };
+
+    static constexpr RegisterField FIELDS[] = {
+        // $8000-$FFFF: xxPP xxCC
+        { 0x8000, 0x8000, PRG_BANK, 4, 2, 0 },
+        { 0x8000, 0x8000, CHR_BANK, 0, 2, 0 },
+    };
+
+    static constexpr std::size_t PRG_WINDOW = 0x8000;
+    static constexpr std::size_t CHR_WINDOW = 0x2000;
+    static constexpr bool HAS_BUS_CONFLICTS = true;
+
+    static inline int prgBank(const std::uint16_t* registers, int) { return registers[PRG_BANK]; };
+
+    static inline int chrBank(const std::uint16_t* registers, int) { return registers[CHR_BANK]; };
+};
+
+using MapperGxROM = BoardMapper<GxROMBoard>;
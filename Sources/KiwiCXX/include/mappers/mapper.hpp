@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
+#include <memory>
 
 #include "cartridge/cartridge.hpp"
+#include "state/state.hpp"
 
 enum NameTableMirroring {
     HORIZONTAL = 0,
@@ -19,6 +22,42 @@ class Mapper {
 protected:
     /// The cartridge this mapper associates with
     Cartridge& cartridge;
+    /// whether the mapper lets the CPU access the PRG RAM at $6000-$7FFF
+    bool is_prg_ram_enabled;
+    /// the 8KB pages of PRG memory at $8000-$FFFF
+    const std::uint8_t* prg_pages[4];
+    /// the 1KB pages of CHR memory at $0000-$1FFF
+    const std::uint8_t* chr_pages[8];
+    /// the page table of the picture bus the CHR pages are copied into
+    const std::uint8_t** page_table;
+
+    /// Map consecutive 1KB pages of CHR memory.
+    ///
+    /// @param page the first page to map, 0-7
+    /// @param count the number of pages to map
+    /// @param data the CHR memory to map the first page onto
+    ///
+    void mapCHR(int page, int count, const std::uint8_t* data);
+
+    /// Map consecutive 8KB pages of PRG memory.
+    ///
+    /// @param page the first page to map, 0-3
+    /// @param count the number of pages to map
+    /// @param data the PRG memory to map the first page onto
+    ///
+    void mapPRG(int page, int count, const std::uint8_t* data);
+
+    /// Return a bank of ROM, wrapped into the ROM so that no bank number,
+    /// whether written by the game or read from a save state, maps past it.
+    ///
+    /// @param rom the PRG or CHR ROM to take the bank from
+    /// @param bank the number of the bank
+    /// @param bank_size the size of a bank in bytes
+    /// @return a pointer to the first byte of the bank
+    ///
+    static inline const std::uint8_t* getBank(std::span<const std::uint8_t> rom, std::size_t bank, std::size_t bank_size) {
+        return rom.data() + bank % std::max<std::size_t>(1, rom.size() / bank_size) * bank_size;
+    };
 
 public:
     /// an enumeration of mapper IDs
@@ -27,29 +66,56 @@ public:
         SxROM = 1,
         UxROM = 2,
         CNROM = 3,
-        TxROM = 4
+        TxROM = 4,
+        AxROM = 7,
+        PxROM = 9,
+        FxROM = 10,
+        ColorDreams = 11,
+        VRC4ac = 21,
+        VRC2a = 22,
+        VRC4ef = 23,
+        VRC4bd = 25,
+        GxROM = 66
+    };
+
+    /// the signals the interrupt counter of a mapper can be clocked by
+    enum IRQSource {
+        /// the mapper has no interrupt counter
+        NO_IRQ,
+        /// the rising edge of PPU A12 on each rendered line (MMC3)
+        A12_IRQ,
+        /// CPU cycles, counted up at the end of every line (VRC4)
+        CPU_CYCLE_IRQ
     };
 
     /// Create a new mapper with a cartridge and given type.
     ///
     /// @param game a reference to a cartridge for the mapper to access
     ///
-    Mapper(Cartridge& game) : cartridge(game) { };
+    Mapper(Cartridge& game) : cartridge(game), is_prg_ram_enabled(true), prg_pages{}, chr_pages{}, page_table(nullptr) { };
+
+    virtual ~Mapper() = default;
 
     /// Create a mapper based on given type, a game cartridge.
     ///
     /// @param game a reference to a cartridge for the mapper to access
     /// @param mirroring_cb the callback to signify a change in mirroring mode
-    /// @return a pointer to a mapper class based on the given game
+    /// @return the mapper for the given game, or nullptr if it isn't supported
     ///
-    static Mapper* create(Cartridge& game, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb);
+    static std::unique_ptr<Mapper> create(Cartridge& game, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb);
 
-    /// Read a byte from the PRG RAM.
+    /// Return true if a mapper ID number has an implementation.
     ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in PRG RAM
+    /// @param number the mapper ID number from the ROM header
     ///
-    virtual std::uint8_t readPRG(std::uint16_t address) = 0;
+    static bool isSupported(std::uint16_t number);
+
+    /// Read a byte from the PRG memory through the mapped pages.
+    ///
+    /// @param address the 16-bit address of the byte to read, $8000-$FFFF
+    /// @return the byte located at the given address in PRG memory
+    ///
+    inline std::uint8_t readPRG(std::uint16_t address) { return prg_pages[(address >> 13) & 0x3][address & 0x1fff]; };
 
     /// Write a byte to an address in the PRG RAM.
     ///
@@ -58,12 +124,12 @@ public:
     ///
     virtual void writePRG(std::uint16_t address, std::uint8_t value) = 0;
 
-    /// Read a byte from the CHR RAM.
+    /// Read a byte from the CHR memory through the mapped pages.
     ///
     /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in CHR RAM
+    /// @return the byte located at the given address in CHR memory
     ///
-    virtual std::uint8_t readCHR(std::uint16_t address) = 0;
+    inline std::uint8_t readCHR(std::uint16_t address) { return chr_pages[address >> 10][address & 0x3ff]; };
 
     /// Write a byte to an address in the CHR RAM.
     ///
@@ -72,19 +138,72 @@ public:
     ///
     virtual void writeCHR(std::uint16_t address, std::uint8_t value) = 0;
 
-    /// Return the page pointer for the given address.
+    /// Keep the CHR pages in the first 8 entries of a page table as well.
+    ///
+    /// Bank switches update the table as they happen, so the owner of the
+    /// table reads CHR memory without calling the mapper.
     ///
-    /// @param address the address of the page pointer to get
-    /// @return the page pointer at the given address
+    /// @param table the page table, nullptr to stop updating it
     ///
-    virtual const std::uint8_t* getPagePtr(std::uint16_t address) = 0;
+    void setPageTable(const std::uint8_t** table);
+
+    /// Return a pointer into the PRG memory mapped at an address.
+    ///
+    /// The pointer stays valid to the end of its 8KB page, so it covers
+    /// the whole 256 byte page of any address at $8000-$FFFF.
+    ///
+    /// @param address the address to get the pointer for, $8000-$FFFF
+    /// @return the pointer to the byte mapped at the given address
+    ///
+    inline const std::uint8_t* getPagePtr(std::uint16_t address) { return prg_pages[(address >> 13) & 0x3] + (address & 0x1fff); };
 
     /// Return the name table mirroring mode of this mapper.
     inline virtual NameTableMirroring getNameTableMirroring() {
         return static_cast<NameTableMirroring>(cartridge.getNameTableMirroring());
     };
 
+    /// Return the signal that clocks the interrupt counter of this mapper.
+    inline virtual IRQSource getIRQSource() { return NO_IRQ; };
+
+    /// Clock the interrupt counter once a line, on a rising edge of PPU A12
+    /// or at the end of the line depending on its source.
+    inline virtual void clockScanline() { };
+
+    /// Return true if this mapper switches CHR banks on PPU reads of
+    /// particular tiles (MMC2 and MMC4).
+    inline virtual bool hasCHRLatch() { return false; };
+
+    /// Tell the latches of the mapper about a PPU read from pattern memory.
+    ///
+    /// The picture bus only calls this for addresses matching the mask
+    /// $0FC8, so the mapper has to check the address exactly.
+    ///
+    /// @param address the address the PPU read, $0000-$1FFF
+    ///
+    inline virtual void latchCHR(std::uint16_t) { };
+
     /// Return true if this mapper has extended RAM, false otherwise.
     inline bool hasExtendedRAM() { return cartridge.hasExtendedRAM(); };
 
+    /// Return true if the PRG RAM at $6000-$7FFF can be read and written.
+    inline bool isPRGRAMEnabled() { return is_prg_ram_enabled; };
+
+    /// Return the trainer to load at $7000, empty if there is none.
+    inline std::span<const std::uint8_t> getTrainer() { return cartridge.getTrainer(); };
+
+    /// Serialize the mapper registers and RAM.
+    ///
+    /// Bank pointers are stored as bank numbers, which loading wraps into
+    /// the cartridge data, so a state from another ROM can't map past it.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    virtual void save(StateWriter& state) = 0;
+
+    /// Deserialize the mapper registers and RAM.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    virtual void load(StateReader& state) = 0;
+
 };
\ No newline at end of file
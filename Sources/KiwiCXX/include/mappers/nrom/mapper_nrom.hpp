@@ -11,6 +11,8 @@ private:
     bool has_character_ram;
     /// the character RAM on the mapper
     std::vector<std::uint8_t> character_ram;
+    /// the pages of character RAM written since the last incremental snapshot
+    std::uint64_t dirty_character_ram = ~0ull;
 
 public:
     /// Create a new mapper with a cartridge.
@@ -19,13 +21,6 @@ public:
     ///
     MapperNROM(Cartridge& cart);
 
-    /// Read a byte from the PRG RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in PRG RAM
-    ///
-    std::uint8_t readPRG(std::uint16_t address);
-
     /// Write a byte to an address in the PRG RAM.
     ///
     /// @param address the 16-bit address to write to
@@ -33,13 +28,6 @@ public:
     ///
     void writePRG(std::uint16_t address, std::uint8_t value);
 
-    /// Read a byte from the CHR RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in CHR RAM
-    ///
-    std::uint8_t readCHR(std::uint16_t address);
-
     /// Write a byte to an address in the CHR RAM.
     ///
     /// @param address the 16-bit address to write to
@@ -47,11 +35,16 @@ public:
     ///
     void writeCHR(std::uint16_t address, std::uint8_t value);
 
-    /// Return the page pointer for the given address.
+    /// Serialize the mapper registers and RAM.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the mapper registers and RAM.
     ///
-    /// @param address the address of the page pointer to get
-    /// @return the page pointer at the given address
+    /// @param state the reader to deserialize the state from
     ///
-    const std::uint8_t* getPagePtr(std::uint16_t address);
+    void load(StateReader& state);
 
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "mappers/board_mapper.hpp"
+
+/// PxROM (MMC2, mapper 9), an 8KB PRG bank at $8000 and two 4KB CHR windows
+/// that each switch between two banks when the PPU reads tile $FD or $FE
+struct PxROMBoard {
+    enum {
+        PRG_BANK,
+        CHR0_FD,
+        CHR0_FE,
+        CHR1_FD,
+        CHR1_FE,
+        MIRRORING,
+        // the latches, 0 after a read of tile $FD and 1 after tile $FE
+        LATCH0,
+        LATCH1,
+        REGISTER_COUNT
+    };
+
+    static constexpr RegisterField FIELDS[] = {
+        { 0xf000, 0xa000, PRG_BANK, 0, 4, 0 },
+        { 0xf000, 0xb000, CHR0_FD, 0, 5, 0 },
+        { 0xf000, 0xc000, CHR0_FE, 0, 5, 0 },
+        { 0xf000, 0xd000, CHR1_FD, 0, 5, 0 },
+        { 0xf000, 0xe000, CHR1_FE, 0, 5, 0 },
+        { 0xf000, 0xf000, MIRRORING, 0, 1, 0 },
+    };
+
+    static constexpr std::size_t PRG_WINDOW = 0x2000;
+    static constexpr std::size_t CHR_WINDOW = 0x1000;
+
+    /// the last three banks are fixed at $A000-$FFFF
+    static inline int prgBank(const std::uint16_t* registers, int window) {
+        return window == 0 ? registers[PRG_BANK] : window - 4;
+    };
+
+    static inline int chrBank(const std::uint16_t* registers, int window) {
+        if (window == 0)
+            return registers[LATCH0] ? registers[CHR0_FE] : registers[CHR0_FD];
+        return registers[LATCH1] ? registers[CHR1_FE] : registers[CHR1_FD];
+    };
+
+    static inline NameTableMirroring mirroring(const std::uint16_t* registers) {
+        return registers[MIRRORING] ? HORIZONTAL : VERTICAL;
+    };
+
+    /// Flip a latch on a read of the high plane of tile $FD or $FE. The
+    /// MMC2 only decodes the first row of the tile in the low table.
+    static inline bool latch(std::uint16_t* registers, std::uint16_t address) {
+        if (address < 0x1000 && (address & 0x7) != 0)
+            return false;
+        return flipTile(registers, address);
+    };
+
+    /// Set the latch of a table on a read of any row of the high plane of
+    /// tile $FD or $FE, returning true if it changed.
+    static inline bool flipTile(std::uint16_t* registers, std::uint16_t address) {
+        // drop the table and the row, leaving the tile and plane
+        std::uint16_t tile = address & ~0x1007;
+        if (tile != 0x0fd8 && tile != 0x0fe8)
+            return false;
+        return flip(registers[address & 0x1000 ? LATCH1 : LATCH0], tile == 0x0fe8);
+    };
+
+    /// Set a latch, returning true if it changed.
+    static inline bool flip(std::uint16_t& latch, std::uint16_t value) {
+        bool is_changed = latch != value;
+        latch = value;
+        return is_changed;
+    };
+};
+
+using MapperPxROM = BoardMapper<PxROMBoard>;
@@ -35,10 +35,15 @@ private:
     const std::uint8_t* second_bank_chr;
     /// The character RAM on the cartridge
     std::vector<std::uint8_t> character_ram;
+    /// the pages of character RAM written since the last incremental snapshot
+    std::uint64_t dirty_character_ram = ~0ull;
 
     /// TODO: what does this do
     void calculatePRGPointers();
 
+    /// Map the CHR pages onto the CHR RAM or the two CHR banks.
+    void mapCHRPages();
+
 public:
     /// Create a new mapper with a cartridge.
     ///
@@ -47,13 +52,6 @@ public:
     ///
     MapperSxROM(Cartridge& cart, std::function<void(void)> mirroring_cb);
 
-    /// Read a byte from the PRG RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in PRG RAM
-    ///
-    std::uint8_t readPRG(std::uint16_t address);
-
     /// Write a byte to an address in the PRG RAM.
     ///
     /// @param address the 16-bit address to write to
@@ -61,13 +59,6 @@ public:
     ///
     void writePRG(std::uint16_t address, std::uint8_t value);
 
-    /// Read a byte from the CHR RAM.
-    ///
-    /// @param address the 16-bit address of the byte to read
-    /// @return the byte located at the given address in CHR RAM
-    ///
-    std::uint8_t readCHR(std::uint16_t address);
-
     /// Write a byte to an address in the CHR RAM.
     ///
     /// @param address the 16-bit address to write to
@@ -75,12 +66,17 @@ public:
     ///
     void writeCHR(std::uint16_t address, std::uint8_t value);
 
-    /// Return the page pointer for the given address.
+    /// Serialize the mapper registers and RAM.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the mapper registers and RAM.
     ///
-    /// @param address the address of the page pointer to get
-    /// @return the page pointer at the given address
+    /// @param state the reader to deserialize the state from
     ///
-    const std::uint8_t* getPagePtr(std::uint16_t address);
+    void load(StateReader& state);
 
     /// Return the name table mirroring mode of this mapper.
     inline NameTableMirroring getNameTableMirroring() { return mirroing; };
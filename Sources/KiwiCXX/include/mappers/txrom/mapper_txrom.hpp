@@ -10,6 +10,10 @@ private:
     std::function<void(void)> mirroring_callback;
     std::function<void(void)> interrupt_cb;
     NameTableMirroring mirroring = NameTableMirroring::HORIZONTAL;
+
+    /// Map the CHR pages onto the CHR banks.
+    void mapCHRPages();
+    void mapPRGPages();
 public:
     MapperTXROM(Cartridge& cart, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb);
 
@@ -21,17 +25,20 @@ public:
     bool chr_inversion = false;
     std::uint32_t bank_register[8]{};
 
-    std::vector<std::uint8_t> prg_ram, mirroring_ram;
+    std::vector<std::uint8_t> mirroring_ram;
+    std::uint64_t dirty_mirroring_ram = ~0ull;
 
-    bool irq_enabled = false, irq_pending = false;
+    bool irq_enabled = false, irq_pending = false, irq_asserted = false;
     std::uint8_t irq_count = 0, irq_latch = 0;
 
-    std::uint8_t readCHR(std::uint16_t address);
-    std::uint8_t readPRG(std::uint16_t address);
-
     void writeCHR(std::uint16_t address, std::uint8_t value);
     void writePRG(std::uint16_t address, std::uint8_t value);
 
-    const std::uint8_t* getPagePtr(std::uint16_t address);
     inline NameTableMirroring getNameTableMirroring() { return mirroring; };
+
+    inline IRQSource getIRQSource() { return A12_IRQ; };
+    void clockScanline();
+
+    void save(StateWriter& state);
+    void load(StateReader& state);
 };
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "mappers/board_mapper.hpp"
+
+/// Konami VRC2 and VRC4 (mappers 21, 22, 23 and 25), two 8KB PRG banks,
+/// eight 1KB CHR banks and, on the VRC4, an interrupt counter clocked by the
+/// CPU.
+///
+/// The boards wire the register select pins of the chip to different CPU
+/// address lines. The iNES mapper numbers each cover two wirings, so both
+/// lines are ORed into the pin as most emulators do.
+///
+/// @tparam A0 the CPU address line on register select pin 0
+/// @tparam A1 the CPU address line on register select pin 1
+/// @tparam ALT_A0 the line on pin 0 for the other wiring
+/// @tparam ALT_A1 the line on pin 1 for the other wiring
+/// @tparam CHR_SHIFT the shift of the CHR banks, 1 on the VRC2a which
+///         ignores the low bit
+template <int A0, int A1, int ALT_A0, int ALT_A1, int CHR_SHIFT = 0>
+struct VRCBoard {
+    enum {
+        PRG_BANK0,
+        PRG_BANK1,
+        PRG_MODE,
+        MIRRORING,
+        CHR_BANK0,
+        CHR_BANK1,
+        CHR_BANK2,
+        CHR_BANK3,
+        CHR_BANK4,
+        CHR_BANK5,
+        CHR_BANK6,
+        CHR_BANK7,
+        IRQ_LATCH,
+        // bit 0 re-enables on acknowledge, bit 1 enables, bit 2 counts cycles
+        IRQ_CONTROL,
+        IRQ_COUNTER,
+        // the CPU cycles owed to the counter, in thirds
+        IRQ_PRESCALER,
+        IRQ_ASSERTED,
+        REGISTER_COUNT
+    };
+
+    static constexpr RegisterField FIELDS[] = {
+        { 0xf000, 0x8000, PRG_BANK0, 0, 5, 0 },
+        { 0xf003, 0x9000, MIRRORING, 0, 2, 0 },
+        { 0xf003, 0x9002, PRG_MODE, 1, 1, 0 },
+        { 0xf000, 0xa000, PRG_BANK1, 0, 5, 0 },
+        // each CHR bank is written a nibble at a time
+        { 0xf003, 0xb000, CHR_BANK0, 0, 4, 0 },
+        { 0xf003, 0xb001, CHR_BANK0, 0, 5, 4 },
+        { 0xf003, 0xb002, CHR_BANK1, 0, 4, 0 },
+        { 0xf003, 0xb003, CHR_BANK1, 0, 5, 4 },
+        { 0xf003, 0xc000, CHR_BANK2, 0, 4, 0 },
+        { 0xf003, 0xc001, CHR_BANK2, 0, 5, 4 },
+        { 0xf003, 0xc002, CHR_BANK3, 0, 4, 0 },
+        { 0xf003, 0xc003, CHR_BANK3, 0, 5, 4 },
+        { 0xf003, 0xd000, CHR_BANK4, 0, 4, 0 },
+        { 0xf003, 0xd001, CHR_BANK4, 0, 5, 4 },
+        { 0xf003, 0xd002, CHR_BANK5, 0, 4, 0 },
+        { 0xf003, 0xd003, CHR_BANK5, 0, 5, 4 },
+        { 0xf003, 0xe000, CHR_BANK6, 0, 4, 0 },
+        { 0xf003, 0xe001, CHR_BANK6, 0, 5, 4 },
+        { 0xf003, 0xe002, CHR_BANK7, 0, 4, 0 },
+        { 0xf003, 0xe003, CHR_BANK7, 0, 5, 4 },
+        { 0xf003, 0xf000, IRQ_LATCH, 0, 4, 0 },
+        { 0xf003, 0xf001, IRQ_LATCH, 0, 4, 4 },
+        { 0xf003, 0xf002, IRQ_CONTROL, 0, 3, 0 },
+    };
+
+    static constexpr std::size_t PRG_WINDOW = 0x2000;
+    static constexpr std::size_t CHR_WINDOW = 0x400;
+    static constexpr Mapper::IRQSource IRQ_SOURCE = Mapper::CPU_CYCLE_IRQ;
+
+    /// Gather the register select lines into bits 0 and 1.
+    static inline std::uint16_t decode(std::uint16_t address) {
+        std::uint16_t select = ((address >> A0) | (address >> ALT_A0)) & 1;
+        select |= (((address >> A1) | (address >> ALT_A1)) & 1) << 1;
+        return (address & 0xf000) | select;
+    };
+
+    /// the mode swaps the switched bank at $8000 with the fixed one at $C000
+    static inline int prgBank(const std::uint16_t* registers, int window) {
+        switch (window) {
+        case 0:  return registers[PRG_MODE] ? -2 : registers[PRG_BANK0];
+        case 1:  return registers[PRG_BANK1];
+        case 2:  return registers[PRG_MODE] ? registers[PRG_BANK0] : -2;
+        default: return -1;
+        }
+    };
+
+    static inline int chrBank(const std::uint16_t* registers, int window) {
+        return registers[CHR_BANK0 + window] >> CHR_SHIFT;
+    };
+
+    static inline NameTableMirroring mirroring(const std::uint16_t* registers) {
+        switch (registers[MIRRORING]) {
+        case 0:  return VERTICAL;
+        case 1:  return HORIZONTAL;
+        case 2:  return ONE_SCREEN_LOWER;
+        default: return ONE_SCREEN_HIGHER;
+        }
+    };
+
+    /// Writes to the control and acknowledge registers acknowledge the
+    /// interrupt, and enabling the counter reloads it.
+    static inline void onWrite(std::uint16_t* registers, std::uint16_t address, std::uint8_t) {
+        if ((address & 0xf003) == 0xf002) {
+            registers[IRQ_ASSERTED] = 0;
+            if (registers[IRQ_CONTROL] & 0x2) {
+                registers[IRQ_COUNTER] = registers[IRQ_LATCH];
+                registers[IRQ_PRESCALER] = 0;
+            }
+        }
+        else if ((address & 0xf003) == 0xf003) {
+            registers[IRQ_ASSERTED] = 0;
+            // the enable-after-acknowledge bit is copied into the enable bit
+            registers[IRQ_CONTROL] = (registers[IRQ_CONTROL] & ~0x2) | ((registers[IRQ_CONTROL] & 0x1) << 1);
+        }
+    };
+
+    /// Run the counter for the CPU cycles of a line.
+    ///
+    /// The chip's prescaler clocks the counter every 341 thirds of a cycle,
+    /// once a line, unless it's counting cycles. The counter is run a line
+    /// at a time, so an interrupt can be raised up to a line late.
+    ///
+    /// @return true while the interrupt is asserted
+    ///
+    static inline bool clockScanline(std::uint16_t* registers) {
+        if (registers[IRQ_CONTROL] & 0x2) {
+            int clocks = 1;
+            if (registers[IRQ_CONTROL] & 0x4) {
+                registers[IRQ_PRESCALER] += 341;
+                clocks = registers[IRQ_PRESCALER] / 3;
+                registers[IRQ_PRESCALER] %= 3;
+            }
+            // the counter reloads and interrupts on each clock past $FF
+            while (clocks >= 0x100 - registers[IRQ_COUNTER]) {
+                clocks -= 0x100 - registers[IRQ_COUNTER];
+                registers[IRQ_COUNTER] = registers[IRQ_LATCH];
+                registers[IRQ_ASSERTED] = 1;
+            }
+            registers[IRQ_COUNTER] += clocks;
+        }
+        return registers[IRQ_ASSERTED];
+    };
+};
+
+/// VRC4a and VRC4c
+using MapperVRC4ac = BoardMapper<VRCBoard<1, 2, 6, 7>>;
+/// VRC2a
+using MapperVRC2a = BoardMapper<VRCBoard<1, 0, 1, 0, 1>>;
+/// VRC2b, VRC4e and VRC4f
+using MapperVRC4ef = BoardMapper<VRCBoard<0, 1, 2, 3>>;
+/// VRC2c, VRC4b and VRC4d
+using MapperVRC4bd = BoardMapper<VRCBoard<1, 0, 3, 2>>;
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "emulator.hpp"
+
+/// The magic number at the start of every movie file ("KIWM")
+const std::uint32_t MOVIE_MAGIC = 0x4d57494b;
+/// The version of the movie file layout, bump when the layout changes
+const std::uint16_t MOVIE_VERSION = 2;
+/// The most frames a movie file can hold, a day of play at 60 frames a second
+const std::uint32_t MOVIE_MAX_FRAMES = 60 * 60 * 60 * 24;
+
+/// A recording of the controller input for every frame of a session.
+///
+/// The input of both controllers is captured at the start of every frame,
+/// before the step that latches it with a strobe. A compressed save state is
+/// embedded every few frames so seeking only replays from the nearest one.
+class Movie {
+
+private:
+    /// A compressed save state embedded in the movie
+    struct Keyframe {
+        /// the frame the state was captured at the start of
+        std::uint32_t frame;
+        /// the compressed save state
+        std::vector<std::uint8_t> state;
+    };
+
+    /// the number of frames between keyframes
+    std::uint32_t keyframe_interval;
+    /// the size of an uncompressed save state in bytes
+    std::uint32_t state_size;
+    /// the hash of the ROM the movie was recorded on
+    std::uint64_t rom_hash;
+    /// the input of both controllers for every frame
+    std::vector<std::uint8_t> inputs;
+    /// the keyframes in order of frame
+    std::vector<Keyframe> keyframes;
+    /// the next frame to record or play
+    std::size_t frame;
+    /// the buffer used to save and compress states
+    std::vector<std::uint8_t> state_buffer;
+    /// the output of the compressor
+    std::vector<std::uint8_t> scratch;
+
+    /// Append a keyframe of the emulator's current state.
+    void capture_keyframe(Emulator& emulator);
+
+public:
+    /// The number of bytes of input recorded per frame
+    const static std::size_t INPUT_SIZE = 2;
+
+    /// Initialize a new empty movie.
+    ///
+    /// @param keyframe_interval the number of frames between keyframes
+    ///
+    Movie(std::uint32_t keyframe_interval = 300);
+
+    /// Start a new recording from the emulator's current state.
+    void start_recording(Emulator& emulator);
+
+    /// Record the input for the next frame, call before each step.
+    void record(Emulator& emulator);
+
+    /// Apply the input for the next frame, call before each step.
+    ///
+    /// @return false if there are no frames left to play
+    ///
+    bool play(Emulator& emulator);
+
+    /// Restore the nearest keyframe and replay headless up to a frame.
+    ///
+    /// Playing from frame 0 is the same as playing from power-on.
+    ///
+    /// @param emulator the emulator running the movie's cartridge
+    /// @param target the frame to seek to
+    /// @return false if the frame is past the end or the state does not
+    ///         belong to the emulator
+    ///
+    bool seek(Emulator& emulator, std::size_t target);
+
+    /// Return the number of frames in the movie.
+    inline std::size_t get_frame_count() { return inputs.size() / INPUT_SIZE; };
+
+    /// Return the next frame to record or play.
+    inline std::size_t get_frame() { return frame; };
+
+    /// Write the movie to a file.
+    ///
+    /// @param path the path of the file to write
+    /// @return true if the whole movie was written, false if it couldn't be
+    ///         or is longer than MOVIE_MAX_FRAMES
+    ///
+    bool save(std::string path);
+
+    /// Read a movie from a file.
+    ///
+    /// @param path the path of the file to read
+    /// @param emulator the emulator the movie will be played on
+    /// @return true if the file was a valid movie recorded on the same ROM
+    ///         with the same save state size as the emulator
+    ///
+    bool load(std::string path, Emulator& emulator);
+
+};
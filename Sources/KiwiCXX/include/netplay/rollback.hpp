@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "emulator.hpp"
+#include "netplay/transport.hpp"
+
+/// A two player netplay session that hides latency with rollback.
+///
+/// Each frame runs immediately with the local input and a prediction of the
+/// remote input (the last input received from the remote peer). When the real
+/// remote input arrives and differs from the prediction, the emulator loads
+/// the save state from the first mispredicted frame and re-simulates up to
+/// the present without drawing, before running and drawing the new frame.
+///
+/// Once a frame's inputs are confirmed by both peers a hash of its save state
+/// is exchanged, so a desync is detected within a few frames of happening.
+class RollbackSession {
+
+private:
+    /// The number of frames of input kept, must be a power of 2
+    const static int INPUT_RING = 256;
+    /// The number of frames of state hashes kept, must be a power of 2
+    const static int HASH_RING = 64;
+    /// The largest packet the session sends
+    const static std::size_t PACKET_SIZE = 4 + 4 + 1 + INPUT_RING - 1 + 4 + 8;
+
+    /// the emulator the session runs
+    Emulator& emulator;
+    /// the connection to the remote peer
+    Transport& transport;
+    /// the controller port of the local player
+    int local_port;
+    /// the most frames that may run ahead of the remote input
+    int max_rollback;
+
+    /// the save state at the start of each of the last max_rollback frames
+    std::vector<std::uint8_t> states;
+    /// the local input for each frame
+    std::array<std::uint8_t, INPUT_RING> local_inputs;
+    /// the remote input for each frame
+    std::array<std::uint8_t, INPUT_RING> remote_inputs;
+    /// the frame each remote input belongs to, or -1 if none has arrived
+    std::array<std::int32_t, INPUT_RING> remote_frames;
+    /// the remote input each frame was last simulated with
+    std::array<std::uint8_t, INPUT_RING> simulated_inputs;
+    /// the local state hash for each frame
+    std::array<std::uint64_t, HASH_RING> local_hashes;
+    /// the frame each local state hash belongs to
+    std::array<std::int32_t, HASH_RING> local_hash_frames;
+    /// the remote state hash for each frame
+    std::array<std::uint64_t, HASH_RING> remote_hashes;
+    /// the frame each remote state hash belongs to
+    std::array<std::int32_t, HASH_RING> remote_hash_frames;
+    /// the buffer packets are built and received in
+    std::array<std::uint8_t, PACKET_SIZE> packet;
+
+    /// the next frame to run
+    std::int32_t frame;
+    /// the next frame to take local input for (later with input delay)
+    std::int32_t local_frame;
+    /// the last frame with every remote input up to it received
+    std::int32_t confirmed_frame;
+    /// the first frame the remote peer hasn't received local input for
+    std::int32_t remote_ack;
+    /// the first mispredicted frame, or -1 if none
+    std::int32_t rollback_frame;
+    /// the last frame with a local state hash
+    std::int32_t hashed_frame;
+    /// the first frame the state hashes differed on, or -1 if none
+    std::int32_t desync_frame;
+
+    /// the number of frames re-simulated in the last advance
+    int rollback_frames;
+    /// the time spent rolling back in the last advance in nanoseconds
+    std::int64_t rollback_time;
+
+    /// Return the save state slot for a frame.
+    inline std::uint8_t* state_at(std::int32_t frame) { return states.data() + (frame % max_rollback) * emulator.state_size(); };
+
+    /// Return the remote input for a frame, or a prediction if it hasn't arrived.
+    std::uint8_t remote_input(std::int32_t frame);
+
+    /// Save the state at the start of a frame and run it.
+    void run_frame(std::int32_t frame);
+
+    /// Compare a local and remote state hash for a frame if both are known.
+    void check_hash(std::int32_t frame);
+
+    /// Receive every waiting packet from the remote peer.
+    void receive();
+
+    /// Send the unacknowledged local input and newest state hash.
+    void send();
+
+public:
+    /// Initialize a new rollback session.
+    ///
+    /// Both peers must start from the same state on the same cartridge.
+    ///
+    /// @param emulator the emulator to run the session on
+    /// @param transport the connection to the remote peer
+    /// @param local_port the controller port of the local player (0 or 1)
+    /// @param max_rollback the most frames that may run ahead of the remote input
+    /// @param input_delay the number of frames local input is delayed by
+    ///
+    RollbackSession(Emulator& emulator, Transport& transport, int local_port, int max_rollback = 8, int input_delay = 0);
+
+    /// Run the next frame with the local input, rolling back if needed.
+    ///
+    /// Call this once per frame. If the remote input is too far behind the
+    /// frame doesn't run and the input is not used, call again next frame.
+    ///
+    /// @param input the button bitmap of the local player
+    /// @return true if a frame was run
+    ///
+    bool advance(std::uint8_t input);
+
+    /// Return the next frame to run.
+    inline std::int32_t get_frame() { return frame; };
+
+    /// Return the number of frames re-simulated in the last advance.
+    inline int get_rollback_frames() { return rollback_frames; };
+
+    /// Return the time spent rolling back in the last advance in nanoseconds.
+    inline std::int64_t get_rollback_time() { return rollback_time; };
+
+    /// Return true if the peers' states have diverged.
+    inline bool is_desynced() { return desync_frame >= 0; };
+
+    /// Return the first frame the state hashes differed on, or -1 if none.
+    inline std::int32_t get_desync_frame() { return desync_frame; };
+
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// An abstraction of an unreliable connection to the remote peer.
+///
+/// Packets may be dropped, delayed or reordered, the netplay session sends
+/// every input redundantly until the remote peer acknowledges it.
+class Transport {
+
+public:
+    virtual ~Transport() = default;
+
+    /// Send a packet to the remote peer.
+    ///
+    /// @param data a pointer to the bytes of the packet
+    /// @param size the number of bytes in the packet
+    ///
+    virtual void send(const std::uint8_t* data, std::size_t size) = 0;
+
+    /// Receive the next packet from the remote peer without blocking.
+    ///
+    /// @param data the buffer to receive the packet into
+    /// @param capacity the size of the buffer in bytes
+    /// @return the number of bytes in the packet, or 0 if there is none
+    ///
+    virtual std::size_t receive(std::uint8_t* data, std::size_t capacity) = 0;
+
+};
+
+/// A transport that hands packets to another transport in the same process.
+///
+/// Both ends may be used from different threads. Packets are held back for a
+/// number of sends to stand in for network latency.
+class LoopbackTransport : public Transport {
+
+private:
+    /// the packets waiting to be received, shared with the peer
+    struct Channel {
+        /// the lock guarding the packets
+        std::mutex lock;
+        /// the packets in order of delivery
+        std::deque<std::vector<std::uint8_t>> packets;
+    };
+
+    /// the packets sent to this end
+    std::shared_ptr<Channel> inbox;
+    /// the packets sent to the other end
+    std::shared_ptr<Channel> outbox;
+    /// the number of sends a packet is held back for
+    std::size_t latency;
+    /// the packets held back before delivery
+    std::deque<std::vector<std::uint8_t>> in_flight;
+
+public:
+    /// Initialize a new loopback transport that is not connected.
+    ///
+    /// @param latency the number of sends each packet is held back for
+    ///
+    LoopbackTransport(std::size_t latency = 0);
+
+    /// Connect two loopback transports to each other.
+    static void connect(LoopbackTransport& a, LoopbackTransport& b);
+
+    void send(const std::uint8_t* data, std::size_t size) override;
+
+    std::size_t receive(std::uint8_t* data, std::size_t capacity) override;
+
+};
+
+/// A transport over a non-blocking UDP socket.
+class UDPTransport : public Transport {
+
+private:
+    /// the file descriptor of the socket, or -1 if it failed to open
+    int socket_fd;
+
+public:
+    /// Initialize a new UDP transport.
+    ///
+    /// @param local_port the port to receive packets on
+    /// @param remote_address the IPv4 address of the remote peer
+    /// @param remote_port the port the remote peer receives packets on
+    ///
+    UDPTransport(std::uint16_t local_port, std::string remote_address = "127.0.0.1", std::uint16_t remote_port = 0);
+
+    ~UDPTransport();
+
+    UDPTransport(const UDPTransport&) = delete;
+    UDPTransport& operator=(const UDPTransport&) = delete;
+
+    /// Return true if the socket was opened and connected.
+    inline bool is_open() { return socket_fd >= 0; };
+
+    void send(const std::uint8_t* data, std::size_t size) override;
+
+    std::size_t receive(std::uint8_t* data, std::size_t capacity) override;
+
+};
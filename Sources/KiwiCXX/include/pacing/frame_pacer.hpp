@@ -0,0 +1,134 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "emulator.hpp"
+
+/// Paces an emulator by its audio output instead of a host timer.
+///
+/// The host's audio thread drains the emulator's audio ring at the host's
+/// clock. Before each frame the pacer looks at how much audio is queued: it
+/// waits when the emulator is ahead, skips drawing frames when the host has
+/// fallen behind, and otherwise nudges the resampling ratio by a fraction of
+/// a percent so the queue settles at the target latency instead of slowly
+/// draining or filling up as the two clocks drift.
+class FramePacer {
+
+public:
+    /// Latency and jitter statistics for monitoring
+    struct Stats {
+        /// the audio queued when the last frame started in milliseconds
+        double latency;
+        /// the mean of the queued audio in milliseconds
+        double mean_latency;
+        /// the least audio queued in milliseconds
+        double min_latency;
+        /// the most audio queued in milliseconds
+        double max_latency;
+        /// the standard deviation of the queued audio in milliseconds
+        double latency_jitter;
+        /// the mean time between the starts of frames in milliseconds
+        double mean_interval;
+        /// the standard deviation of the time between frames in milliseconds
+        double interval_jitter;
+        /// the resampling ratio applied to the last frame
+        double ratio;
+        /// the number of frames drawn
+        std::uint64_t frames;
+        /// the number of frames skipped to catch up
+        std::uint64_t skipped_frames;
+        /// the number of frames that found the audio queue empty
+        std::uint64_t underruns;
+    };
+
+private:
+    /// A running mean, deviation and range of a series of values
+    struct Statistic {
+        /// the number of values
+        std::uint64_t count;
+        /// the mean of the values
+        double mean;
+        /// the sum of the squared differences from the mean
+        double m2;
+        /// the least value
+        double min;
+        /// the greatest value
+        double max;
+
+        /// Add a value to the series.
+        void add(double value);
+
+        /// Return the standard deviation of the series.
+        double get_deviation() const;
+    };
+
+    /// the emulator to pace
+    Emulator& emulator;
+    /// the audio to keep queued in seconds
+    double target_latency;
+    /// the largest change of the resampling ratio from 1
+    double max_adjustment;
+    /// the most frames to skip before drawing one
+    int max_skip;
+    /// whether to sleep while the emulator is ahead of the host
+    bool is_blocking;
+
+    /// the resampling ratio applied to the last frame
+    double ratio;
+    /// the audio queued when the last frame started in seconds
+    double latency;
+    /// the audio queued when each frame started in milliseconds
+    Statistic latency_stat;
+    /// the time between the starts of frames in milliseconds
+    Statistic interval_stat;
+    /// the number of frames drawn
+    std::uint64_t frames;
+    /// the number of frames skipped to catch up
+    std::uint64_t skipped_frames;
+    /// the number of frames that found the audio queue empty
+    std::uint64_t underruns;
+    /// when the last frame started
+    std::chrono::steady_clock::time_point last_start;
+
+public:
+    /// Initialize a new pacer.
+    ///
+    /// @param emulator the emulator to pace, which must not be headless
+    /// @param target_latency the audio to keep queued in seconds
+    /// @param max_adjustment the largest change of the resampling ratio from
+    ///        1, at most 0.05
+    /// @param max_skip the most frames to skip before drawing one
+    ///
+    FramePacer(Emulator& emulator, double target_latency = 0.05, double max_adjustment = 0.005, int max_skip = 3);
+
+    /// Run the emulator for one frame of the host.
+    ///
+    /// Call this in place of the emulator's step. It waits while too much
+    /// audio is queued (if blocking), runs frames without drawing them while
+    /// too little is, then steers the resampling ratio and steps. A headless
+    /// emulator produces no audio and is simply stepped.
+    ///
+    /// @return the number of frames skipped before the drawn one
+    ///
+    int step();
+
+    /// Set whether the pacer sleeps while the emulator is ahead of the host.
+    ///
+    /// Hosts presenting on vertical sync may turn this off and rely on the
+    /// resampling ratio alone.
+    ///
+    /// @param is_blocking false to never sleep
+    ///
+    inline void set_blocking(bool is_blocking) { this->is_blocking = is_blocking; };
+
+    /// Return true if the pacer sleeps while the emulator is ahead.
+    inline bool get_blocking() { return is_blocking; };
+
+    /// Return the latency and jitter statistics since the last reset.
+    Stats get_stats();
+
+    /// Clear the statistics.
+    void reset_stats();
+
+};
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "ppu/ppu_bus.hpp"
+#include "state/state.hpp"
 
 /// The number of visible scan lines (i.e., the height of the screen)
 const int VISIBLE_SCANLINES = 240;
@@ -23,8 +24,16 @@ class PPU {
 private:
     /// The callback to fire when entering vertical blanking mode
     std::function<void(void)> vblank_callback;
+    /// The callback to fire when the pattern fetches of a line raise A12
+    std::function<void(void)> scanline_callback;
+    /// the dot of each rendered line A12 rises on, or -1 if it doesn't
+    int a12_dot;
+    /// whether the scanline callback fires at the end of every line instead
+    bool is_every_line;
     /// The OAM memory (sprites)
     std::vector<std::uint8_t> sprite_memory;
+    /// whether OAM was written since the last incremental snapshot
+    std::uint64_t dirty_sprite_memory;
     /// OAM memory (sprites) for the next scanline
     std::vector<std::uint8_t> scanline_sprites;
 
@@ -89,17 +98,27 @@ private:
         HIGH,
     } background_page, sprite_page;
 
+    /// Predict the dot the pattern fetches raise A12 on from the pattern
+    /// tables and the mask, in place of watching every fetch.
+    void update_A12_dot();
+
     /// The value to increment the data address by
     std::uint16_t data_address_increment;
 
+    /// whether pixels are computed without being written to the screen
+    bool is_render_suppressed;
+
+    /// the visible scanlines drawn into the screen since the PPU was created
+    std::uint64_t rendered_scanlines;
+
     /// The internal screen data structure as a vector representation of a
     /// matrix of height matching the visible scans lines and width matching
-    /// the number of visible scan line dots
-    std::uint32_t screen[VISIBLE_SCANLINES][SCANLINE_VISIBLE_DOTS];
+    /// the number of visible scan line dots, empty once released
+    std::vector<std::uint32_t> screen;
 
 public:
     /// Initialize a new PPU.
-    PPU() : sprite_memory(64 * 4) { };
+    PPU() : a12_dot(-1), is_every_line(false), sprite_memory(64 * 4), dirty_sprite_memory(~0ull), is_render_suppressed(false), rendered_scanlines(0), screen(VISIBLE_SCANLINES * SCANLINE_VISIBLE_DOTS) { reset(); };
 
     /// Perform a single cycle on the PPU.
     void cycle(PictureBus& bus);
@@ -110,6 +129,19 @@ public:
     /// Set the interrupt callback for the CPU.
     inline void set_interrupt_callback(std::function<void(void)> cb) { vblank_callback = cb; };
 
+    /// Set the callback for the rising edge of A12 on each rendered line.
+    ///
+    /// Scanline counting mappers (MMC3) are clocked by A12. The edge falls
+    /// on a dot predicted from the pattern table setup, so the callback
+    /// costs nothing on the dots that draw pixels. Mappers counting CPU
+    /// cycles (VRC4) are clocked at the end of all 262 lines instead,
+    /// whether or not the PPU is rendering.
+    ///
+    /// @param cb the callback, or nullptr for mappers that don't count lines
+    /// @param is_every_line true to fire at the end of every line
+    ///
+    void set_scanline_callback(std::function<void(void)> cb, bool is_every_line = false);
+
     /// TODO: doc
     void do_DMA(const std::uint8_t* page_ptr);
 
@@ -164,9 +196,48 @@ public:
     ///
     /// @param value the byte to write to the given address
     ///
-    inline void set_OAM_data(std::uint8_t value) { sprite_memory[sprite_data_address++] = value; };
+    inline void set_OAM_data(std::uint8_t value) { mark_dirty(dirty_sprite_memory, 0); sprite_memory[sprite_data_address++] = value; };
+
+    /// Clear the object attribute memory and screen to their power on state.
+    void clear();
+
+    /// Return a pointer to the screen buffer, or nullptr if it was released.
+    inline std::uint32_t* get_screen_buffer() { return screen.empty() ? nullptr : screen.data(); };
+
+    /// Free (or reallocate) the screen buffer.
+    ///
+    /// Rendering stays suppressed while there is no screen buffer.
+    ///
+    /// @param is_allocated false to free the screen buffer
+    ///
+    void set_screen_allocated(bool is_allocated);
+
+    /// Return the number of bytes held by the screen buffer.
+    inline std::size_t get_screen_size() { return screen.capacity() * sizeof(std::uint32_t); };
+
+    /// Stop (or resume) writing pixels to the screen buffer.
+    ///
+    /// Everything else, including sprite zero hits, still runs so frames
+    /// rendered this way can be discarded without changing the emulation.
+    ///
+    /// @param is_suppressed true to leave the screen buffer untouched
+    ///
+    inline void set_render_suppressed(bool is_suppressed) { is_render_suppressed = is_suppressed || screen.empty(); };
 
-    /// Return a pointer to the screen buffer.
-    inline std::uint32_t* get_screen_buffer() { return *screen; };
+    /// Return the visible scanlines drawn into the screen since the PPU was
+    /// created.
+    inline std::uint64_t get_rendered_scanlines() { return rendered_scanlines; };
+
+    /// Serialize the PPU state, excluding the screen buffer.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the PPU state, excluding the screen buffer.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state);
 
 };
\ No newline at end of file
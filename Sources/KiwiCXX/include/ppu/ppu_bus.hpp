@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "mappers/mapper.hpp"
+#include "state/state.hpp"
 
 class PictureBus {
 
@@ -13,22 +14,47 @@ private:
     /// indexes where they start in RAM vector
     // std::size_t NameTable0, NameTable1, NameTable2, NameTable3;
     std::size_t name_tables[4] = { 0, 0, 0, 0 };
+    /// the 1KB pages of $0000-$3FFF, the CHR pages of the mapper followed
+    /// by the name tables mirrored up to $3FFF
+    const std::uint8_t* pages[16] = {};
     /// the palette for decoding RGB tuples
     std::vector<std::uint8_t> palette;
+    /// the pages of VRAM written since the last incremental snapshot
+    std::uint64_t dirty_ram;
+    /// the pages of the palette written since the last incremental snapshot
+    std::uint64_t dirty_palette;
     /// a pointer to the mapper on the cartridge
     Mapper* mapper;
+    /// whether the mapper hears about reads of its latch tiles
+    bool is_latching;
 
 public:
     /// Initialize a new picture bus.
-    PictureBus() : ram(0x800), palette(0x20), mapper(nullptr) { };;
+    PictureBus() : ram(0x800), palette(0x20), dirty_ram(~0ull), dirty_palette(~0ull), mapper(nullptr), is_latching(false) { };;
 
     /// Read a byte from an address on the VRAM.
     ///
+    /// Everything below the palette is a single load through the page table,
+    /// plus a check for the latch tiles when the mapper has CHR latches.
+    ///
     /// @param address the 16-bit address of the byte to read in the VRAM
     ///
     /// @return the byte located at the given address
     ///
-    std::uint8_t read(std::uint16_t address);
+    inline std::uint8_t read(std::uint16_t address) {
+        address &= 0x3fff;
+        if (address < 0x3f00) {
+            std::uint8_t value = pages[address >> 10][address & 0x3ff];
+            // MMC2 and MMC4 switch banks after reads of tiles $FD and $FE
+            if (is_latching && (address & 0x2fc8) == 0x0fc8)
+                mapper->latchCHR(address);
+            return value;
+        }
+        return palette[address & 0x1f];
+    };
+
+    /// Return whether reads of pattern memory can switch the CHR banks.
+    inline bool has_CHR_latch() const { return is_latching; };
 
     /// Write a byte to an address in the VRAM.
     ///
@@ -41,7 +67,7 @@ public:
     ///
     /// @param mapper the new mapper pointer for the bus to use
     ///
-    inline void set_mapper(Mapper* mapper) { this->mapper = mapper; update_mirroring(); };
+    void set_mapper(Mapper* mapper);
 
     /// Read a color index from the palette.
     ///
@@ -51,7 +77,24 @@ public:
     ///
     inline std::uint8_t read_palette(std::uint8_t address) { return palette[address]; };
 
-    /// Update the mirroring and name table from the mapper.
+    /// Update the mirroring and name table pages from the mapper.
     void update_mirroring();
 
+    /// Clear the VRAM and palette to their power on state.
+    void clear();
+
+    /// Serialize the VRAM and palette on the bus.
+    ///
+    /// @param state the writer to serialize the state into
+    ///
+    void save(StateWriter& state);
+
+    /// Deserialize the VRAM and palette on the bus.
+    ///
+    /// The mapper state must be loaded first so the mirroring is correct.
+    ///
+    /// @param state the reader to deserialize the state from
+    ///
+    void load(StateReader& state);
+
 };
\ No newline at end of file
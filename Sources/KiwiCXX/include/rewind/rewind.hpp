@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// A bounded ring of compressed save states for rewinding.
+///
+/// Each snapshot is stored as the XOR delta against the snapshot before it,
+/// compressed as runs of zero and literal bytes. Every few snapshots a full
+/// keyframe is stored instead, which bounds the cost of rebuilding a state
+/// and lets the oldest history be dropped when the ring is full.
+class RewindBuffer {
+
+private:
+    /// A compressed snapshot in the ring
+    struct Snapshot {
+        /// the offset of the compressed bytes in the arena
+        std::size_t offset;
+        /// the number of compressed bytes
+        std::size_t size;
+        /// whether the snapshot is a full state rather than a delta
+        bool is_keyframe;
+    };
+
+    /// the size of an uncompressed state in bytes
+    std::size_t state_size;
+    /// the number of snapshots between keyframes
+    int keyframe_interval;
+    /// the number of snapshots pushed since the last keyframe
+    int since_keyframe;
+    /// the compressed snapshots, used as a ring
+    std::vector<std::uint8_t> arena;
+    /// the offset in the arena for the next snapshot
+    std::size_t arena_head;
+    /// the snapshots in the arena, used as a ring
+    std::vector<Snapshot> snapshots;
+    /// the index of the oldest snapshot
+    std::size_t first;
+    /// the number of snapshots in the ring
+    std::size_t count;
+    /// the uncompressed newest state
+    std::vector<std::uint8_t> current;
+    /// the state being captured or popped
+    std::vector<std::uint8_t> staging;
+    /// the output of the compressor before it is copied into the arena
+    std::vector<std::uint8_t> scratch;
+
+    /// Return the snapshot at a position from the oldest.
+    inline Snapshot& at(std::size_t index) { return snapshots[(first + index) % snapshots.size()]; };
+
+    /// Drop the oldest snapshot and any deltas that depended on it.
+    void drop_oldest();
+
+    /// Make room in the arena for a number of bytes, dropping old snapshots.
+    ///
+    /// @param size the number of bytes to make room for
+    /// @return the offset of the free space, or the arena size if it can never fit
+    ///
+    std::size_t allocate(std::size_t size);
+
+public:
+    /// Initialize a new rewind buffer.
+    ///
+    /// As a guide to the capacity, a snapshot every frame of a game that
+    /// rewrites its RAM every frame compresses to 800-850 bytes, so a minute
+    /// of history needs about 3 MB. A capture costs 5-10 us.
+    ///
+    /// @param state_size the size of an uncompressed state in bytes
+    /// @param capacity the number of bytes of compressed history to keep
+    /// @param keyframe_interval the number of snapshots between keyframes
+    ///
+    RewindBuffer(std::size_t state_size, std::size_t capacity, int keyframe_interval = 60);
+
+    /// Return the buffer the next snapshot should be written into.
+    inline std::uint8_t* get_capture_buffer() { return staging.data(); };
+
+    /// Compress the state in the capture buffer into the ring.
+    void push();
+
+    /// Remove the newest snapshot.
+    ///
+    /// @return a pointer to the uncompressed state, valid until the next push
+    ///         or pop, or nullptr if the ring is empty
+    ///
+    const std::uint8_t* pop();
+
+    /// Return the number of snapshots in the ring.
+    inline std::size_t size() { return count; };
+
+    /// Return true if there are no snapshots in the ring.
+    inline bool empty() { return count == 0; };
+
+    /// Return the number of bytes of compressed history the buffer keeps.
+    inline std::size_t capacity() { return arena.size(); };
+
+    /// Return the number of compressed bytes used by the snapshots.
+    std::size_t bytes_used();
+
+    /// Return the total memory held by the buffer in bytes.
+    inline std::size_t memory_usage() {
+        return arena.size() + snapshots.size() * sizeof(Snapshot) + current.size() + staging.size() + scratch.size();
+    };
+
+};
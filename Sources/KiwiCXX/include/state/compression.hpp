@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Return the largest number of bytes compress can produce for an input.
+///
+/// @param size the size of the input in bytes
+/// @return the worst case size of the compressed output in bytes
+///
+inline std::size_t compress_bound(std::size_t size) { return size + size / 2 + 16; };
+
+/// Compress a buffer as runs of zero bytes and runs of literal bytes.
+///
+/// When a reference buffer is given the input is XORed against it first, so
+/// unchanged bytes become zero runs and only the differences are stored.
+///
+/// @param data the buffer to compress
+/// @param reference the buffer to XOR against, or nullptr for none
+/// @param size the size of both buffers in bytes
+/// @param output the buffer to write into, at least compress_bound(size)
+/// @return the number of bytes written to the output
+///
+std::size_t compress(const std::uint8_t* data, const std::uint8_t* reference, std::size_t size, std::uint8_t* output);
+
+/// Decompress a buffer created by compress.
+///
+/// @param input the compressed buffer
+/// @param input_size the size of the compressed buffer in bytes
+/// @param output the buffer to decompress into
+/// @param size the size of the output buffer in bytes
+/// @param is_delta true to XOR into the output (undoing a reference), false
+///        to overwrite it
+/// @return true if the input was well formed and exactly filled the output
+///
+bool decompress(const std::uint8_t* input, std::size_t input_size, std::uint8_t* output, std::size_t size, bool is_delta);
+
+/// Return the size a buffer created by compress decompresses to.
+///
+/// A few bytes of input can describe a zero run of any length, so check
+/// this before allocating the output for input that isn't trusted.
+///
+/// @param input the compressed buffer
+/// @param input_size the size of the compressed buffer in bytes
+/// @return the size of the decompressed buffer in bytes, or SIZE_MAX if the
+///         input is malformed
+///
+std::size_t decompressed_size(const std::uint8_t* input, std::size_t input_size);
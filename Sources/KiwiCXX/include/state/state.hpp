@@ -0,0 +1,232 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// The magic number at the start of every save state ("KIWI")
+const std::uint32_t STATE_MAGIC = 0x4957494b;
+/// The version of the save state layout, bump when the layout changes
+const std::uint16_t STATE_VERSION = 5;
+
+/// The size of a page of RAM tracked for incremental snapshots in bytes
+const std::size_t STATE_PAGE_SIZE = 0x100;
+
+/// Mark the page of a RAM region holding an offset as written.
+///
+/// Each region keeps one bit per page, so regions are at most 16 KB.
+///
+/// @param dirty the bitmap of written pages for the region
+/// @param offset the offset of the written byte in the region
+///
+inline void mark_dirty(std::uint64_t& dirty, std::size_t offset) { dirty |= 1ull << (offset / STATE_PAGE_SIZE); };
+
+/// Copy the written pages of a RAM region, one copy per run of pages.
+///
+/// @param destination the region to copy into
+/// @param source the region to copy from
+/// @param size the size of the region in bytes
+/// @param dirty the bitmap of written pages for the region
+///
+inline void copy_pages(std::uint8_t* destination, const std::uint8_t* source, std::size_t size, std::uint64_t dirty) {
+    while (dirty) {
+        int start = std::countr_zero(dirty);
+        int length = std::countr_one(dirty >> start);
+        std::size_t offset = start * STATE_PAGE_SIZE;
+        if (offset >= size)
+            break;
+        std::memcpy(destination + offset, source + offset, std::min(length * STATE_PAGE_SIZE, size - offset));
+        dirty = length + start >= 64 ? 0 : dirty & (~0ull << (start + length));
+    }
+};
+
+/// Return a fast 64-bit hash of a save state, for comparing states between
+/// machines without sending them.
+///
+/// @param data a pointer to the save state
+/// @param size the size of the save state in bytes
+/// @return the hash of the save state
+///
+inline std::uint64_t hash_state(const std::uint8_t* data, std::size_t size) {
+    std::uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+    std::size_t position = 0;
+    // mix a word at a time, then the bytes that are left over
+    for (; position + 8 <= size; position += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, data + position, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    for (; position < size; position++)
+        hash = (hash ^ data[position]) * 0x100000001b3ull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 33);
+};
+
+/// The header at the start of every save state
+struct StateHeader {
+    /// the magic number identifying the blob as a save state
+    std::uint32_t magic;
+    /// the version of the layout of the blob
+    std::uint16_t version;
+    /// the mapper ID number of the cartridge the state belongs to
+    std::uint16_t mapper;
+    /// the total size of the blob in bytes, including this header
+    std::uint32_t size;
+};
+
+/// A writer that serializes state into a caller provided buffer.
+///
+/// A writer with a null buffer only measures the size of the state. An
+/// incremental writer expects the buffer to already hold the last snapshot
+/// and only copies the RAM pages written since then.
+class StateWriter {
+
+private:
+    /// the buffer to write into
+    std::uint8_t* buffer;
+    /// the size of the buffer in bytes
+    std::size_t capacity;
+    /// the number of bytes written so far
+    std::size_t position;
+    /// whether only written RAM pages are copied
+    bool is_incremental;
+
+public:
+    /// Initialize a new state writer.
+    ///
+    /// @param buffer the buffer to write into, or nullptr to measure
+    /// @param capacity the size of the buffer in bytes
+    /// @param is_incremental true to only copy the RAM pages written since
+    ///        the last incremental snapshot into this buffer
+    ///
+    StateWriter(std::uint8_t* buffer, std::size_t capacity, bool is_incremental = false) :
+        buffer(buffer), capacity(capacity), position(0), is_incremental(is_incremental) { };
+
+    /// Write raw bytes to the state.
+    ///
+    /// @param data a pointer to the bytes to write
+    /// @param size the number of bytes to write
+    ///
+    inline void write_bytes(const void* data, std::size_t size) {
+        if (buffer != nullptr && position + size <= capacity)
+            std::memcpy(buffer + position, data, size);
+        position += size;
+    };
+
+    /// Write a trivially copyable value to the state.
+    ///
+    /// @param value the value to write
+    ///
+    template<typename T>
+    inline void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be trivially copyable");
+        write_bytes(&value, sizeof(T));
+    };
+
+    /// Write a region of RAM to the state.
+    ///
+    /// An incremental writer only copies the written pages and clears them.
+    ///
+    /// @param data a pointer to the RAM region
+    /// @param size the size of the RAM region in bytes
+    /// @param dirty the bitmap of written pages for the region
+    ///
+    inline void write_pages(const std::uint8_t* data, std::size_t size, std::uint64_t& dirty) {
+        if (!is_incremental || buffer == nullptr || position + size > capacity) {
+            write_bytes(data, size);
+            return;
+        }
+        copy_pages(buffer + position, data, size, dirty);
+        dirty = 0;
+        position += size;
+    };
+
+    /// Return the number of bytes written (or measured) so far.
+    inline std::size_t size() { return position; };
+
+    /// Return true if every write so far fit in the buffer.
+    inline bool is_valid() { return buffer != nullptr && position <= capacity; };
+
+};
+
+/// A reader that deserializes state from a buffer.
+///
+/// An incremental reader expects the buffer to hold the last incremental
+/// snapshot and only copies back the RAM pages written since it was taken.
+class StateReader {
+
+private:
+    /// the buffer to read from
+    const std::uint8_t* buffer;
+    /// the size of the buffer in bytes
+    std::size_t capacity;
+    /// the number of bytes read so far
+    std::size_t position;
+    /// whether only written RAM pages are copied
+    bool is_incremental;
+
+public:
+    /// Initialize a new state reader.
+    ///
+    /// @param buffer the buffer to read from
+    /// @param capacity the size of the buffer in bytes
+    /// @param is_incremental true if the buffer holds the last incremental
+    ///        snapshot, so only the RAM pages written since need restoring
+    ///
+    StateReader(const std::uint8_t* buffer, std::size_t capacity, bool is_incremental = false) :
+        buffer(buffer), capacity(capacity), position(0), is_incremental(is_incremental) { };
+
+    /// Read raw bytes from the state.
+    ///
+    /// @param data a pointer to the bytes to read into
+    /// @param size the number of bytes to read
+    ///
+    inline void read_bytes(void* data, std::size_t size) {
+        if (position + size <= capacity)
+            std::memcpy(data, buffer + position, size);
+        position += size;
+    };
+
+    /// Read a trivially copyable value from the state.
+    ///
+    /// @param value the value to read into
+    ///
+    template<typename T>
+    inline void read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "state values must be trivially copyable");
+        read_bytes(&value, sizeof(T));
+    };
+
+    /// Read a region of RAM from the state.
+    ///
+    /// An incremental reader only copies back the written pages, after which
+    /// the region matches the snapshot again. A full read leaves every page
+    /// marked as written since the incremental snapshot no longer matches.
+    ///
+    /// @param data a pointer to the RAM region
+    /// @param size the size of the RAM region in bytes
+    /// @param dirty the bitmap of written pages for the region
+    ///
+    inline void read_pages(std::uint8_t* data, std::size_t size, std::uint64_t& dirty) {
+        if (!is_incremental || position + size > capacity) {
+            read_bytes(data, size);
+            dirty = ~0ull;
+            return;
+        }
+        copy_pages(data, buffer + position, size, dirty);
+        dirty = 0;
+        position += size;
+    };
+
+    /// Return the number of bytes read so far.
+    inline std::size_t size() { return position; };
+
+    /// Return true if every read so far was inside the buffer.
+    inline bool is_valid() { return position <= capacity; };
+
+};
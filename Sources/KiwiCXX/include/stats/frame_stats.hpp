@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/// The regions of the CPU address space the bus counters are split into
+enum BusRegion {
+    /// the internal RAM, $0000-$1FFF
+    RAM_REGION,
+    /// the PPU registers, $2000-$3FFF
+    PPU_REGION,
+    /// the APU and IO registers and the expansion area, $4000-$5FFF
+    IO_REGION,
+    /// the PRG RAM of the cartridge, $6000-$7FFF
+    PRG_RAM_REGION,
+    /// the PRG ROM of the cartridge, $8000-$FFFF
+    PRG_ROM_REGION,
+    BUS_REGION_COUNT
+};
+
+/// Return the region of an 8KB page of the CPU address space.
+inline BusRegion get_bus_region(int page) {
+    return static_cast<BusRegion>(std::min(page, static_cast<int>(PRG_ROM_REGION)));
+}
+
+/// The counters of a step of the emulator.
+///
+/// The counters cover every frame the step ran on this instance, including
+/// the frames run ahead on it.
+struct FrameStats {
+    /// the instructions the CPU executed
+    std::uint64_t cpu_instructions;
+    /// the cycles the CPU ran
+    std::uint64_t cpu_cycles;
+    /// the dots the PPU ran
+    std::uint64_t ppu_dots;
+    /// the visible scanlines the PPU drew into the screen buffer
+    std::uint64_t ppu_scanlines;
+    /// the CPU reads of each region of the bus
+    std::uint64_t bus_reads[BUS_REGION_COUNT];
+    /// the CPU writes of each region of the bus
+    std::uint64_t bus_writes[BUS_REGION_COUNT];
+    /// the time spent in the step in nanoseconds
+    std::int64_t step_time;
+    /// the time spent scaling the screen since the step before in nanoseconds
+    std::int64_t scale_time;
+};
+
+/// The statistics of an emulator.
+struct EmulatorStats {
+    /// The number of buckets in the frame time histogram
+    static constexpr int FRAME_TIME_BUCKETS = 32;
+
+    /// the number of steps run
+    std::uint64_t frames;
+    /// the counters of the last step
+    FrameStats last_frame;
+    /// the number of steps by time: bucket 0 holds steps under 1us and
+    /// bucket n steps of 2^(n - 1) to 2^n us, the last bucket everything above
+    std::uint64_t frame_times[FRAME_TIME_BUCKETS];
+
+    /// Return the bucket of the frame time histogram a step falls in.
+    ///
+    /// @param step_time the time of the step in nanoseconds
+    ///
+    static inline int get_frame_time_bucket(std::int64_t step_time) {
+        std::uint64_t micros = std::max<std::int64_t>(0, step_time) / 1000;
+        return std::min<int>(std::bit_width(micros), FRAME_TIME_BUCKETS - 1);
+    };
+};
+
+/// The statistics of an emulator, published by the emulation thread and
+/// read from any other thread without locks.
+///
+/// This is a sequence lock: the writer makes the sequence odd while it
+/// copies the statistics in and even again once done, and a reader retries
+/// a copy that a write overlapped. The writer never waits, and a reader
+/// only retries while a copy of a few hundred bytes is in flight.
+class SharedStats {
+
+private:
+    static_assert(std::is_trivially_copyable_v<EmulatorStats> && sizeof(EmulatorStats) % sizeof(std::uint64_t) == 0);
+
+    /// The number of words the statistics are copied as
+    static constexpr std::size_t WORDS = sizeof(EmulatorStats) / sizeof(std::uint64_t);
+
+    /// the count of writes started and finished, odd while one is in flight
+    std::atomic<std::uint64_t> sequence;
+    /// the published statistics, word by word
+    std::atomic<std::uint64_t> words[WORDS];
+
+public:
+    /// Initialize new statistics with every counter zero.
+    SharedStats() : sequence(0) {
+        for (auto& word : words)
+            word.store(0, std::memory_order_relaxed);
+    };
+
+    /// Publish the statistics, from the emulation thread only.
+    ///
+    /// @param stats the statistics to publish
+    ///
+    inline void publish(const EmulatorStats& stats) {
+        std::uint64_t copy[WORDS];
+        std::memcpy(copy, &stats, sizeof(stats));
+        std::uint64_t start = sequence.load(std::memory_order_relaxed);
+        sequence.store(start + 1, std::memory_order_relaxed);
+        // the odd sequence is visible before any of the words
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WORDS; i++)
+            words[i].store(copy[i], std::memory_order_relaxed);
+        sequence.store(start + 2, std::memory_order_release);
+    };
+
+    /// Return a consistent copy of the last statistics published.
+    inline EmulatorStats read() const {
+        std::uint64_t copy[WORDS];
+        while (true) {
+            std::uint64_t start = sequence.load(std::memory_order_acquire);
+            if (start & 1)
+                continue;
+            for (std::size_t i = 0; i < WORDS; i++)
+                copy[i] = words[i].load(std::memory_order_relaxed);
+            // the words are read before the sequence is checked again
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == start)
+                break;
+        }
+        EmulatorStats stats;
+        std::memcpy(&stats, copy, sizeof(stats));
+        return stats;
+    };
+
+};
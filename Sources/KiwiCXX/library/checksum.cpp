@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <cstring>
+
+#include "library/checksum.hpp"
+
+/// Return the CRC-32 tables, the first for a byte at a time and each next
+/// one for a byte one position further from the end of an 8 byte word.
+static const std::uint32_t (&get_crc_tables())[8][256] {
+    static std::uint32_t tables[8][256];
+    static bool is_built = [&]() {
+        for (std::uint32_t i = 0; i < 256; i++) {
+            std::uint32_t crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc >> 1) ^ (0xEDB88320u & -(crc & 1));
+            tables[0][i] = crc;
+        }
+        for (int slice = 1; slice < 8; slice++) {
+            for (int i = 0; i < 256; i++)
+                tables[slice][i] = (tables[slice - 1][i] >> 8) ^ tables[0][tables[slice - 1][i] & 0xff];
+        }
+        return true;
+    }();
+    (void) is_built;
+    return tables;
+}
+
+std::uint32_t crc32(const std::uint8_t* data, std::size_t size, std::uint32_t crc) {
+    const auto& tables = get_crc_tables();
+    crc = ~crc;
+    // fold in 8 bytes at a time, read as two little endian words
+    for (; size >= 8; data += 8, size -= 8) {
+        std::uint32_t low, high;
+        std::memcpy(&low, data, 4);
+        std::memcpy(&high, data + 4, 4);
+        low ^= crc;
+        crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^ tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24] ^
+            tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff] ^ tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+    }
+    for (; size; data++, size--)
+        crc = tables[0][(crc ^ *data) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/// Rotate a word left.
+static inline std::uint32_t rotate(std::uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+/// Run a SHA-1 round, the group of 20 rounds picking the function and constant.
+template<int GROUP>
+static inline void sha1_round(std::uint32_t a, std::uint32_t& b, std::uint32_t c, std::uint32_t d, std::uint32_t& e, std::uint32_t word) {
+    if constexpr (GROUP == 0)
+        e += (d ^ (b & (c ^ d))) + 0x5A827999;
+    else if constexpr (GROUP == 1 || GROUP == 3)
+        e += (b ^ c ^ d) + (GROUP == 1 ? 0x6ED9EBA1 : 0xCA62C1D6);
+    else
+        e += ((b & c) | (d & (b | c))) + 0x8F1BBCDC;
+    e += rotate(a, 5) + word;
+    b = rotate(b, 30);
+}
+
+Sha1::Sha1() : state{ 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 }, length(0) { }
+
+void Sha1::compress(const std::uint8_t* data) {
+    std::uint32_t words[80];
+    for (int i = 0; i < 16; i++)
+        words[i] = data[i * 4] << 24 | data[i * 4 + 1] << 16 | data[i * 4 + 2] << 8 | data[i * 4 + 3];
+    for (int i = 16; i < 80; i++)
+        words[i] = rotate(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+    std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    // five rounds at a time rotate the roles of the variables instead of
+    // moving their values
+    for (int i = 0; i < 20; i += 5) {
+        sha1_round<0>(a, b, c, d, e, words[i]);
+        sha1_round<0>(e, a, b, c, d, words[i + 1]);
+        sha1_round<0>(d, e, a, b, c, words[i + 2]);
+        sha1_round<0>(c, d, e, a, b, words[i + 3]);
+        sha1_round<0>(b, c, d, e, a, words[i + 4]);
+    }
+    for (int i = 20; i < 40; i += 5) {
+        sha1_round<1>(a, b, c, d, e, words[i]);
+        sha1_round<1>(e, a, b, c, d, words[i + 1]);
+        sha1_round<1>(d, e, a, b, c, words[i + 2]);
+        sha1_round<1>(c, d, e, a, b, words[i + 3]);
+        sha1_round<1>(b, c, d, e, a, words[i + 4]);
+    }
+    for (int i = 40; i < 60; i += 5) {
+        sha1_round<2>(a, b, c, d, e, words[i]);
+        sha1_round<2>(e, a, b, c, d, words[i + 1]);
+        sha1_round<2>(d, e, a, b, c, words[i + 2]);
+        sha1_round<2>(c, d, e, a, b, words[i + 3]);
+        sha1_round<2>(b, c, d, e, a, words[i + 4]);
+    }
+    for (int i = 60; i < 80; i += 5) {
+        sha1_round<3>(a, b, c, d, e, words[i]);
+        sha1_round<3>(e, a, b, c, d, words[i + 1]);
+        sha1_round<3>(d, e, a, b, c, words[i + 2]);
+        sha1_round<3>(c, d, e, a, b, words[i + 3]);
+        sha1_round<3>(b, c, d, e, a, words[i + 4]);
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+void Sha1::update(const std::uint8_t* data, std::size_t size) {
+    std::size_t used = length % 64;
+    length += size;
+    // top up a partial block first
+    if (used) {
+        std::size_t count = std::min<std::size_t>(64 - used, size);
+        std::memcpy(block + used, data, count);
+        data += count;
+        size -= count;
+        if (used + count < 64)
+            return;
+        compress(block);
+    }
+    // then compress straight from the input
+    for (; size >= 64; data += 64, size -= 64)
+        compress(data);
+    std::memcpy(block, data, size);
+}
+
+void Sha1::finish(std::uint8_t* digest) {
+    std::uint64_t bits = length * 8;
+    std::uint8_t padding[72] = { 0x80 };
+    std::size_t used = length % 64;
+    std::size_t count = (used < 56 ? 56 : 120) - used;
+    for (int i = 0; i < 8; i++)
+        padding[count + i] = bits >> (56 - i * 8);
+    update(padding, count + 8);
+    for (int i = 0; i < 5; i++) {
+        digest[i * 4] = state[i] >> 24;
+        digest[i * 4 + 1] = state[i] >> 16;
+        digest[i * 4 + 2] = state[i] >> 8;
+        digest[i * 4 + 3] = state[i];
+    }
+}
@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "cartridge/rom_image.hpp"
+#include "farm/worker_pool.hpp"
+#include "library/library.hpp"
+#include "mappers/mapper.hpp"
+
+/// The header at the start of every library index
+struct LibraryHeader {
+    /// the magic number identifying the file as a library index
+    std::uint32_t magic;
+    /// the version of the layout of the file
+    std::uint16_t version;
+    /// the size of an entry in bytes
+    std::uint16_t entry_size;
+    /// the number of entries following the header
+    std::uint64_t entry_count;
+    /// the number of bytes of paths following the entries
+    std::uint64_t paths_size;
+};
+
+/// The number of bytes hashed at a time, small enough to stay in cache for
+/// the second checksum
+static const std::size_t HASH_CHUNK = 0x10000;
+
+// the index is mapped as is, so the entries must not hold any padding
+static_assert(std::has_unique_object_representations_v<LibraryEntry>, "library entries must not hold padding");
+static_assert(sizeof(LibraryHeader) % alignof(LibraryEntry) == 0, "library entries must be aligned in the index");
+
+RomLibrary::RomLibrary(std::string index_path) : index_path(index_path), mapping(nullptr), mapping_size(0) {
+    map();
+}
+
+RomLibrary::~RomLibrary() {
+    unmap();
+}
+
+void RomLibrary::map() {
+    int file = ::open(index_path.c_str(), O_RDONLY);
+    if (file < 0)
+        return;
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(LibraryHeader))
+        data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (data == MAP_FAILED)
+        return;
+    mapping = static_cast<const std::uint8_t*>(data);
+    mapping_size = info.st_size;
+    // anything but an index of this version with every byte present is ignored
+    const LibraryHeader* header = reinterpret_cast<const LibraryHeader*>(mapping);
+    std::size_t entries_size = header->entry_count * sizeof(LibraryEntry);
+    if (header->magic != LIBRARY_MAGIC || header->version != LIBRARY_VERSION || header->entry_size != sizeof(LibraryEntry) ||
+        header->entry_count > mapping_size / sizeof(LibraryEntry) || sizeof(LibraryHeader) + entries_size + header->paths_size != mapping_size) {
+        unmap();
+        return;
+    }
+    entries = { reinterpret_cast<const LibraryEntry*>(mapping + sizeof(LibraryHeader)), header->entry_count };
+    paths = { reinterpret_cast<const char*>(mapping + sizeof(LibraryHeader) + entries_size), header->paths_size };
+    for (const LibraryEntry& entry : entries) {
+        if (static_cast<std::uint64_t>(entry.path_offset) + entry.path_length > paths.size()) {
+            unmap();
+            return;
+        }
+    }
+}
+
+void RomLibrary::unmap() {
+    if (mapping)
+        munmap(const_cast<std::uint8_t*>(mapping), mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    entries = {};
+    paths = {};
+}
+
+void RomLibrary::scan_file(const std::string& path, LibraryEntry& entry) {
+    std::shared_ptr<RomImage> image = RomImage::open(path);
+    if (!image) {
+        entry.error = ROM_UNREADABLE;
+        return;
+    }
+    std::span<const std::uint8_t> data = image->get_data();
+    RomHeader header;
+    RomError error = RomHeader::parse(data, header);
+    if ((error == ROM_OK || error == ROM_TRUNCATED) && !Mapper::isSupported(header.mapper))
+        error = ROM_UNSUPPORTED_MAPPER;
+    entry.error = error;
+    if (error == ROM_NO_HEADER || error == ROM_BAD_MAGIC)
+        return;
+    entry.prg_rom_size = header.prg_rom_size;
+    entry.chr_rom_size = header.chr_rom_size;
+    entry.prg_ram_size = header.prg_ram_size;
+    entry.prg_nvram_size = header.prg_nvram_size;
+    entry.chr_ram_size = header.chr_ram_size;
+    entry.chr_nvram_size = header.chr_nvram_size;
+    entry.mapper = header.mapper;
+    entry.submapper = header.submapper;
+    entry.is_nes20 = header.is_nes20;
+    entry.has_battery = header.has_battery;
+    entry.has_trainer = header.has_trainer;
+    entry.console_type = header.console_type;
+    // hash the ROM without the header, as ROM databases do, up to the end of
+    // a truncated file
+    std::size_t start = std::min(header.get_prg_offset(), data.size());
+    std::size_t end = std::min<std::uint64_t>(header.get_chr_offset() + header.chr_rom_size, data.size());
+    Sha1 sha1;
+    std::uint32_t crc = 0;
+    // both checksums read a chunk while it's still in cache
+    for (std::size_t position = start; position < end; position += HASH_CHUNK) {
+        std::size_t size = std::min(HASH_CHUNK, end - position);
+        crc = crc32(data.data() + position, size, crc);
+        sha1.update(data.data() + position, size);
+    }
+    entry.crc = crc;
+    sha1.finish(entry.sha1);
+}
+
+RomLibrary::RefreshStats RomLibrary::refresh(const std::vector<std::string>& directories, std::size_t threads) {
+    namespace fs = std::filesystem;
+    // walk the directories, which only reads them and doesn't stat the files
+    std::vector<std::string> found;
+    for (const std::string& directory : directories) {
+        std::error_code error;
+        fs::recursive_directory_iterator iterator(directory, fs::directory_options::skip_permission_denied, error);
+        for (; !error && iterator != fs::recursive_directory_iterator(); iterator.increment(error)) {
+            if (!iterator->is_regular_file(error))
+                continue;
+            std::string extension = iterator->path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (extension == ".nes")
+                found.push_back(iterator->path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    // the entries of the current index by path
+    std::unordered_map<std::string_view, const LibraryEntry*> previous;
+    for (std::size_t i = 0; i < entries.size(); i++)
+        previous.emplace(get_path(i), &entries[i]);
+    // stat every file and rescan the new and changed ones in parallel
+    std::vector<LibraryEntry> scanned(found.size());
+    std::vector<std::uint8_t> is_hashed(found.size(), 0);
+    WorkerPool pool(threads ? threads : std::max(1u, std::thread::hardware_concurrency()));
+    pool.run(found.size(), [&](std::size_t i) {
+        LibraryEntry entry{};
+        std::error_code error;
+        entry.file_size = fs::file_size(found[i], error);
+        auto modified = fs::last_write_time(found[i], error);
+        entry.modified = error ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(modified.time_since_epoch()).count();
+        auto match = previous.find(found[i]);
+        if (match != previous.end() && match->second->file_size == entry.file_size && match->second->modified == entry.modified) {
+            scanned[i] = *match->second;
+            return;
+        }
+        scan_file(found[i], entry);
+        scanned[i] = entry;
+        is_hashed[i] = 1;
+    });
+    // lay out the paths behind the entries
+    std::string path_table;
+    for (std::size_t i = 0; i < found.size(); i++) {
+        scanned[i].path_offset = static_cast<std::uint32_t>(path_table.size());
+        scanned[i].path_length = static_cast<std::uint32_t>(found[i].size());
+        path_table += found[i];
+    }
+    RefreshStats stats{ found.size(), static_cast<std::size_t>(std::count(is_hashed.begin(), is_hashed.end(), 1)), false };
+    // write a new index beside the old one and swap it in, so a reader
+    // never maps a partial index
+    std::string temporary_path = index_path + ".tmp";
+    {
+        std::ofstream file(temporary_path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+        LibraryHeader header{ LIBRARY_MAGIC, LIBRARY_VERSION, sizeof(LibraryEntry), scanned.size(), path_table.size() };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(scanned.data()), scanned.size() * sizeof(LibraryEntry));
+        file.write(path_table.data(), path_table.size());
+        stats.is_saved = static_cast<bool>(file);
+    }
+    unmap();
+    std::error_code error;
+    if (stats.is_saved)
+        fs::rename(temporary_path, index_path, error);
+    else
+        fs::remove(temporary_path, error);
+    stats.is_saved = stats.is_saved && !error;
+    map();
+    return stats;
+}
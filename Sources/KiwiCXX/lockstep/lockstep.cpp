@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include "cpu/instruction_set.hpp"
+#include "lockstep/lockstep.hpp"
+
+LockstepEngine::LockstepEngine(const std::vector<Emulator*>& emulators) :
+    lane_count(std::min<int>(static_cast<int>(emulators.size()), MAX_LANES)) {
+    std::copy(emulators.begin(), emulators.begin() + lane_count, lanes);
+    // the cartridges of one ROM share one image
+    for (int lane = 1; lane < lane_count; lane++) {
+        if (lanes[lane]->cartridge.getImage() != lanes[0]->cartridge.getImage())
+            lane_count = 0;
+    }
+}
+
+void LockstepEngine::interrupt(int lane, CPU::InterruptType type) {
+    LaneRegisters registers = get_registers(lane);
+    InstructionSet<LaneRegisters>::interrupt(registers, bus(lane), type);
+}
+
+void LockstepEngine::cycle() {
+    for (int lane = 0; lane < lane_count; lane++) {
+        ++cycles[lane];
+        if (skip_cycles[lane]-- > 1)
+            continue;
+        skip_cycles[lane] = 0;
+        std::uint8_t op = bus(lane).read(register_PC[lane]++);
+        LaneRegisters registers = get_registers(lane);
+        if (!InstructionSet<LaneRegisters>::execute(registers, bus(lane), op))
+            continue;
+        skip_cycles[lane] += OPERATION_CYCLES[op];
+        // the DMA starts on the cycle after the instruction's last
+        if (is_DMA_pending[lane]) {
+            skip_cycles[lane] += CPU::DMA_cycles(cycles[lane] - 1 + skip_cycles[lane]);
+            is_DMA_pending[lane] = false;
+        }
+    }
+}
+
+void LockstepEngine::step() {
+    // move the CPU registers of every lane into the lane arrays
+    for (int lane = 0; lane < lane_count; lane++) {
+        CPU& cpu = lanes[lane]->cpu;
+        register_PC[lane] = cpu.register_PC;
+        register_SP[lane] = cpu.register_SP;
+        register_A[lane] = cpu.register_A;
+        register_X[lane] = cpu.register_X;
+        register_Y[lane] = cpu.register_Y;
+        flags[lane] = cpu.flags;
+        skip_cycles[lane] = cpu.skip_cycles;
+        cycles[lane] = cpu.cycles;
+        is_DMA_pending[lane] = false;
+        // interrupts and DMA reach the lane arrays while the engine runs
+        lanes[lane]->lockstep = this;
+        lanes[lane]->lockstep_lane = lane;
+        lanes[lane]->ppu.set_render_suppressed(lanes[lane]->is_headless);
+        lanes[lane]->apu.set_output_suppressed(lanes[lane]->is_headless);
+    }
+    for (int i = 0; i < Emulator::CYCLES_PER_FRAME; i++) {
+        // 3 PPU steps per CPU step on every lane
+        for (int lane = 0; lane < lane_count; lane++) {
+            Emulator& emulator = *lanes[lane];
+            emulator.ppu.cycle(emulator.picture_bus);
+            emulator.ppu.cycle(emulator.picture_bus);
+            emulator.ppu.cycle(emulator.picture_bus);
+        }
+        cycle();
+        for (int lane = 0; lane < lane_count; lane++) {
+            Emulator& emulator = *lanes[lane];
+            emulator.apu.cycle(emulator.bus);
+            if (emulator.apu.is_interrupting() && !flags[lane].bits.I)
+                interrupt(lane, CPU::IRQ_INTERRUPT);
+        }
+    }
+    // move the registers back so every emulator works on its own again
+    for (int lane = 0; lane < lane_count; lane++) {
+        CPU& cpu = lanes[lane]->cpu;
+        cpu.register_PC = register_PC[lane];
+        cpu.register_SP = register_SP[lane];
+        cpu.register_A = register_A[lane];
+        cpu.register_X = register_X[lane];
+        cpu.register_Y = register_Y[lane];
+        cpu.flags = flags[lane];
+        cpu.skip_cycles = skip_cycles[lane];
+        cpu.cycles = cycles[lane];
+        lanes[lane]->apu.end_frame();
+        lanes[lane]->lockstep = nullptr;
+    }
+}
@@ -2,24 +2,26 @@
 
 MapperCNROM::MapperCNROM(Cartridge& cart) : Mapper(cart), select_chr(0) {
     is_one_bank = cart.getROM().size() == 0x4000;
+    mapCHR(0, 8, cart.getVROM().data());
+    // a single bank is mirrored at $C000
+    mapPRG(0, 2, cart.getROM().data());
+    mapPRG(2, 2, cart.getROM().data() + (is_one_bank ? 0 : 0x4000));
 };
 
-std::uint8_t MapperCNROM::readPRG(std::uint16_t address) {
-    if (!is_one_bank)
-        return cartridge.getROM()[address - 0x8000];
-    // mirrored
-    else
-        return cartridge.getROM()[(address - 0x8000) & 0x3fff];
+void MapperCNROM::writePRG(std::uint16_t address, std::uint8_t value) {
+    select_chr = value & 0x3;
+    mapCHR(0, 8, getBank(cartridge.getVROM(), select_chr, 0x2000));
 }
 
-const std::uint8_t* MapperCNROM::getPagePtr(std::uint16_t address) {
-    if (!is_one_bank)
-        return &cartridge.getROM()[address - 0x8000];
-    // mirrored
-    else
-        return &cartridge.getROM()[(address - 0x8000) & 0x3fff];
+void MapperCNROM::writeCHR(std::uint16_t address, std::uint8_t value) {
+
 }
 
-void MapperCNROM::writeCHR(std::uint16_t address, std::uint8_t value) {
+void MapperCNROM::save(StateWriter& state) {
+    state.write(select_chr);
+}
 
+void MapperCNROM::load(StateReader& state) {
+    state.read(select_chr);
+    mapCHR(0, 8, getBank(cartridge.getVROM(), select_chr, 0x2000));
 }
\ No newline at end of file
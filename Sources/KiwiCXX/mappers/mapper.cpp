@@ -1,23 +1,91 @@
+#include <algorithm>
+#include <iterator>
+
 #include "mappers/mapper.hpp"
+#include "mappers/axrom/mapper_axrom.hpp"
 #include "mappers/cnrom/mapper_cnrom.hpp"
+#include "mappers/colordreams/mapper_colordreams.hpp"
+#include "mappers/fxrom/mapper_fxrom.hpp"
+#include "mappers/gxrom/mapper_gxrom.hpp"
 #include "mappers/nrom/mapper_nrom.hpp"
+#include "mappers/pxrom/mapper_pxrom.hpp"
 #include "mappers/sxrom/mapper_sxrom.hpp"
 #include "mappers/txrom/mapper_txrom.hpp"
 #include "mappers/uxrom/mapper_uxrom.hpp"
+#include "mappers/vrc/mapper_vrc.hpp"
 
-Mapper* Mapper::create(Cartridge& game, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb) {
+std::unique_ptr<Mapper> Mapper::create(Cartridge& game, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb) {
     switch (static_cast<Mapper::Type>(game.getMapper())) {
     case NROM:
-        return new MapperNROM(game);
+        return std::make_unique<MapperNROM>(game);
     case SxROM:
-        return new MapperSxROM(game, mirroring_cb);
+        return std::make_unique<MapperSxROM>(game, mirroring_cb);
     case UxROM:
-        return new MapperUxROM(game);
+        return std::make_unique<MapperUxROM>(game);
     case CNROM:
-        return new MapperCNROM(game);
+        return std::make_unique<MapperCNROM>(game);
     case TxROM:
-        return new MapperTXROM(game, mirroring_cb, interrupt_cb);
+        return std::make_unique<MapperTXROM>(game, mirroring_cb, interrupt_cb);
+    case AxROM:
+        return std::make_unique<MapperAxROM>(game, mirroring_cb, interrupt_cb);
+    case PxROM:
+        return std::make_unique<MapperPxROM>(game, mirroring_cb, interrupt_cb);
+    case FxROM:
+        return std::make_unique<MapperFxROM>(game, mirroring_cb, interrupt_cb);
+    case ColorDreams:
+        return std::make_unique<MapperColorDreams>(game, mirroring_cb, interrupt_cb);
+    case VRC4ac:
+        return std::make_unique<MapperVRC4ac>(game, mirroring_cb, interrupt_cb);
+    case VRC2a:
+        return std::make_unique<MapperVRC2a>(game, mirroring_cb, interrupt_cb);
+    case VRC4ef:
+        return std::make_unique<MapperVRC4ef>(game, mirroring_cb, interrupt_cb);
+    case VRC4bd:
+        return std::make_unique<MapperVRC4bd>(game, mirroring_cb, interrupt_cb);
+    case GxROM:
+        return std::make_unique<MapperGxROM>(game, mirroring_cb, interrupt_cb);
     default:
         return nullptr;
     }
+}
+
+void Mapper::mapCHR(int page, int count, const std::uint8_t* data) {
+    for (int i = 0; i < count; i++) {
+        chr_pages[page + i] = data + 0x400 * i;
+        if (page_table)
+            page_table[page + i] = chr_pages[page + i];
+    }
+}
+
+void Mapper::mapPRG(int page, int count, const std::uint8_t* data) {
+    for (int i = 0; i < count; i++)
+        prg_pages[page + i] = data + 0x2000 * i;
+}
+
+void Mapper::setPageTable(const std::uint8_t** table) {
+    page_table = table;
+    if (page_table)
+        std::copy(std::begin(chr_pages), std::end(chr_pages), page_table);
+}
+
+bool Mapper::isSupported(std::uint16_t number) {
+    switch (number) {
+    case NROM:
+    case SxROM:
+    case UxROM:
+    case CNROM:
+    case TxROM:
+    case AxROM:
+    case PxROM:
+    case FxROM:
+    case ColorDreams:
+    case VRC4ac:
+    case VRC2a:
+    case VRC4ef:
+    case VRC4bd:
+    case GxROM:
+        return true;
+    default:
+        return false;
+    }
 }
\ No newline at end of file
@@ -9,39 +9,35 @@ MapperNROM::MapperNROM(Cartridge& cart) : Mapper(cart) {
     if (cart.getVROM().size() == 0) {
         has_character_ram = true;
         character_ram.resize(0x2000);
+        mapCHR(0, 8, character_ram.data());
     }
-    else
+    else {
         has_character_ram = false;
-}
+        mapCHR(0, 8, cart.getVROM().data());
+    }
 
-std::uint8_t MapperNROM::readPRG(std::uint16_t address) {
-    if (!is_one_bank)
-        return cartridge.getROM()[address - 0x8000];
-    else //mirrored
-        return cartridge.getROM()[(address - 0x8000) & 0x3fff];
+    // a single bank is mirrored at $C000
+    mapPRG(0, 2, cart.getROM().data());
+    mapPRG(2, 2, cart.getROM().data() + (is_one_bank ? 0 : 0x4000));
 }
 
 void MapperNROM::writePRG(std::uint16_t address, std::uint8_t value) {
 
 }
 
-std::uint8_t MapperNROM::readCHR(std::uint16_t address) {
-    if (has_character_ram)
-        return character_ram[address];
-    else
-        return cartridge.getVROM()[address];
-}
-
 void MapperNROM::writeCHR(std::uint16_t address, std::uint8_t value) {
-    if (has_character_ram)
+    if (has_character_ram) {
         character_ram[address] = value;
+        mark_dirty(dirty_character_ram, address);
+    }
     else
         return;
 }
 
-const std::uint8_t* MapperNROM::getPagePtr(std::uint16_t address) {
-    if (!is_one_bank)
-        return &cartridge.getROM()[address - 0x8000];
-    else //mirrored
-        return &cartridge.getROM()[(address - 0x8000) & 0x3fff];
+void MapperNROM::save(StateWriter& state) {
+    state.write_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
+}
+
+void MapperNROM::load(StateReader& state) {
+    state.read_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
 }
\ No newline at end of file
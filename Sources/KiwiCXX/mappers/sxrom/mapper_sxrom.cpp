@@ -24,16 +24,12 @@ MapperSxROM::MapperSxROM(Cartridge& cart, std::function<void(void)> mirroring_cb
         first_bank_chr = &cart.getVROM()[0];
         second_bank_chr = &cart.getVROM()[0x1000 * register_chr1];
     }
+    mapCHRPages();
 
     first_bank_prg = &cart.getROM()[0]; //first bank
     second_bank_prg = &cart.getROM()[cart.getROM().size() - 0x4000/*0x2000 * 0x0e*/]; //last bank
-}
-
-std::uint8_t MapperSxROM::readPRG(std::uint16_t address) {
-    if (address < 0xc000)
-        return *(first_bank_prg + (address & 0x3fff));
-    else
-        return *(second_bank_prg + (address & 0x3fff));
+    mapPRG(0, 2, first_bank_prg);
+    mapPRG(2, 2, second_bank_prg);
 }
 
 void MapperSxROM::writePRG(std::uint16_t address, std::uint8_t value) {
@@ -78,15 +74,12 @@ void MapperSxROM::writePRG(std::uint16_t address, std::uint8_t value) {
                     second_bank_chr = &cartridge.getVROM()[0x1000 * temp_register];
             }
             else {
-                // TODO: PRG-RAM
-                if ((temp_register & 0x10) == 0x10) {
-
-                }
-
-                temp_register &= 0xf;
+                // bit 4 disables the PRG RAM (MMC1B and later)
                 register_prg = temp_register;
+                is_prg_ram_enabled = !(register_prg & 0x10);
                 calculatePRGPointers();
             }
+            mapCHRPages();
 
             temp_register = 0;
             write_counter = 0;
@@ -101,40 +94,92 @@ void MapperSxROM::writePRG(std::uint16_t address, std::uint8_t value) {
 }
 
 void MapperSxROM::calculatePRGPointers() {
+    // the low 4 bits of the PRG register select the bank
+    std::uint8_t bank = register_prg & 0xf;
     if (mode_prg <= 1) { // 32KB changeable
         // equivalent to multiplying 0x8000 * (register_prg >> 1)
-        first_bank_prg = &cartridge.getROM()[0x4000 * (register_prg & ~1)];
+        first_bank_prg = &cartridge.getROM()[0x4000 * (bank & ~1)];
         second_bank_prg = first_bank_prg + 0x4000;   //add 16KB
     }
     else if (mode_prg == 2) { // fix first switch second
         first_bank_prg = &cartridge.getROM()[0];
-        second_bank_prg = first_bank_prg + 0x4000 * register_prg;
+        second_bank_prg = first_bank_prg + 0x4000 * bank;
     }
     else { // switch first fix second
-        first_bank_prg = &cartridge.getROM()[0x4000 * register_prg];
+        first_bank_prg = &cartridge.getROM()[0x4000 * bank];
         second_bank_prg = &cartridge.getROM()[cartridge.getROM().size() - 0x4000/*0x2000 * 0x0e*/];
     }
+    mapPRG(0, 2, first_bank_prg);
+    mapPRG(2, 2, second_bank_prg);
 }
 
-const std::uint8_t* MapperSxROM::getPagePtr(std::uint16_t address) {
-    if (address < 0xc000)
-        return (first_bank_prg + (address & 0x3fff));
-    else
-        return (second_bank_prg + (address & 0x3fff));
-}
-
-std::uint8_t MapperSxROM::readCHR(std::uint16_t address) {
-    if (has_character_ram)
-        return character_ram[address];
-    else if (address < 0x1000)
-        return *(first_bank_chr + address);
-    else
-        return *(second_bank_chr + (address & 0xfff));
+void MapperSxROM::mapCHRPages() {
+    if (has_character_ram) {
+        mapCHR(0, 8, character_ram.data());
+    }
+    else {
+        mapCHR(0, 4, first_bank_chr);
+        mapCHR(4, 4, second_bank_chr);
+    }
 }
 
 void MapperSxROM::writeCHR(std::uint16_t address, std::uint8_t value) {
-    if (has_character_ram)
+    if (has_character_ram) {
         character_ram[address] = value;
+        mark_dirty(dirty_character_ram, address);
+    }
     else
         return;
+}
+
+void MapperSxROM::save(StateWriter& state) {
+    state.write(mirroing);
+    state.write(mode_chr);
+    state.write(mode_prg);
+    state.write(temp_register);
+    state.write(write_counter);
+    state.write(register_prg);
+    state.write(register_chr0);
+    state.write(register_chr1);
+    // store the bank pointers as 16KB PRG and 4KB CHR bank numbers
+    const std::uint8_t* rom = cartridge.getROM().data();
+    state.write(static_cast<std::uint32_t>((first_bank_prg - rom) / 0x4000));
+    state.write(static_cast<std::uint32_t>((second_bank_prg - rom) / 0x4000));
+    if (has_character_ram) {
+        state.write_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
+    }
+    else {
+        const std::uint8_t* vrom = cartridge.getVROM().data();
+        state.write(static_cast<std::uint32_t>((first_bank_chr - vrom) / 0x1000));
+        state.write(static_cast<std::uint32_t>((second_bank_chr - vrom) / 0x1000));
+    }
+}
+
+void MapperSxROM::load(StateReader& state) {
+    state.read(mirroing);
+    state.read(mode_chr);
+    state.read(mode_prg);
+    state.read(temp_register);
+    state.read(write_counter);
+    state.read(register_prg);
+    is_prg_ram_enabled = !(register_prg & 0x10);
+    state.read(register_chr0);
+    state.read(register_chr1);
+    std::uint32_t bank = 0;
+    state.read(bank);
+    first_bank_prg = getBank(cartridge.getROM(), bank, 0x4000);
+    state.read(bank);
+    second_bank_prg = getBank(cartridge.getROM(), bank, 0x4000);
+    mapPRG(0, 2, first_bank_prg);
+    mapPRG(2, 2, second_bank_prg);
+    if (has_character_ram) {
+        state.read_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
+    }
+    else {
+        state.read(bank);
+        first_bank_chr = getBank(cartridge.getVROM(), bank, 0x1000);
+        state.read(bank);
+        second_bank_chr = getBank(cartridge.getVROM(), bank, 0x1000);
+    }
+    mapCHRPages();
 }
\ No newline at end of file
@@ -1,60 +1,43 @@
 #include "mappers/txrom/mapper_txrom.hpp"
 
-MapperTXROM::MapperTXROM(Cartridge& cart, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb) : Mapper(cart), mirroring_callback(mirroring_cb), interrupt_cb(interrupt_cb), prg_ram(32 * 1024), mirroring_ram(4 * 1024) {
+MapperTXROM::MapperTXROM(Cartridge& cart, std::function<void(void)> mirroring_cb, std::function<void(void)> interrupt_cb) : Mapper(cart), mirroring_callback(mirroring_cb), interrupt_cb(interrupt_cb), mirroring_ram(4 * 1024) {
     prg_bank0 = &cart.getROM()[cart.getROM().size() - 0x4000];
     prg_bank1 = &cart.getROM()[cart.getROM().size() - 0x2000];
     prg_bank2 = &cart.getROM()[cart.getROM().size() - 0x4000];
     prg_bank3 = &cart.getROM()[cart.getROM().size() - 0x2000];
+    mapPRGPages();
 
     for (auto& chr_bank : chr_banks)
         chr_bank = cart.getVROM().size() - 0x400;
 
     chr_banks[0] = cart.getVROM().size() - 0x800;
     chr_banks[3] = cart.getVROM().size() - 0x800;
+    mapCHRPages();
 };
 
-std::uint8_t MapperTXROM::readCHR(std::uint16_t address) {
-    if (address < 0x1FFF) {
-        const auto bankSelect = address >> 10;
-        // get the configured base address for the bank
-        const auto baseAddress = chr_banks[bankSelect];
-        const auto offset = address & 0x3ff;
-        return cartridge.getVROM()[baseAddress + offset];
-    }
-    else if (address <= 0x2FFF) {
-        return mirroring_ram[address - 0x2000];
-    }
-
-    return 0x00;
+void MapperTXROM::mapCHRPages() {
+    // banks past the end of the CHR ROM wrap around, and the offsets of a
+    // loaded state are realigned to a bank
+    for (int page = 0; page < 8; page++)
+        mapCHR(page, 1, getBank(cartridge.getVROM(), chr_banks[page] / 0x400, 0x400));
 };
 
-std::uint8_t MapperTXROM::readPRG(std::uint16_t address) {
-    switch (address) {
-    case 0x6000 ... 0x7FFF:
-        return prg_ram[address & 0x1FFF];
-    case 0x8000 ... 0x9FFF:
-        return *(prg_bank0 + (address & 0x1FFF));
-    case 0xA000 ... 0xBFFF:
-        return *(prg_bank1 + (address & 0x1FFF));
-    case 0xC000 ... 0xDFFF:
-        return *(prg_bank2 + (address & 0x1FFF));
-    case 0xE000 ... INT_MAX:
-        return *(prg_bank3 + (address & 0x1FFF));
-    }
-
-    return 0x00;
+void MapperTXROM::mapPRGPages() {
+    mapPRG(0, 1, prg_bank0);
+    mapPRG(1, 1, prg_bank1);
+    mapPRG(2, 1, prg_bank2);
+    mapPRG(3, 1, prg_bank3);
 };
 
 void MapperTXROM::writeCHR(std::uint16_t address, std::uint8_t value) {
     if (address >= 0x2000 && address <= 0x2FFF) {
         mirroring_ram[address - 0x2000] = value;
+        mark_dirty(dirty_mirroring_ram, address - 0x2000);
     }
 };
 
 void MapperTXROM::writePRG(std::uint16_t address, std::uint8_t value) {
-    if (address >= 0x6000 && address <= 0x7FFF) {
-        prg_ram[address & 0x1FFF] = value;
-    } else if (address >= 0x8000 && address <= 0x9FFF) {
+    if (address >= 0x8000 && address <= 0x9FFF) {
         if (!(address & 0x01)) {
             target_register = value & 0x7;
             prg_bank_mode = value & 0x40;
@@ -81,18 +64,20 @@ void MapperTXROM::writePRG(std::uint16_t address, std::uint8_t value) {
                 chr_banks[6] = (bank_register[1] & 0xFE) * 0x0400;
                 chr_banks[7] = (bank_register[1] & 0xFE) * 0x0400 + 0x0400;
             }
+            mapCHRPages();
 
             if (prg_bank_mode == 0) {
-                prg_bank0 = &cartridge.getROM()[(bank_register[6] & 0x3F) * 0x2000];
-                prg_bank1 = &cartridge.getROM()[(bank_register[7] & 0x3F) * 0x2000];
+                prg_bank0 = &cartridge.getROM()[(bank_register[6] & 0x3F) * 0x2000 % cartridge.getROM().size()];
+                prg_bank1 = &cartridge.getROM()[(bank_register[7] & 0x3F) * 0x2000 % cartridge.getROM().size()];
                 prg_bank2 = &cartridge.getROM()[cartridge.getROM().size() - 0x4000];
                 prg_bank3 = &cartridge.getROM()[cartridge.getROM().size() - 0x2000];
             } else if (prg_bank_mode == 1) {
                 prg_bank0 = &cartridge.getROM()[cartridge.getROM().size() - 0x4000];
-                prg_bank1 = &cartridge.getROM()[(bank_register[7] & 0x3F) * 0x2000];
-                prg_bank2 = &cartridge.getROM()[(bank_register[6] & 0x3F) * 0x2000];
+                prg_bank1 = &cartridge.getROM()[(bank_register[7] & 0x3F) * 0x2000 % cartridge.getROM().size()];
+                prg_bank2 = &cartridge.getROM()[(bank_register[6] & 0x3F) * 0x2000 % cartridge.getROM().size()];
                 prg_bank3 = &cartridge.getROM()[cartridge.getROM().size() - 0x2000];
             }
+            mapPRGPages();
         }
     } else if (address >= 0xA000 && address <= 0xBFFF) {
         if (!(address & 0x01)) {
@@ -117,16 +102,71 @@ void MapperTXROM::writePRG(std::uint16_t address, std::uint8_t value) {
         }
     } else if (address >= 0xE000) {
         irq_enabled = (address & 0x01) == 0x01;
+        // disabling also acknowledges the interrupt
+        if (!irq_enabled)
+            irq_asserted = false;
     }
 };
 
-const std::uint8_t* MapperTXROM::getPagePtr(std::uint16_t address) {
-    /*
-    if (address < 0xc000)
-        return (prg_bank0 + (address & 0x3fff));
-    else
-        return (prg_bank1 + (address & 0x3fff));
-        */
+void MapperTXROM::clockScanline() {
+    // irq_pending asks for a reload on the next clock
+    if (irq_count == 0 || irq_pending) {
+        irq_count = irq_latch;
+        irq_pending = false;
+    } else {
+        --irq_count;
+    }
+    if (irq_count == 0 && irq_enabled)
+        irq_asserted = true;
+    // the line is held until acknowledged, so an interrupt the CPU ignores
+    // while masked is raised again on the next line
+    if (irq_asserted)
+        interrupt_cb();
+};
+
+void MapperTXROM::save(StateWriter& state) {
+    // store the bank pointers as 8KB bank numbers
+    const std::uint8_t* rom = cartridge.getROM().data();
+    state.write(static_cast<std::uint32_t>((prg_bank0 - rom) / 0x2000));
+    state.write(static_cast<std::uint32_t>((prg_bank1 - rom) / 0x2000));
+    state.write(static_cast<std::uint32_t>((prg_bank2 - rom) / 0x2000));
+    state.write(static_cast<std::uint32_t>((prg_bank3 - rom) / 0x2000));
+    state.write(chr_banks);
+    state.write(target_register);
+    state.write(prg_bank_mode);
+    state.write(chr_inversion);
+    state.write(bank_register);
+    state.write_pages(mirroring_ram.data(), mirroring_ram.size(), dirty_mirroring_ram);
+    state.write(irq_enabled);
+    state.write(irq_pending);
+    state.write(irq_count);
+    state.write(irq_latch);
+    state.write(irq_asserted);
+    state.write(mirroring);
+};
 
-    return nullptr;
+void MapperTXROM::load(StateReader& state) {
+    std::uint32_t bank = 0;
+    state.read(bank);
+    prg_bank0 = getBank(cartridge.getROM(), bank, 0x2000);
+    state.read(bank);
+    prg_bank1 = getBank(cartridge.getROM(), bank, 0x2000);
+    state.read(bank);
+    prg_bank2 = getBank(cartridge.getROM(), bank, 0x2000);
+    state.read(bank);
+    prg_bank3 = getBank(cartridge.getROM(), bank, 0x2000);
+    mapPRGPages();
+    state.read(chr_banks);
+    mapCHRPages();
+    state.read(target_register);
+    state.read(prg_bank_mode);
+    state.read(chr_inversion);
+    state.read(bank_register);
+    state.read_pages(mirroring_ram.data(), mirroring_ram.size(), dirty_mirroring_ram);
+    state.read(irq_enabled);
+    state.read(irq_pending);
+    state.read(irq_count);
+    state.read(irq_latch);
+    state.read(irq_asserted);
+    state.read(mirroring);
 };
\ No newline at end of file
@@ -6,38 +6,40 @@ MapperUxROM::MapperUxROM(Cartridge& cart) :
     if (cart.getVROM().size() == 0) {
         has_character_ram = true;
         character_ram.resize(0x2000);
+        mapCHR(0, 8, character_ram.data());
     }
-    else
+    else {
         has_character_ram = false;
+        mapCHR(0, 8, cart.getVROM().data());
+    }
 
     // last - 16KB
     last_bank_pointer = &cart.getROM()[cart.getROM().size() - 0x4000];
+    mapPRG(0, 2, cart.getROM().data());
+    mapPRG(2, 2, last_bank_pointer);
 }
 
-std::uint8_t MapperUxROM::readPRG(std::uint16_t address) {
-    if (address < 0xc000)
-        return cartridge.getROM()[((address - 0x8000) & 0x3fff) | (select_prg << 14)];
-    else
-        return *(last_bank_pointer + (address & 0x3fff));
+void MapperUxROM::writePRG(std::uint16_t address, std::uint8_t value) {
+    select_prg = value;
+    mapPRG(0, 2, getBank(cartridge.getROM(), select_prg, 0x4000));
 }
 
-const std::uint8_t* MapperUxROM::getPagePtr(std::uint16_t address) {
-    if (address < 0xc000)
-        return &cartridge.getROM()[((address - 0x8000) & 0x3fff) | (select_prg << 14)];
+void MapperUxROM::writeCHR(std::uint16_t address, std::uint8_t value) {
+    if (has_character_ram) {
+        character_ram[address] = value;
+        mark_dirty(dirty_character_ram, address);
+    }
     else
-        return last_bank_pointer + (address & 0x3fff);
+        return;
 }
 
-std::uint8_t MapperUxROM::readCHR(std::uint16_t address) {
-    if (has_character_ram)
-        return character_ram[address];
-    else
-        return cartridge.getVROM()[address];
+void MapperUxROM::save(StateWriter& state) {
+    state.write(select_prg);
+    state.write_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
 }
 
-void MapperUxROM::writeCHR(std::uint16_t address, std::uint8_t value) {
-    if (has_character_ram)
-        character_ram[address] = value;
-    else
-        return;
+void MapperUxROM::load(StateReader& state) {
+    state.read(select_prg);
+    mapPRG(0, 2, getBank(cartridge.getROM(), select_prg, 0x4000));
+    state.read_pages(character_ram.data(), character_ram.size(), dirty_character_ram);
 }
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <fstream>
+#include <type_traits>
+#include <utility>
+
+#include "movie/movie.hpp"
+#include "state/compression.hpp"
+
+/// The header at the start of every movie file
+struct MovieHeader {
+    /// the magic number identifying the file as a movie
+    std::uint32_t magic;
+    /// the version of the layout of the file
+    std::uint16_t version;
+    /// the number of bytes of input per frame
+    std::uint16_t input_size;
+    /// the hash of the ROM the movie was recorded on
+    std::uint64_t rom_hash;
+    /// the number of frames in the movie
+    std::uint32_t frame_count;
+    /// the number of frames between keyframes
+    std::uint32_t keyframe_interval;
+    /// the size of an uncompressed save state in bytes
+    std::uint32_t state_size;
+    /// the number of keyframes following the input
+    std::uint32_t keyframe_count;
+    /// the number of bytes of compressed input following the header
+    std::uint32_t input_bytes;
+    /// always zero, keeps the header free of padding
+    std::uint32_t reserved;
+};
+
+static_assert(std::has_unique_object_representations_v<MovieHeader>, "the movie header must not contain padding");
+
+/// Write a trivially copyable value to a file.
+template<typename T>
+static inline void write_value(std::ofstream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/// Read a trivially copyable value from a file.
+template<typename T>
+static inline bool read_value(std::ifstream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+Movie::Movie(std::uint32_t keyframe_interval) :
+    keyframe_interval(std::max<std::uint32_t>(keyframe_interval, 1)),
+    state_size(0),
+    rom_hash(0),
+    frame(0) { }
+
+void Movie::capture_keyframe(Emulator& emulator) {
+    emulator.save_state(state_buffer.data(), state_buffer.size());
+    // keyframes are compressed on their own so any of them can be seeked to
+    std::size_t size = compress(state_buffer.data(), nullptr, state_size, scratch.data());
+    keyframes.push_back({ static_cast<std::uint32_t>(frame), std::vector<std::uint8_t>(scratch.begin(), scratch.begin() + size) });
+}
+
+void Movie::start_recording(Emulator& emulator) {
+    inputs.clear();
+    keyframes.clear();
+    frame = 0;
+    state_size = static_cast<std::uint32_t>(emulator.state_size());
+    rom_hash = emulator.get_rom_hash();
+    state_buffer.resize(state_size);
+    scratch.resize(compress_bound(state_size));
+    capture_keyframe(emulator);
+}
+
+void Movie::record(Emulator& emulator) {
+    if (keyframes.empty())
+        start_recording(emulator);
+    // recording after a seek replaces everything after the current frame
+    if (frame < get_frame_count()) {
+        inputs.resize(frame * INPUT_SIZE);
+        while (!keyframes.empty() && keyframes.back().frame > frame)
+            keyframes.pop_back();
+    }
+    if (frame % keyframe_interval == 0 && keyframes.back().frame != frame)
+        capture_keyframe(emulator);
+    inputs.push_back(*emulator.get_controller(0));
+    inputs.push_back(*emulator.get_controller(1));
+    ++frame;
+}
+
+bool Movie::play(Emulator& emulator) {
+    if (frame >= get_frame_count())
+        return false;
+    *emulator.get_controller(0) = inputs[frame * INPUT_SIZE];
+    *emulator.get_controller(1) = inputs[frame * INPUT_SIZE + 1];
+    ++frame;
+    return true;
+}
+
+bool Movie::seek(Emulator& emulator, std::size_t target) {
+    if (keyframes.empty() || target > get_frame_count())
+        return false;
+    // find the last keyframe at or before the target
+    auto keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), target,
+        [](std::size_t target, const Keyframe& keyframe) { return target < keyframe.frame; });
+    --keyframe;
+    if (!decompress(keyframe->state.data(), keyframe->state.size(), state_buffer.data(), state_size, false))
+        return false;
+    if (!emulator.load_state(state_buffer.data(), state_buffer.size()))
+        return false;
+    frame = keyframe->frame;
+    // replay the frames between the keyframe and the target without drawing
+    bool is_headless = emulator.get_headless();
+    emulator.set_headless(true);
+    while (frame < target) {
+        play(emulator);
+        emulator.step();
+    }
+    emulator.set_headless(is_headless);
+    return true;
+}
+
+bool Movie::save(std::string path) {
+    if (get_frame_count() > MOVIE_MAX_FRAMES)
+        return false;
+    // store each frame's input as the XOR against the frame before it, so
+    // held buttons compress into runs of zeros
+    std::vector<std::uint8_t> deltas(inputs.size());
+    for (std::size_t i = 0; i < inputs.size(); i++)
+        deltas[i] = i < INPUT_SIZE ? inputs[i] : inputs[i] ^ inputs[i - INPUT_SIZE];
+    std::vector<std::uint8_t> compressed(compress_bound(deltas.size()));
+    compressed.resize(compress(deltas.data(), nullptr, deltas.size(), compressed.data()));
+
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
+    write_value(file, MovieHeader{
+        MOVIE_MAGIC,
+        MOVIE_VERSION,
+        static_cast<std::uint16_t>(INPUT_SIZE),
+        rom_hash,
+        static_cast<std::uint32_t>(get_frame_count()),
+        keyframe_interval,
+        state_size,
+        static_cast<std::uint32_t>(keyframes.size()),
+        static_cast<std::uint32_t>(compressed.size()),
+        0
+    });
+    file.write(reinterpret_cast<const char*>(compressed.data()), compressed.size());
+    for (const Keyframe& keyframe : keyframes) {
+        write_value(file, keyframe.frame);
+        write_value(file, static_cast<std::uint32_t>(keyframe.state.size()));
+        file.write(reinterpret_cast<const char*>(keyframe.state.data()), keyframe.state.size());
+    }
+    return static_cast<bool>(file);
+}
+
+bool Movie::load(std::string path, Emulator& emulator) {
+    std::ifstream file(path, std::ios_base::binary | std::ios_base::in | std::ios_base::ate);
+    // no compressed block can be larger than the file holding it
+    std::size_t file_size = file ? static_cast<std::size_t>(file.tellg()) : 0;
+    file.seekg(0);
+    MovieHeader header;
+    if (!read_value(file, header))
+        return false;
+    std::size_t input_count = static_cast<std::size_t>(header.frame_count) * INPUT_SIZE;
+    // each keyframe takes at least its frame and size in the file
+    std::size_t keyframe_bytes = static_cast<std::size_t>(header.keyframe_count) * 2 * sizeof(std::uint32_t);
+    // a movie only replays on the ROM it was recorded on, and its keyframes
+    // must be states of exactly the emulator's size
+    if (header.magic != MOVIE_MAGIC || header.version != MOVIE_VERSION || header.input_size != INPUT_SIZE ||
+        header.rom_hash != emulator.get_rom_hash() || header.state_size != emulator.state_size() ||
+        header.frame_count > MOVIE_MAX_FRAMES || header.keyframe_interval == 0 || header.keyframe_count == 0 || keyframe_bytes > file_size ||
+        header.input_bytes > std::min(compress_bound(input_count), file_size))
+        return false;
+    // read and undo the delta encoding of the input, checking the frame
+    // count against what the input expands to before allocating for it
+    std::vector<std::uint8_t> compressed(header.input_bytes);
+    if (!file.read(reinterpret_cast<char*>(compressed.data()), compressed.size()))
+        return false;
+    if (decompressed_size(compressed.data(), compressed.size()) != input_count)
+        return false;
+    std::vector<std::uint8_t> loaded_inputs(input_count);
+    if (!decompress(compressed.data(), compressed.size(), loaded_inputs.data(), loaded_inputs.size(), false))
+        return false;
+    for (std::size_t i = INPUT_SIZE; i < loaded_inputs.size(); i++)
+        loaded_inputs[i] ^= loaded_inputs[i - INPUT_SIZE];
+    // read the keyframes, which must start at frame 0 and stay in order
+    std::vector<Keyframe> loaded_keyframes(header.keyframe_count);
+    for (std::uint32_t i = 0; i < header.keyframe_count; i++) {
+        std::uint32_t size;
+        if (!read_value(file, loaded_keyframes[i].frame) || !read_value(file, size))
+            return false;
+        if (loaded_keyframes[i].frame > header.frame_count || size > std::min(compress_bound(header.state_size), file_size))
+            return false;
+        if (i == 0 ? loaded_keyframes[i].frame != 0 : loaded_keyframes[i].frame <= loaded_keyframes[i - 1].frame)
+            return false;
+        loaded_keyframes[i].state.resize(size);
+        if (!file.read(reinterpret_cast<char*>(loaded_keyframes[i].state.data()), size))
+            return false;
+    }
+    // only replace the movie once the whole file is known to be valid
+    keyframe_interval = header.keyframe_interval;
+    state_size = header.state_size;
+    rom_hash = header.rom_hash;
+    inputs = std::move(loaded_inputs);
+    keyframes = std::move(loaded_keyframes);
+    frame = 0;
+    state_buffer.resize(state_size);
+    scratch.resize(compress_bound(state_size));
+    return true;
+}
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "netplay/rollback.hpp"
+
+RollbackSession::RollbackSession(Emulator& emulator, Transport& transport, int local_port, int max_rollback, int input_delay) :
+    emulator(emulator),
+    transport(transport),
+    local_port(local_port),
+    max_rollback(std::clamp(max_rollback, 1, INPUT_RING / 8)),
+    frame(0),
+    local_frame(std::clamp(input_delay, 0, INPUT_RING / 8)),
+    confirmed_frame(-1),
+    remote_ack(0),
+    rollback_frame(-1),
+    hashed_frame(-1),
+    desync_frame(-1),
+    rollback_frames(0),
+    rollback_time(0) {
+    states.resize(this->max_rollback * emulator.state_size());
+    // the frames covered by the input delay run with no buttons pressed
+    local_inputs.fill(0);
+    remote_frames.fill(-1);
+    local_hash_frames.fill(-1);
+    remote_hash_frames.fill(-1);
+}
+
+std::uint8_t RollbackSession::remote_input(std::int32_t frame) {
+    if (remote_frames[frame % INPUT_RING] == frame)
+        return remote_inputs[frame % INPUT_RING];
+    // predict that the remote player is still holding the same buttons
+    return confirmed_frame < 0 ? 0 : remote_inputs[confirmed_frame % INPUT_RING];
+}
+
+void RollbackSession::run_frame(std::int32_t frame) {
+    emulator.save_state(state_at(frame), emulator.state_size());
+    simulated_inputs[frame % INPUT_RING] = remote_input(frame);
+    *emulator.get_controller(local_port) = local_inputs[frame % INPUT_RING];
+    *emulator.get_controller(1 - local_port) = simulated_inputs[frame % INPUT_RING];
+    emulator.step();
+}
+
+void RollbackSession::check_hash(std::int32_t frame) {
+    int index = frame % HASH_RING;
+    if (local_hash_frames[index] != frame || remote_hash_frames[index] != frame)
+        return;
+    if (local_hashes[index] != remote_hashes[index] && (desync_frame < 0 || frame < desync_frame))
+        desync_frame = frame;
+}
+
+void RollbackSession::receive() {
+    while (std::size_t size = transport.receive(packet.data(), packet.size())) {
+        StateReader reader(packet.data(), size);
+        std::uint32_t ack, first, hash_frame;
+        std::uint8_t count;
+        std::uint64_t hash;
+        reader.read(ack);
+        reader.read(first);
+        reader.read(count);
+        if (!reader.is_valid() || reader.size() + count + 12 != size)
+            continue;
+        // drop packets claiming input too far ahead to store, or an ack of
+        // input that was never sent
+        if (first > static_cast<std::uint32_t>(confirmed_frame + 1 + INPUT_RING) || ack > static_cast<std::uint32_t>(local_frame))
+            continue;
+        const std::uint8_t* inputs = packet.data() + reader.size();
+        StateReader trailer(inputs + count, 12);
+        trailer.read(hash_frame);
+        trailer.read(hash);
+        remote_ack = std::max(remote_ack, static_cast<std::int32_t>(ack));
+        for (std::int32_t i = 0; i < count; i++) {
+            std::int32_t input_frame = static_cast<std::int32_t>(first) + i;
+            // skip inputs already received and any too far ahead to store
+            if (input_frame <= confirmed_frame || input_frame > confirmed_frame + INPUT_RING)
+                continue;
+            int index = input_frame % INPUT_RING;
+            if (remote_frames[index] == input_frame)
+                continue;
+            remote_frames[index] = input_frame;
+            remote_inputs[index] = inputs[i];
+            // a frame that already ran with the wrong prediction must run again
+            if (input_frame < frame && simulated_inputs[index] != inputs[i] && (rollback_frame < 0 || input_frame < rollback_frame))
+                rollback_frame = input_frame;
+        }
+        while (remote_frames[(confirmed_frame + 1) % INPUT_RING] == confirmed_frame + 1)
+            ++confirmed_frame;
+        // only keep hashes of frames that can still be in the hash ring
+        if (hash_frame != UINT32_MAX && hash_frame <= INT32_MAX && std::abs(static_cast<std::int64_t>(hash_frame) - frame) < HASH_RING) {
+            std::int32_t remote_hash_frame = static_cast<std::int32_t>(hash_frame);
+            remote_hashes[remote_hash_frame % HASH_RING] = hash;
+            remote_hash_frames[remote_hash_frame % HASH_RING] = remote_hash_frame;
+            check_hash(remote_hash_frame);
+        }
+    }
+}
+
+void RollbackSession::send() {
+    std::int32_t first = std::max(remote_ack, local_frame - (INPUT_RING - 1));
+    StateWriter writer(packet.data(), packet.size());
+    writer.write(static_cast<std::uint32_t>(confirmed_frame + 1));
+    writer.write(static_cast<std::uint32_t>(first));
+    writer.write(static_cast<std::uint8_t>(local_frame - first));
+    for (std::int32_t input_frame = first; input_frame < local_frame; input_frame++)
+        writer.write(local_inputs[input_frame % INPUT_RING]);
+    writer.write(hashed_frame < 0 ? UINT32_MAX : static_cast<std::uint32_t>(hashed_frame));
+    writer.write(hashed_frame < 0 ? 0 : local_hashes[hashed_frame % HASH_RING]);
+    transport.send(packet.data(), writer.size());
+}
+
+bool RollbackSession::advance(std::uint8_t input) {
+    receive();
+    rollback_frames = 0;
+    if (rollback_frame >= 0) {
+        auto start = std::chrono::steady_clock::now();
+        // load the first mispredicted frame and run back up to the present
+        emulator.load_state(state_at(rollback_frame), emulator.state_size());
+        bool is_headless = emulator.get_headless();
+        emulator.set_headless(true);
+        for (std::int32_t resimulated = rollback_frame; resimulated < frame; resimulated++)
+            run_frame(resimulated);
+        emulator.set_headless(is_headless);
+        rollback_frames = frame - rollback_frame;
+        rollback_frame = -1;
+        rollback_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    // hash the states that can no longer be rolled back, while still stored
+    std::int32_t final_frame = std::min(confirmed_frame + 1, frame - 1);
+    for (std::int32_t hashed = std::max(hashed_frame + 1, frame - max_rollback); hashed <= final_frame; hashed++) {
+        local_hashes[hashed % HASH_RING] = hash_state(state_at(hashed), emulator.state_size());
+        local_hash_frames[hashed % HASH_RING] = hashed;
+        hashed_frame = hashed;
+        check_hash(hashed);
+    }
+    // there is no saved state to roll back to past the oldest prediction
+    bool is_running = frame - confirmed_frame <= max_rollback;
+    if (is_running) {
+        local_inputs[local_frame % INPUT_RING] = input;
+        ++local_frame;
+        run_frame(frame);
+        ++frame;
+    }
+    send();
+    return is_running;
+}
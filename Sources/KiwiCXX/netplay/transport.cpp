@@ -0,0 +1,80 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "netplay/transport.hpp"
+
+LoopbackTransport::LoopbackTransport(std::size_t latency) :
+    inbox(std::make_shared<Channel>()),
+    latency(latency) { }
+
+void LoopbackTransport::connect(LoopbackTransport& a, LoopbackTransport& b) {
+    a.outbox = b.inbox;
+    b.outbox = a.inbox;
+}
+
+void LoopbackTransport::send(const std::uint8_t* data, std::size_t size) {
+    if (!outbox)
+        return;
+    in_flight.emplace_back(data, data + size);
+    // deliver the packets that have been held back long enough
+    std::lock_guard<std::mutex> guard(outbox->lock);
+    while (in_flight.size() > latency) {
+        outbox->packets.push_back(std::move(in_flight.front()));
+        in_flight.pop_front();
+    }
+}
+
+std::size_t LoopbackTransport::receive(std::uint8_t* data, std::size_t capacity) {
+    std::lock_guard<std::mutex> guard(inbox->lock);
+    if (inbox->packets.empty())
+        return 0;
+    std::vector<std::uint8_t> packet = std::move(inbox->packets.front());
+    inbox->packets.pop_front();
+    // like a datagram, a packet that doesn't fit is truncated
+    std::size_t size = std::min(packet.size(), capacity);
+    std::copy(packet.begin(), packet.begin() + size, data);
+    return size;
+}
+
+UDPTransport::UDPTransport(std::uint16_t local_port, std::string remote_address, std::uint16_t remote_port) :
+    socket_fd(socket(AF_INET, SOCK_DGRAM, 0)) {
+    if (socket_fd < 0)
+        return;
+    sockaddr_in local = {};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(local_port);
+    sockaddr_in remote = {};
+    remote.sin_family = AF_INET;
+    remote.sin_port = htons(remote_port);
+    // a connected socket only receives packets from the remote peer
+    if (inet_pton(AF_INET, remote_address.c_str(), &remote.sin_addr) != 1 ||
+        bind(socket_fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) != 0 ||
+        connect(socket_fd, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) != 0 ||
+        fcntl(socket_fd, F_SETFL, fcntl(socket_fd, F_GETFL) | O_NONBLOCK) != 0) {
+        close(socket_fd);
+        socket_fd = -1;
+    }
+}
+
+UDPTransport::~UDPTransport() {
+    if (socket_fd >= 0)
+        close(socket_fd);
+}
+
+void UDPTransport::send(const std::uint8_t* data, std::size_t size) {
+    if (socket_fd >= 0)
+        ::send(socket_fd, data, size, 0);
+}
+
+std::size_t UDPTransport::receive(std::uint8_t* data, std::size_t capacity) {
+    if (socket_fd < 0)
+        return 0;
+    // errors (including a peer that isn't listening yet) read as no packet
+    ssize_t size = recv(socket_fd, data, capacity, 0);
+    return size > 0 ? static_cast<std::size_t>(size) : 0;
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "pacing/frame_pacer.hpp"
+
+/// The number of frames per second the emulator runs at
+static const double FRAME_RATE = CPU_CLOCK_RATE / Emulator::CYCLES_PER_FRAME;
+
+void FramePacer::Statistic::add(double value) {
+    min = count ? std::min(min, value) : value;
+    max = count ? std::max(max, value) : value;
+    // Welford's update keeps the deviation accurate over long runs
+    ++count;
+    double delta = value - mean;
+    mean += delta / count;
+    m2 += delta * (value - mean);
+}
+
+double FramePacer::Statistic::get_deviation() const {
+    return count > 1 ? std::sqrt(m2 / count) : 0;
+}
+
+FramePacer::FramePacer(Emulator& emulator, double target_latency, double max_adjustment, int max_skip) :
+    emulator(emulator),
+    target_latency(target_latency),
+    max_adjustment(std::clamp(max_adjustment, 0.0, 0.05)),
+    max_skip(max_skip),
+    is_blocking(true),
+    ratio(1),
+    latency(0) {
+    reset_stats();
+}
+
+int FramePacer::step() {
+    AudioRing& ring = emulator.get_audio_ring();
+    // without audio there is nothing to pace by
+    if (emulator.get_headless() || ring.capacity() == 0) {
+        emulator.step();
+        return 0;
+    }
+    double sample_rate = emulator.get_sample_rate();
+    double frame_samples = sample_rate / FRAME_RATE;
+    // the target has to leave the ring room to absorb a late host
+    double target = std::min(target_latency * sample_rate, ring.capacity() / 2.0);
+    double fill = ring.size();
+    // ahead of the host, wait for it to play down to the target
+    if (is_blocking && fill > target) {
+        std::this_thread::sleep_for(std::chrono::duration<double>((fill - target) / sample_rate));
+        fill = ring.size();
+    }
+    if (fill == 0)
+        ++underruns;
+    // behind the host, catch up with frames that are heard but not drawn
+    int skipped = 0;
+    while (fill < frame_samples && skipped < max_skip) {
+        emulator.skip_frame();
+        ++skipped;
+        fill = ring.size();
+    }
+    skipped_frames += skipped;
+    auto start = std::chrono::steady_clock::now();
+    if (frames)
+        interval_stat.add(std::chrono::duration<double, std::milli>(start - last_start).count());
+    last_start = start;
+    latency = fill / sample_rate;
+    latency_stat.add(latency * 1000);
+    // resample slightly faster or slower to settle the fill on the target
+    ratio = 1 + max_adjustment * std::clamp((target - fill) / target, -1.0, 1.0);
+    emulator.set_audio_rate_adjustment(ratio);
+    emulator.step();
+    ++frames;
+    return skipped;
+}
+
+FramePacer::Stats FramePacer::get_stats() {
+    return Stats{
+        latency * 1000,
+        latency_stat.mean,
+        latency_stat.min,
+        latency_stat.max,
+        latency_stat.get_deviation(),
+        interval_stat.mean,
+        interval_stat.get_deviation(),
+        ratio,
+        frames,
+        skipped_frames,
+        underruns,
+    };
+}
+
+void FramePacer::reset_stats() {
+    latency_stat = interval_stat = Statistic{};
+    frames = skipped_frames = underruns = 0;
+}
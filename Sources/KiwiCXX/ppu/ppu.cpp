@@ -1,11 +1,16 @@
+#include <algorithm>
+#include <cstring>
+
 #include "ppu/palette.hpp"
 #include "ppu/ppu.hpp"
 
 void PPU::reset() {
     is_long_sprites = is_interrupting = is_vblank = false;
+    is_sprite_zero_hit = is_hiding_edge_sprites = is_hiding_edge_background = false;
     is_showing_background = is_showing_sprites = is_even_frame = is_first_write = true;
     background_page = sprite_page = LOW;
     data_address = 0;
+    data_buffer = 0;
     cycles = 0;
     scanline = 0;
     sprite_data_address = 0;
@@ -15,6 +20,27 @@ void PPU::reset() {
     pipeline_state = PRE_RENDER;
     scanline_sprites.reserve(8);
     scanline_sprites.resize(0);
+    update_A12_dot();
+}
+
+void PPU::set_scanline_callback(std::function<void(void)> cb, bool is_every_line) {
+    scanline_callback = cb;
+    this->is_every_line = cb && is_every_line;
+    update_A12_dot();
+}
+
+void PPU::update_A12_dot() {
+    a12_dot = -1;
+    if (!scanline_callback || is_every_line || !(is_showing_background || is_showing_sprites))
+        return;
+    // empty slots of 8x16 sprites fetch tile $FF from the high table
+    bool is_sprite_high = is_long_sprites || sprite_page == HIGH;
+    // A12 rises once a line when the tables differ: at the sprite fetches
+    // if only sprites are high, at the next line's tile fetches otherwise
+    if (background_page == LOW && is_sprite_high)
+        a12_dot = 260;
+    else if (background_page == HIGH && !is_sprite_high)
+        a12_dot = 324;
 }
 
 void PPU::cycle(PictureBus& bus) {
@@ -32,10 +58,14 @@ void PPU::cycle(PictureBus& bus) {
             data_address &= ~0x7be0; //Unset bits related to horizontal
             data_address |= temp_address & 0x7be0; //Copy
         }
+        else if (cycles == a12_dot)
+            scanline_callback();
         // if (cycles > 257 && cycles < 320)
         //     sprite_data_address = 0;
         // if rendering is on, every other frame is one cycle shorter
         if (cycles >= SCANLINE_END_CYCLE - (!is_even_frame && is_showing_background && is_showing_sprites)) {
+            if (is_every_line)
+                scanline_callback();
             pipeline_state = RENDER;
             cycles = scanline = 0;
         }
@@ -49,9 +79,14 @@ void PPU::cycle(PictureBus& bus) {
             int x = cycles - 1;
             int y = scanline;
 
+            // frames that will be discarded only need the pixels under sprite
+            // zero until it hits, unless the fetches flip CHR latches
+            bool is_pixel_needed = !is_render_suppressed || bus.has_CHR_latch() || (!is_sprite_zero_hit && !scanline_sprites.empty() &&
+                scanline_sprites[0] == 0 && x - sprite_memory[3] >= 0 && x - sprite_memory[3] < 8);
+
             if (is_showing_background) {
                 auto x_fine = (fine_x_scroll + x) % 8;
-                if (!is_hiding_edge_background || x >= 8) {
+                if (is_pixel_needed && (!is_hiding_edge_background || x >= 8)) {
                     // fetch tile
                     // mask off fine y
                     auto address = 0x2000 | (data_address & 0x0FFF);
@@ -96,7 +131,7 @@ void PPU::cycle(PictureBus& bus) {
                 }
             }
 
-            if (is_showing_sprites && (!is_hiding_edge_sprites || x >= 8)) {
+            if (is_pixel_needed && is_showing_sprites && (!is_hiding_edge_sprites || x >= 8)) {
                 for (auto i : scanline_sprites) {
                     std::uint8_t spr_x = sprite_memory[i * 4 + 3];
 
@@ -150,15 +185,19 @@ void PPU::cycle(PictureBus& bus) {
                     break; //Exit the loop now since we've found the highest priority sprite
                 }
             }
-            // get the address of the color in the palette
-            std::uint8_t paletteAddr = bgColor;
-            if ((!bgOpaque && sprOpaque) || (bgOpaque && sprOpaque && spriteForeground))
-                paletteAddr = sprColor;
-            else if (!bgOpaque && !sprOpaque)
-                paletteAddr = 0;
-            // lookup the pixel in the palette and write it to the screen
-            uint32_t palette = PALETTE[bus.read_palette(paletteAddr)];
-            screen[y][x] = ((palette & 0x00FF0000) >> 16)  | ((palette & 0x0000FF00)) | ((palette & 0x000000FF) << 16) | ((palette & 0xFF000000));
+            // frames that will be discarded skip drawing the pixel
+            if (!is_render_suppressed) {
+                // get the address of the color in the palette
+                std::uint8_t paletteAddr = bgColor;
+                if ((!bgOpaque && sprOpaque) || (bgOpaque && sprOpaque && spriteForeground))
+                    paletteAddr = sprColor;
+                else if (!bgOpaque && !sprOpaque)
+                    paletteAddr = 0;
+                // lookup the pixel in the palette and write it to the screen,
+                // palette RAM only holds the low 6 bits
+                uint32_t palette = PALETTE[bus.read_palette(paletteAddr) & 0x3f];
+                screen[y * SCANLINE_VISIBLE_DOTS + x] = ((palette & 0x00FF0000) >> 16)  | ((palette & 0x0000FF00)) | ((palette & 0x000000FF) << 16) | ((palette & 0xFF000000));
+            }
         }
         else if (cycles == SCANLINE_VISIBLE_DOTS + 1 && is_showing_background) {
             //Shamelessly copied from nesdev wiki
@@ -184,6 +223,8 @@ void PPU::cycle(PictureBus& bus) {
             data_address &= ~0x41f;
             data_address |= temp_address & 0x41f;
         }
+        else if (cycles == a12_dot)
+            scanline_callback();
 
         //                 if (cycles > 257 && cycles < 320)
         //                     sprite_data_address = 0;
@@ -209,6 +250,10 @@ void PPU::cycle(PictureBus& bus) {
                 }
             }
 
+            if (is_every_line)
+                scanline_callback();
+            if (!is_render_suppressed)
+                ++rendered_scanlines;
             ++scanline;
             cycles = 0;
         }
@@ -219,6 +264,8 @@ void PPU::cycle(PictureBus& bus) {
         break;
     case POST_RENDER:
         if (cycles >= SCANLINE_END_CYCLE) {
+            if (is_every_line)
+                scanline_callback();
             ++scanline;
             cycles = 0;
             pipeline_state = VERTICAL_BLANK;
@@ -232,6 +279,8 @@ void PPU::cycle(PictureBus& bus) {
         }
 
         if (cycles >= SCANLINE_END_CYCLE) {
+            if (is_every_line)
+                scanline_callback();
             ++scanline;
             cycles = 0;
         }
@@ -252,6 +301,7 @@ void PPU::cycle(PictureBus& bus) {
 }
 
 void PPU::do_DMA(const std::uint8_t* page_ptr) {
+    mark_dirty(dirty_sprite_memory, 0);
     std::memcpy(sprite_memory.data() + sprite_data_address, page_ptr, 256 - sprite_data_address);
     if (sprite_data_address)
         std::memcpy(sprite_memory.data(), page_ptr + (256 - sprite_data_address), sprite_data_address);
@@ -271,6 +321,7 @@ void PPU::control(std::uint8_t ctrl) {
     //Set the nametable in the temp address, this will be reflected in the data address during rendering
     temp_address &= ~0xc00;                 //Unset
     temp_address |= (ctrl & 0x3) << 10;     //Set according to ctrl bits
+    update_A12_dot();
 }
 
 void PPU::set_mask(std::uint8_t mask) {
@@ -278,6 +329,7 @@ void PPU::set_mask(std::uint8_t mask) {
     is_hiding_edge_sprites = !(mask & 0x4);
     is_showing_background = mask & 0x8;
     is_showing_sprites = mask & 0x10;
+    update_A12_dot();
 }
 
 std::uint8_t PPU::get_status() {
@@ -336,3 +388,87 @@ void PPU::set_scroll(std::uint8_t scroll) {
         is_first_write = true;
     }
 }
+
+void PPU::clear() {
+    std::fill(sprite_memory.begin(), sprite_memory.end(), 0);
+    std::fill(screen.begin(), screen.end(), 0);
+    dirty_sprite_memory = ~0ull;
+}
+
+void PPU::set_screen_allocated(bool is_allocated) {
+    if (is_allocated)
+        screen.resize(VISIBLE_SCANLINES * SCANLINE_VISIBLE_DOTS);
+    else
+        std::vector<std::uint32_t>().swap(screen);
+    if (screen.empty())
+        is_render_suppressed = true;
+}
+
+void PPU::save(StateWriter& state) {
+    state.write_pages(sprite_memory.data(), sprite_memory.size(), dirty_sprite_memory);
+    // the sprite list is padded to 8 entries to keep the state a fixed size
+    std::uint8_t sprites[8] = { 0 };
+    std::copy(scanline_sprites.begin(), scanline_sprites.end(), sprites);
+    state.write(static_cast<std::uint8_t>(scanline_sprites.size()));
+    state.write(sprites);
+    state.write(pipeline_state);
+    state.write(cycles);
+    state.write(scanline);
+    state.write(is_even_frame);
+    state.write(is_vblank);
+    state.write(is_sprite_zero_hit);
+    state.write(data_address);
+    state.write(temp_address);
+    state.write(fine_x_scroll);
+    state.write(is_first_write);
+    state.write(data_buffer);
+    state.write(sprite_data_address);
+    state.write(is_showing_sprites);
+    state.write(is_showing_background);
+    state.write(is_hiding_edge_sprites);
+    state.write(is_hiding_edge_background);
+    state.write(is_long_sprites);
+    state.write(is_interrupting);
+    state.write(background_page);
+    state.write(sprite_page);
+    state.write(data_address_increment);
+}
+
+void PPU::load(StateReader& state) {
+    state.read_pages(sprite_memory.data(), sprite_memory.size(), dirty_sprite_memory);
+    std::uint8_t sprites[8];
+    std::uint8_t sprite_count = 0;
+    state.read(sprite_count);
+    state.read(sprites);
+    scanline_sprites.assign(sprites, sprites + std::min<std::uint8_t>(sprite_count, 8));
+    state.read(pipeline_state);
+    state.read(cycles);
+    state.read(scanline);
+    state.read(is_even_frame);
+    state.read(is_vblank);
+    state.read(is_sprite_zero_hit);
+    state.read(data_address);
+    state.read(temp_address);
+    state.read(fine_x_scroll);
+    state.read(is_first_write);
+    state.read(data_buffer);
+    state.read(sprite_data_address);
+    state.read(is_showing_sprites);
+    state.read(is_showing_background);
+    state.read(is_hiding_edge_sprites);
+    state.read(is_hiding_edge_background);
+    state.read(is_long_sprites);
+    state.read(is_interrupting);
+    state.read(background_page);
+    state.read(sprite_page);
+    state.read(data_address_increment);
+    // a state from a movie or a peer may hold anything, so whatever indexes
+    // memory is put back in range
+    for (auto& sprite : scanline_sprites)
+        sprite &= 63;
+    pipeline_state = static_cast<State>(std::clamp<int>(pipeline_state, PRE_RENDER, VERTICAL_BLANK));
+    cycles = std::clamp(cycles, 0, SCANLINE_END_CYCLE);
+    scanline = std::clamp(scanline, 0, pipeline_state == RENDER ? VISIBLE_SCANLINES - 1 : FRAME_END_SCANLINE - 1);
+    fine_x_scroll &= 7;
+    update_A12_dot();
+}
\ No newline at end of file
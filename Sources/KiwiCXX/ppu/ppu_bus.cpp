@@ -1,57 +1,35 @@
-#include "ppu/ppu_bus.hpp"
+#include <algorithm>
 
-std::uint8_t PictureBus::read(std::uint16_t address) {
-    if (address < 0x2000) {
-        return mapper->readCHR(address);
-    }
-    // Name tables up to 0x3000, then mirrored up to 0x3ff
-    else if (address < 0x3eff) {
-        // NT0
-        if (address < 0x2400)
-            return ram[name_tables[0] + (address & 0x3ff)];
-        // NT1
-        else if (address < 0x2800)
-            return ram[name_tables[1] + (address & 0x3ff)];
-        // NT2
-        else if (address < 0x2c00)
-            return ram[name_tables[2] + (address & 0x3ff)];
-        // NT3
-        else
-            return ram[name_tables[3] + (address & 0x3ff)];
-    }
-    else if (address < 0x3fff) {
-        return palette[address & 0x1f];
-    }
-    return 0;
-}
+#include "ppu/ppu_bus.hpp"
 
 void PictureBus::write(std::uint16_t address, std::uint8_t value) {
+    address &= 0x3fff;
     if (address < 0x2000) {
         mapper->writeCHR(address, value);
     }
-    // Name tables up to 0x3000, then mirrored up to 0x3ff
-    else if (address < 0x3eff) {
-        // NT0
-        if (address < 0x2400)
-            ram[name_tables[0] + (address & 0x3ff)] = value;
-        // NT1
-        else if (address < 0x2800)
-            ram[name_tables[1] + (address & 0x3ff)] = value;
-        // NT2
-        else if (address < 0x2c00)
-            ram[name_tables[2] + (address & 0x3ff)] = value;
-        // NT3
-        else
-            ram[name_tables[3] + (address & 0x3ff)] = value;
+    // Name tables up to 0x3000, then mirrored up to 0x3eff
+    else if (address < 0x3f00) {
+        std::size_t offset = name_tables[(address >> 10) & 0x3] + (address & 0x3ff);
+        ram[offset] = value;
+        mark_dirty(dirty_ram, offset);
     }
-    else if (address < 0x3fff) {
+    else {
         if (address == 0x3f10)
             palette[0] = value;
         else
             palette[address & 0x1f] = value;
+        mark_dirty(dirty_palette, 0);
     }
 }
 
+void PictureBus::set_mapper(Mapper* mapper) {
+    this->mapper = mapper;
+    // the mapper keeps the CHR pages of the table current
+    mapper->setPageTable(pages);
+    is_latching = mapper->hasCHRLatch();
+    update_mirroring();
+}
+
 void PictureBus::update_mirroring() {
     switch (mapper->getNameTableMirroring()) {
     case HORIZONTAL:
@@ -71,4 +49,24 @@ void PictureBus::update_mirroring() {
     default:
         name_tables[0] = name_tables[1] = name_tables[2] = name_tables[3] = 0;
     }
+    // $2000-$2FFF and its mirror at $3000-$3FFF
+    for (int page = 8; page < 16; page++)
+        pages[page] = ram.data() + name_tables[page & 0x3];
+}
+
+void PictureBus::clear() {
+    std::fill(ram.begin(), ram.end(), 0);
+    std::fill(palette.begin(), palette.end(), 0);
+    dirty_ram = dirty_palette = ~0ull;
+}
+
+void PictureBus::save(StateWriter& state) {
+    state.write_pages(ram.data(), ram.size(), dirty_ram);
+    state.write_pages(palette.data(), palette.size(), dirty_palette);
+}
+
+void PictureBus::load(StateReader& state) {
+    state.read_pages(ram.data(), ram.size(), dirty_ram);
+    state.read_pages(palette.data(), palette.size(), dirty_palette);
+    update_mirroring();
 }
\ No newline at end of file
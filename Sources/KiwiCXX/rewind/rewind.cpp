@@ -0,0 +1,103 @@
+#include <cstring>
+#include <utility>
+
+#include "rewind/rewind.hpp"
+#include "state/compression.hpp"
+
+RewindBuffer::RewindBuffer(std::size_t state_size, std::size_t capacity, int keyframe_interval) :
+    state_size(state_size),
+    keyframe_interval(keyframe_interval),
+    since_keyframe(0),
+    arena(capacity),
+    arena_head(0),
+    snapshots(capacity / 256 + 2 * keyframe_interval),
+    first(0),
+    count(0),
+    current(state_size),
+    staging(state_size),
+    scratch(compress_bound(state_size)) { }
+
+void RewindBuffer::drop_oldest() {
+    // deltas can't be rebuilt without the keyframe before them
+    do {
+        first = (first + 1) % snapshots.size();
+        --count;
+    } while (count > 0 && !at(0).is_keyframe);
+}
+
+std::size_t RewindBuffer::allocate(std::size_t size) {
+    if (size > arena.size())
+        return arena.size();
+    std::size_t offset = arena_head;
+    if (offset + size > arena.size()) {
+        // wrap around, the snapshots past the head are the oldest ones
+        while (count > 0 && at(0).offset >= offset)
+            drop_oldest();
+        offset = 0;
+    }
+    // the oldest snapshot is always the next one after the head
+    while (count > 0 && at(0).offset < offset + size && at(0).offset + at(0).size > offset)
+        drop_oldest();
+    return offset;
+}
+
+void RewindBuffer::push() {
+    if (count == snapshots.size())
+        drop_oldest();
+    bool is_keyframe = count == 0 || since_keyframe + 1 >= keyframe_interval;
+    std::size_t size = compress(staging.data(), is_keyframe ? nullptr : current.data(), state_size, scratch.data());
+    std::size_t offset = allocate(size);
+    // a delta is useless if making room dropped everything before it
+    if (!is_keyframe && count == 0) {
+        is_keyframe = true;
+        size = compress(staging.data(), nullptr, state_size, scratch.data());
+        offset = allocate(size);
+    }
+    // the state can never fit, keep deltas relative to the last stored state
+    if (offset == arena.size())
+        return;
+    std::memcpy(arena.data() + offset, scratch.data(), size);
+    at(count) = { offset, size, is_keyframe };
+    ++count;
+    arena_head = offset + size;
+    since_keyframe = is_keyframe ? 0 : since_keyframe + 1;
+    std::swap(current, staging);
+}
+
+const std::uint8_t* RewindBuffer::pop() {
+    if (count == 0)
+        return nullptr;
+    // hand out the newest state and rebuild the one before it
+    std::swap(current, staging);
+    Snapshot newest = at(count - 1);
+    --count;
+    arena_head = newest.offset;
+    if (count > 0) {
+        if (!newest.is_keyframe) {
+            // XOR is its own inverse, so undo the delta directly
+            std::memcpy(current.data(), staging.data(), state_size);
+            decompress(arena.data() + newest.offset, newest.size, current.data(), state_size, true);
+        }
+        else {
+            // replay the deltas forward from the keyframe before it
+            std::size_t index = count - 1;
+            while (!at(index).is_keyframe)
+                --index;
+            decompress(arena.data() + at(index).offset, at(index).size, current.data(), state_size, false);
+            for (std::size_t i = index + 1; i < count; i++)
+                decompress(arena.data() + at(i).offset, at(i).size, current.data(), state_size, true);
+        }
+    }
+    // count the deltas since the newest remaining keyframe
+    since_keyframe = 0;
+    for (std::size_t i = count; i > 0 && !at(i - 1).is_keyframe; i--)
+        ++since_keyframe;
+    return staging.data();
+}
+
+std::size_t RewindBuffer::bytes_used() {
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; i++)
+        total += at(i).size;
+    return total;
+}
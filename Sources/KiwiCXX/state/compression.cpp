@@ -0,0 +1,120 @@
+#include <cstring>
+
+#include "state/compression.hpp"
+
+/// the number of zero bytes that end a literal run
+const std::size_t MIN_ZERO_RUN = 4;
+
+/// Return the byte at an index, XORed against the reference if there is one.
+static inline std::uint8_t delta_at(const std::uint8_t* data, const std::uint8_t* reference, std::size_t index) {
+    return reference ? data[index] ^ reference[index] : data[index];
+}
+
+/// Write a variable length integer, 7 bits per byte.
+static inline std::size_t write_varint(std::uint8_t* output, std::size_t value) {
+    std::size_t length = 0;
+    while (value >= 0x80) {
+        output[length++] = static_cast<std::uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    output[length++] = static_cast<std::uint8_t>(value);
+    return length;
+}
+
+/// Read a variable length integer, returning false if it runs off the input.
+static inline bool read_varint(const std::uint8_t* input, std::size_t size, std::size_t& position, std::size_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (position >= size)
+            return false;
+        std::uint8_t byte = input[position++];
+        value |= static_cast<std::size_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+std::size_t compress(const std::uint8_t* data, const std::uint8_t* reference, std::size_t size, std::uint8_t* output) {
+    std::size_t position = 0;
+    std::size_t length = 0;
+    while (position < size) {
+        // skip unchanged bytes, 8 at a time while possible
+        std::size_t zero_start = position;
+        while (position + 8 <= size) {
+            std::uint64_t a, b = 0;
+            std::memcpy(&a, data + position, 8);
+            if (reference)
+                std::memcpy(&b, reference + position, 8);
+            if (a != b)
+                break;
+            position += 8;
+        }
+        while (position < size && !delta_at(data, reference, position))
+            ++position;
+        std::size_t zero_run = position - zero_start;
+        // collect literal bytes until a long enough zero run (or the end)
+        std::size_t literal_start = position;
+        while (position < size) {
+            if (delta_at(data, reference, position)) {
+                ++position;
+                continue;
+            }
+            std::size_t zeros = position;
+            while (zeros < size && zeros - position < MIN_ZERO_RUN && !delta_at(data, reference, zeros))
+                ++zeros;
+            if (zeros - position >= MIN_ZERO_RUN || zeros == size)
+                break;
+            position = zeros;
+        }
+        length += write_varint(output + length, zero_run);
+        length += write_varint(output + length, position - literal_start);
+        for (std::size_t i = literal_start; i < position; i++)
+            output[length++] = delta_at(data, reference, i);
+    }
+    return length;
+}
+
+bool decompress(const std::uint8_t* input, std::size_t input_size, std::uint8_t* output, std::size_t size, bool is_delta) {
+    std::size_t position = 0;
+    std::size_t written = 0;
+    while (position < input_size) {
+        std::size_t zero_run, literal_run;
+        if (!read_varint(input, input_size, position, zero_run) || !read_varint(input, input_size, position, literal_run))
+            return false;
+        if (zero_run > size - written || literal_run > size - written - zero_run || literal_run > input_size - position)
+            return false;
+        // zero runs leave a delta untouched and clear a full buffer
+        if (!is_delta)
+            std::memset(output + written, 0, zero_run);
+        written += zero_run;
+        if (is_delta) {
+            for (std::size_t i = 0; i < literal_run; i++)
+                output[written + i] ^= input[position + i];
+        }
+        else {
+            std::memcpy(output + written, input + position, literal_run);
+        }
+        written += literal_run;
+        position += literal_run;
+    }
+    return written == size;
+}
+
+std::size_t decompressed_size(const std::uint8_t* input, std::size_t input_size) {
+    std::size_t position = 0;
+    std::size_t size = 0;
+    while (position < input_size) {
+        std::size_t zero_run, literal_run;
+        if (!read_varint(input, input_size, position, zero_run) || !read_varint(input, input_size, position, literal_run))
+            return SIZE_MAX;
+        if (literal_run > input_size - position)
+            return SIZE_MAX;
+        // keep the total below SIZE_MAX so it can't be mistaken for an error
+        if (literal_run > SIZE_MAX - 1 - size || zero_run > SIZE_MAX - 1 - size - literal_run)
+            return SIZE_MAX;
+        size += zero_run + literal_run;
+        position += literal_run;
+    }
+    return size;
+}
@@ -9,9 +9,10 @@
 
 #import "emulator.hpp"
 
-std::unique_ptr<Emulator> kiwiEmulator;
+@implementation KiwiObjC {
+    std::unique_ptr<Emulator> kiwiEmulator;
+}
 
-@implementation KiwiObjC
 +(KiwiObjC *) sharedInstance {
     static dispatch_once_t onceToken;
     static KiwiObjC *sharedInstance = NULL;
@@ -22,7 +23,13 @@ std::unique_ptr<Emulator> kiwiEmulator;
 }
 
 -(void) insertGame:(NSURL *)url {
-    kiwiEmulator = std::make_unique<Emulator>([url.path UTF8String]);
+    // reuse the instance when switching games rather than building a new one
+    if (kiwiEmulator)
+        kiwiEmulator->load_rom([url.path UTF8String]);
+    else
+        kiwiEmulator = std::make_unique<Emulator>([url.path UTF8String]);
+    // battery backed games keep their saves next to the ROM
+    kiwiEmulator->set_save_file([[url URLByDeletingPathExtension] URLByAppendingPathExtension:@"sav"].path.UTF8String);
     [self reset];
 }
 
@@ -38,6 +45,32 @@ std::unique_ptr<Emulator> kiwiEmulator;
     return kiwiEmulator->get_screen_buffer();
 }
 
+-(NSDictionary<NSString *, NSNumber *> *) performanceCounters {
+    // there is nothing to count before a game is inserted
+    if (!kiwiEmulator)
+        return @{};
+    // safe to call from any thread while another steps the emulator
+    EmulatorStats stats = kiwiEmulator->get_stats();
+    const FrameStats& frame = stats.last_frame;
+    NSMutableDictionary<NSString *, NSNumber *> *counters = [@{
+        @"frames" : @(stats.frames),
+        @"cpuInstructions" : @(frame.cpu_instructions),
+        @"cpuCycles" : @(frame.cpu_cycles),
+        @"ppuDots" : @(frame.ppu_dots),
+        @"ppuScanlines" : @(frame.ppu_scanlines),
+        @"stepTime" : @(frame.step_time),
+        @"scaleTime" : @(frame.scale_time)
+    } mutableCopy];
+    NSArray<NSString *> *regions = @[ @"RAM", @"PPU", @"IO", @"PRGRAM", @"PRGROM" ];
+    for (int region = 0; region < BUS_REGION_COUNT; region++) {
+        counters[[@"busReads" stringByAppendingString:regions[region]]] = @(frame.bus_reads[region]);
+        counters[[@"busWrites" stringByAppendingString:regions[region]]] = @(frame.bus_writes[region]);
+    }
+    for (int bucket = 0; bucket < EmulatorStats::FRAME_TIME_BUCKETS; bucket++)
+        counters[[NSString stringWithFormat:@"frameTimeBucket%d", bucket]] = @(stats.frame_times[bucket]);
+    return counters;
+}
+
 -(void) virtualControllerButtonDown:(uint8_t)button {
     kiwiEmulator->get_controller(0)[0] |= button;
 }
@@ -20,6 +20,8 @@ NS_ASSUME_NONNULL_BEGIN
 
 -(uint32_t*) screenFramebuffer;
 
+-(NSDictionary<NSString *, NSNumber *> *) performanceCounters;
+
 -(void) virtualControllerButtonDown:(uint8_t)button;
 -(void) virtualControllerButtonUp:(uint8_t)button;
 @end